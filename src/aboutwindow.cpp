@@ -15,9 +15,6 @@ AboutWindow::AboutWindow(QWidget *parent)
     : QDialog(parent), m_ui(new Ui::AboutWindow), m_isProVersion(false)
 {
     m_ui->setupUi(this);
-#if QT_VERSION < QT_VERSION_CHECK(5, 10, 0)
-    setWindowFlag(Qt::WindowContextHelpButtonHint, false);
-#endif
     setWindowTitle(tr("About") + " " + QCoreApplication::applicationName());
 
     setAboutText();
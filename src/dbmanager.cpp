@@ -1,4 +1,6 @@
 #include "dbmanager.h"
+#include "notepreview.h"
+#include "increasingrun.h"
 #include <QtSql/QSqlQuery>
 #include <QTimeZone>
 #include <QDateTime>
@@ -7,15 +9,50 @@
 #include <QtConcurrent>
 #include <QSqlRecord>
 #include <QSet>
+#include <QTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QFileInfo>
+#include <QDir>
+#include <QSettings>
+#include <limits>
 
 #define DEFAULT_DATABASE_NAME "default_database"
 #define OUTSIDE_DATABASE_NAME "outside_database"
+#define READER_CONNECTION_COUNT 2
+#define RELATIVE_POSITION_GAP 1024
+
+namespace {
+struct ReaderConnection
+{
+    QString name;
+    QString path;
+    ~ReaderConnection() { QSqlDatabase::removeDatabase(name); }
+};
+// one per reader pool thread, removed when the thread exits
+QThreadStorage<ReaderConnection *> readerConnections;
+} // namespace
 
 /*!
  * \brief DBManager::DBManager
  * \param parent
  */
-DBManager::DBManager(QObject *parent) : QObject(parent)
+DBManager::DBManager(QObject *parent)
+    : QObject(parent),
+      m_hasFullTextIndex(false),
+      m_latestListRequestId(0),
+      m_storageSettings(StorageSettings::fromProfile(QStringLiteral("balanced"))),
+      m_readerPool(nullptr),
+      m_nextNodeId(-1),
+      m_nextTagId(-1),
+      m_checkpointTimer(nullptr),
+      m_lastTotalChanges(-1),
+      m_checkpointedTotalChanges(-1),
+      m_isBackupRunning(false),
+      m_backupProgressTimer(nullptr),
+      m_autoBackupTimer(nullptr),
+      m_autoBackupKeepCount(0)
 {
     qRegisterMetaType<QList<NodeData *>>("QList<NodeData*>");
     qRegisterMetaType<QVector<NodeData>>("QVector<NodeData>");
@@ -25,26 +62,243 @@ DBManager::DBManager(QObject *parent) : QObject(parent)
     qRegisterMetaType<FolderListType>("DBManager::FolderListType");
 }
 
+DBManager::~DBManager()
+{
+    m_backupTask.waitForFinished();
+    stopReaders();
+    clearStatementCache();
+}
+
 /*!
  * \brief DBManager::open
  * \param path
  * \param doCreate
+ * \return false if the connection could not be opened
  */
-void DBManager::open(const QString &path, bool doCreate)
+bool DBManager::open(const QString &path, bool doCreate)
 {
+    clearStatementCache();
+    m_nextNodeId = -1;
+    m_nextTagId = -1;
     m_db = QSqlDatabase::addDatabase("QSQLITE", DEFAULT_DATABASE_NAME);
     m_dbpath = path;
     m_db.setDatabaseName(path);
-    if (!m_db.open()) {
+    bool isOpen = m_db.open();
+    if (!isOpen) {
         qDebug() << "Error: connection with database fail";
     } else {
         qDebug() << "Database: connection ok";
+        applyStorageSettings();
     }
 
     if (doCreate) {
         createTables();
     }
-    recalculateChildNotesCount();
+    migrateTables();
+    createFullTextIndex();
+    verifyChildNotesCounts();
+    QTimer::singleShot(0, this, &DBManager::backfillNotePreviews);
+    return isOpen;
+}
+
+/*!
+ * \brief DBManager::close
+ * Close the connection and whatever else holds the file open: the readers, the cached
+ * statements and a backup running on the thread pool
+ */
+void DBManager::close()
+{
+    m_backupTask.waitForFinished();
+    stopReaders();
+    clearStatementCache();
+    {
+        m_db.close();
+        m_db = QSqlDatabase::database();
+    }
+    QSqlDatabase::removeDatabase(DEFAULT_DATABASE_NAME);
+}
+
+/*!
+ * \brief DBManager::moveDatabaseFiles
+ * Rename the database \a from together with its -wal, -shm and -journal files to \a to.
+ * Nothing at \a to is replaced, and if one rename fails the files already moved are put
+ * back, so the database is never left split between both places.
+ */
+bool DBManager::moveDatabaseFiles(const QString &from, const QString &to)
+{
+    static const QStringList suffixes = { QString(), QStringLiteral("-wal"),
+                                          QStringLiteral("-shm"), QStringLiteral("-journal") };
+    for (const auto &suffix : suffixes) {
+        if (QFile::exists(to + suffix)) {
+            qDebug() << __FUNCTION__ << __LINE__ << to + suffix << "already exists";
+            return false;
+        }
+    }
+    QStringList moved;
+    for (const auto &suffix : suffixes) {
+        if (!QFile::exists(from + suffix)) {
+            continue;
+        }
+        if (!QFile::rename(from + suffix, to + suffix)) {
+            qDebug() << __FUNCTION__ << __LINE__ << "Can't rename" << from + suffix;
+            for (const auto &movedSuffix : qAsConst(moved)) {
+                QFile::rename(to + movedSuffix, from + movedSuffix);
+            }
+            return false;
+        }
+        moved.append(suffix);
+    }
+    return true;
+}
+
+void DBManager::removeDatabaseFiles(const QString &path)
+{
+    QFile::remove(path + QStringLiteral("-wal"));
+    QFile::remove(path + QStringLiteral("-shm"));
+    QFile::remove(path + QStringLiteral("-journal"));
+    QFile::remove(path);
+}
+
+StorageSettings StorageSettings::fromProfile(const QString &profile)
+{
+    StorageSettings settings;
+    if (profile == QStringLiteral("compatible")) {
+        settings.journalMode = QStringLiteral("DELETE");
+        settings.synchronous = QStringLiteral("FULL");
+        settings.cacheSizeKiB = 2000;
+        settings.mmapSizeMiB = 0;
+        settings.tempStore = QStringLiteral("DEFAULT");
+        settings.checkpointIdleMs = 0;
+        return settings;
+    }
+    settings.journalMode = QStringLiteral("WAL");
+    // in WAL mode NORMAL only syncs at checkpoints, a crash can lose the last commits
+    // but never corrupts the database
+    settings.synchronous =
+            profile == QStringLiteral("durable") ? QStringLiteral("FULL") : QStringLiteral("NORMAL");
+    settings.cacheSizeKiB = 16384;
+    settings.mmapSizeMiB = 64;
+    settings.tempStore = QStringLiteral("MEMORY");
+    settings.checkpointIdleMs = 1000;
+    return settings;
+}
+
+/*!
+ * \brief StorageSettings::fromSettings
+ * "database/profile" picks the profile, "database/journalMode", "database/synchronous",
+ * "database/cacheSizeKiB", "database/mmapSizeMiB", "database/tempStore" and
+ * "database/checkpointIdleMs" override single values of it
+ */
+StorageSettings StorageSettings::fromSettings(QSettings *settings)
+{
+    StorageSettings storage = fromProfile(
+            settings->value(QStringLiteral("database/profile"), QStringLiteral("balanced"))
+                    .toString());
+    storage.journalMode =
+            settings->value(QStringLiteral("database/journalMode"), storage.journalMode)
+                    .toString();
+    storage.synchronous =
+            settings->value(QStringLiteral("database/synchronous"), storage.synchronous)
+                    .toString();
+    storage.cacheSizeKiB =
+            settings->value(QStringLiteral("database/cacheSizeKiB"), storage.cacheSizeKiB).toInt();
+    storage.mmapSizeMiB =
+            settings->value(QStringLiteral("database/mmapSizeMiB"), storage.mmapSizeMiB).toInt();
+    storage.tempStore =
+            settings->value(QStringLiteral("database/tempStore"), storage.tempStore).toString();
+    storage.checkpointIdleMs =
+            settings->value(QStringLiteral("database/checkpointIdleMs"), storage.checkpointIdleMs)
+                    .toInt();
+    return storage;
+}
+
+/*!
+ * \brief DBManager::setStorageSettings
+ * Call before the database thread starts or on it. Applied right away if the database is
+ * already open, otherwise when it is opened.
+ */
+void DBManager::setStorageSettings(const StorageSettings &settings)
+{
+    m_storageSettings = settings;
+    if (m_db.isOpen()) {
+        applyStorageSettings();
+    }
+}
+
+void DBManager::applyStorageSettings()
+{
+    // switching out of WAL needs this to be the only open connection
+    stopReaders();
+    // pragma values can't be bound, anything outside these lists falls back to the first entry
+    auto allowed = [](const QString &value, const QStringList &values) {
+        QString upper = value.toUpper();
+        return values.contains(upper) ? upper : values.first();
+    };
+    const QString journalMode = allowed(m_storageSettings.journalMode,
+                                        { QStringLiteral("WAL"), QStringLiteral("DELETE"),
+                                          QStringLiteral("TRUNCATE"), QStringLiteral("PERSIST") });
+    const QStringList pragmas = {
+        QStringLiteral("PRAGMA journal_mode = %1;").arg(journalMode),
+        QStringLiteral("PRAGMA synchronous = %1;")
+                .arg(allowed(m_storageSettings.synchronous,
+                             { QStringLiteral("NORMAL"), QStringLiteral("FULL"),
+                               QStringLiteral("EXTRA"), QStringLiteral("OFF") })),
+        // negative sizes are in KiB rather than pages
+        QStringLiteral("PRAGMA cache_size = %1;").arg(-qMax(m_storageSettings.cacheSizeKiB, 0)),
+        QStringLiteral("PRAGMA mmap_size = %1;")
+                .arg(qint64(qMax(m_storageSettings.mmapSizeMiB, 0)) * 1024 * 1024),
+        QStringLiteral("PRAGMA temp_store = %1;")
+                .arg(allowed(m_storageSettings.tempStore,
+                             { QStringLiteral("DEFAULT"), QStringLiteral("FILE"),
+                               QStringLiteral("MEMORY") })),
+    };
+    QSqlQuery query(m_db);
+    for (const auto &pragma : pragmas) {
+        if (!query.exec(pragma)) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError() << pragma;
+        }
+    }
+    query.finish();
+
+    m_lastTotalChanges = -1;
+    m_checkpointedTotalChanges = -1;
+    if (m_storageSettings.checkpointIdleMs > 0 && isWriteAheadLogEnabled()) {
+        if (!m_checkpointTimer) {
+            m_checkpointTimer = new QTimer(this);
+            connect(m_checkpointTimer, &QTimer::timeout, this, &DBManager::onCheckpointTimeout);
+        }
+        m_checkpointTimer->start(m_storageSettings.checkpointIdleMs);
+    } else if (m_checkpointTimer) {
+        m_checkpointTimer->stop();
+    }
+    startReaders();
+}
+
+/*!
+ * \brief DBManager::onCheckpointTimeout
+ * Copy the WAL back into the database once writes have paused for a whole interval, so
+ * the autosaves of a typing burst aren't slowed down by an automatic checkpoint.
+ * PASSIVE never waits for readers such as a running backup.
+ */
+void DBManager::onCheckpointTimeout()
+{
+    QSqlQuery query(m_db);
+    if (!query.exec(QStringLiteral("SELECT total_changes();")) || !query.next()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return;
+    }
+    qint64 totalChanges = query.value(0).toLongLong();
+    query.finish();
+    bool isIdle = totalChanges == m_lastTotalChanges;
+    m_lastTotalChanges = totalChanges;
+    if (!isIdle || totalChanges == m_checkpointedTotalChanges) {
+        return;
+    }
+    if (!query.exec(QStringLiteral("PRAGMA wal_checkpoint(PASSIVE);"))) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return;
+    }
+    m_checkpointedTotalChanges = totalChanges;
 }
 
 /*!
@@ -56,7 +310,7 @@ void DBManager::createTables()
     QSqlQuery query(m_db);
 
     QString nodeTable = R"(CREATE TABLE "node_table" ()"
-                        R"(    "id"	INTEGER NOT NULL,)"
+                        R"(    "id"	INTEGER NOT NULL PRIMARY KEY,)"
                         R"(    "title"	TEXT,)"
                         R"(    "creation_date"	INTEGER NOT NULL DEFAULT 0,)"
                         R"(    "modification_date"	INTEGER NOT NULL DEFAULT 0,)"
@@ -69,7 +323,8 @@ void DBManager::createTables()
                         R"(    "absolute_path"	TEXT NOT NULL,)"
                         R"(    "is_pinned_note"	INTEGER NOT NULL DEFAULT 0,)"
                         R"(    "relative_position_an"	INTEGER NOT NULL,)"
-                        R"(    "child_notes_count"	INTEGER NOT NULL)"
+                        R"(    "child_notes_count"	INTEGER NOT NULL,)"
+                        R"(    "preview"	TEXT)"
                         R"();)";
     auto status = query.exec(nodeTable);
     if (!status) {
@@ -88,7 +343,7 @@ void DBManager::createTables()
     query.clear();
 
     QString tagTable = R"(CREATE TABLE "tag_table" ()"
-                       R"(    "id"	INTEGER NOT NULL,)"
+                       R"(    "id"	INTEGER NOT NULL PRIMARY KEY,)"
                        R"(    "name"	TEXT NOT NULL,)"
                        R"(    "color"	TEXT NOT NULL,)"
                        R"(    "child_notes_count"	INTEGER NOT NULL,)"
@@ -153,6 +408,270 @@ void DBManager::createTables()
     m_db.commit();
 }
 
+/*!
+ * \brief DBManager::migrateTables
+ * Brings a database created by an older version up to the current schema
+ */
+void DBManager::migrateTables()
+{
+    QSqlQuery query(m_db);
+    auto nodeColumns = tableColumns(QStringLiteral("node_table"));
+    if (!nodeColumns.contains(QStringLiteral("preview"))) {
+        if (!query.exec(R"(ALTER TABLE "node_table" ADD COLUMN "preview" TEXT;)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.clear();
+    }
+    createIndexes();
+    createChildNotesCountTriggers();
+}
+
+/*!
+ * \brief DBManager::tableColumns
+ * \param tableName
+ * \return the columns of the table, mapped to whether they are part of its primary key
+ */
+QMap<QString, bool> DBManager::tableColumns(const QString &tableName)
+{
+    QMap<QString, bool> columns;
+    QSqlQuery query(m_db);
+    if (query.exec(QStringLiteral("PRAGMA table_info(\"%1\");").arg(tableName))) {
+        while (query.next()) {
+            columns[query.value(1).toString()] = query.value(5).toInt() > 0;
+        }
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    return columns;
+}
+
+/*!
+ * \brief DBManager::createIndexes
+ * Indexes for the access paths of the hot queries: lookups by id, notes of a folder, subtrees by
+ * absolute path prefix and notes of a tag. Databases created before id became the primary key
+ * get a unique index on it instead
+ */
+void DBManager::createIndexes()
+{
+    QSqlQuery query(m_db);
+    for (const auto &table : { QStringLiteral("node_table"), QStringLiteral("tag_table") }) {
+        if (tableColumns(table).value(QStringLiteral("id"))) {
+            continue;
+        }
+        QString uniqueIndex = R"(CREATE UNIQUE INDEX IF NOT EXISTS "%1_id_index" ON "%1" ("id");)";
+        if (!query.exec(uniqueIndex.arg(table))) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            query.clear();
+            // duplicated ids from an old bug, still index them for lookups
+            QString index = R"(CREATE INDEX IF NOT EXISTS "%1_id_index" ON "%1" ("id");)";
+            if (!query.exec(index.arg(table))) {
+                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            }
+        }
+        query.clear();
+    }
+
+    const QStringList indexes = {
+        R"(CREATE INDEX IF NOT EXISTS "node_table_parent_index" ON "node_table" ("parent_id", "node_type");)",
+        R"(CREATE INDEX IF NOT EXISTS "node_table_type_path_index" ON "node_table" ("node_type", "absolute_path");)",
+        R"(CREATE INDEX IF NOT EXISTS "node_table_path_index" ON "node_table" ("absolute_path");)",
+        R"(CREATE INDEX IF NOT EXISTS "tag_relationship_tag_index" ON "tag_relationship" ("tag_id", "node_id");)",
+    };
+    for (const auto &index : indexes) {
+        if (!query.exec(index)) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.clear();
+    }
+}
+
+/*!
+ * \brief DBManager::pathPrefixEnd
+ * Upper bound of the absolute paths starting with the prefix, so that subtree queries can be
+ * written as an indexable range instead of LIKE 'prefix%'
+ * \param prefix
+ * \return
+ */
+QString DBManager::pathPrefixEnd(const QString &prefix)
+{
+    if (prefix.isEmpty()) {
+        return prefix;
+    }
+    QString end = prefix;
+    end[end.size() - 1] = QChar(end.at(end.size() - 1).unicode() + 1);
+    return end;
+}
+
+/*!
+ * \brief DBManager::backfillNotePreviews
+ * Fills the preview column of notes saved by an older version. Works in small batches and
+ * reschedules itself so that requests queued on the database thread are not held up
+ */
+void DBManager::backfillNotePreviews()
+{
+    const int batchSize = 200;
+    QVector<QPair<int, QString>> previews;
+    QSqlQuery query(m_db);
+    query.prepare(R"(SELECT "id", "content" FROM node_table )"
+                  R"(WHERE node_type = :node_type AND preview IS NULL LIMIT :limit;)");
+    query.bindValue(":node_type", static_cast<int>(NodeData::Note));
+    query.bindValue(":limit", batchSize);
+    if (query.exec()) {
+        while (query.next()) {
+            previews.append(qMakePair(query.value(0).toInt(),
+                                      NotePreview::secondLine(query.value(1).toString())));
+        }
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return;
+    }
+    query.clear();
+    if (previews.isEmpty()) {
+        return;
+    }
+
+    m_db.transaction();
+    query.prepare(R"(UPDATE "node_table" SET "preview"=:preview WHERE "id"=:id;)");
+    for (const auto &preview : qAsConst(previews)) {
+        query.bindValue(":preview", preview.second);
+        query.bindValue(":id", preview.first);
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+    }
+    m_db.commit();
+
+    if (previews.size() == batchSize) {
+        QTimer::singleShot(0, this, &DBManager::backfillNotePreviews);
+    }
+}
+
+/*!
+ * \brief DBManager::notePreview
+ * The preview line shown in the note list. Computed from the body when it is loaded, the
+ * note's own preview may be older than that; notes read without a body keep theirs
+ * \param note
+ * \return
+ */
+QString DBManager::notePreview(const NodeData &note)
+{
+    if (note.nodeType() != NodeData::Note) {
+        return QString();
+    }
+    if (note.isContentLoaded() || note.preview().isNull()) {
+        return NotePreview::secondLine(note.content());
+    }
+    return note.preview();
+}
+
+/*!
+ * \brief DBManager::createFullTextIndex
+ * Creates the FTS5 index over notes' title and content if it doesn't exist yet, and keeps it
+ * in sync with node_table through triggers. An existing database is backfilled when the index
+ * is first created. Table, triggers and backfill are one transaction, so a failed backfill
+ * leaves no index behind and is retried on the next open.
+ */
+void DBManager::createFullTextIndex()
+{
+    m_hasFullTextIndex = false;
+    QSqlQuery query(m_db);
+    query.prepare(R"(SELECT EXISTS(SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'note_fts'))");
+    bool needBackfill = true;
+    if (query.exec() && query.next()) {
+        needBackfill = query.value(0).toInt() == 0;
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+
+    m_db.transaction();
+    // trigram tokenizer keeps the old substring semantics of content LIKE '%keyword%'
+    bool status = query.exec(R"(CREATE VIRTUAL TABLE IF NOT EXISTS "note_fts" )"
+                             R"(USING fts5(title, content, tokenize = 'trigram');)");
+    if (!status) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError()
+                 << "Full-text search is not available, falling back to LIKE";
+        query.clear();
+        m_db.rollback();
+        return;
+    }
+    query.clear();
+
+    const QString noteType = QString::number(static_cast<int>(NodeData::Note));
+    const QStringList triggers = {
+        R"(CREATE TRIGGER IF NOT EXISTS "note_fts_insert" AFTER INSERT ON "node_table" )"
+        R"(WHEN new.node_type = )" + noteType + R"( BEGIN )"
+        R"(INSERT INTO note_fts(rowid, title, content) VALUES (new.id, new.title, new.content); )"
+        R"(END;)",
+        R"(CREATE TRIGGER IF NOT EXISTS "note_fts_delete" AFTER DELETE ON "node_table" )"
+        R"(WHEN old.node_type = )" + noteType + R"( BEGIN )"
+        R"(DELETE FROM note_fts WHERE rowid = old.id; )"
+        R"(END;)",
+        R"(CREATE TRIGGER IF NOT EXISTS "note_fts_update" AFTER UPDATE OF title, content ON "node_table" )"
+        R"(WHEN new.node_type = )" + noteType + R"( BEGIN )"
+        R"(UPDATE note_fts SET title = new.title, content = new.content WHERE rowid = new.id; )"
+        R"(END;)",
+    };
+    for (const auto &trigger : triggers) {
+        status = query.exec(trigger);
+        if (!status) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.clear();
+        if (!status) {
+            m_db.rollback();
+            return;
+        }
+    }
+
+    if (needBackfill) {
+        query.prepare(R"(INSERT INTO note_fts(rowid, title, content) )"
+                      R"(SELECT id, title, content FROM node_table WHERE node_type = :node_type;)");
+        query.bindValue(":node_type", static_cast<int>(NodeData::Note));
+        status = query.exec();
+        if (!status) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError()
+                     << "Full-text index backfill failed, retrying on the next open";
+        }
+        query.clear();
+        if (!status) {
+            m_db.rollback();
+            return;
+        }
+    }
+    if (!m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        m_db.rollback();
+        return;
+    }
+    m_hasFullTextIndex = true;
+}
+
+/*!
+ * \brief DBManager::canUseFullTextIndex
+ * The trigram tokenizer can't match keywords shorter than 3 characters
+ * \param keyword
+ * \return
+ */
+bool DBManager::canUseFullTextIndex(const QString &keyword) const
+{
+    return m_hasFullTextIndex && keyword.size() >= 3;
+}
+
+/*!
+ * \brief DBManager::fullTextMatchExpression
+ * Quotes the keyword as a single FTS5 phrase so that operators typed by the user are matched
+ * literally
+ * \param keyword
+ * \return
+ */
+QString DBManager::fullTextMatchExpression(const QString &keyword)
+{
+    QString phrase = keyword;
+    phrase.replace(QStringLiteral("\""), QStringLiteral("\"\""));
+    return QStringLiteral("\"") + phrase + QStringLiteral("\"");
+}
+
 /*!
  * \brief DBManager::isNoteExist
  * \param note
@@ -160,26 +679,26 @@ void DBManager::createTables()
  */
 bool DBManager::isNodeExist(const NodeData &node)
 {
-    QSqlQuery query(m_db);
+    QSqlQuery &query = cachedQuery(
+            QStringLiteral("SELECT EXISTS(SELECT 1 FROM node_table WHERE id = :id LIMIT 1 )"));
 
     int id = node.id();
-    QString queryStr =
-            QStringLiteral("SELECT EXISTS(SELECT 1 FROM node_table WHERE id = :id LIMIT 1 )");
-    query.prepare(queryStr);
     query.bindValue(":id", id);
     bool status = query.exec();
     if (!status) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError() << query.isValid();
     }
     query.next();
-    return query.value(0).toInt() == 1;
+    bool exists = query.value(0).toInt() == 1;
+    query.finish();
+    return exists;
 }
 
-QVector<NodeData> DBManager::getAllFolders()
+QVector<NodeData> DBManager::getAllFolders(QSqlDatabase &db)
 {
     QVector<NodeData> nodeList;
 
-    QSqlQuery query(m_db);
+    QSqlQuery query(db);
     query.prepare(R"(SELECT)"
                   R"("id",)"
                   R"("title",)"
@@ -210,9 +729,6 @@ QVector<NodeData> DBManager::getAllFolders()
             node.setRelativePosition(query.value(8).toInt());
             node.setAbsolutePath(query.value(9).toString());
             node.setChildNotesCount(query.value(10).toInt());
-            if (node.nodeType() == NodeData::Note) {
-                node.setTagIds(getAllTagForNote(node.id()));
-            }
             nodeList.append(node);
         }
     } else {
@@ -222,11 +738,11 @@ QVector<NodeData> DBManager::getAllFolders()
     return nodeList;
 }
 
-QVector<TagData> DBManager::getAllTagInfo()
+QVector<TagData> DBManager::getAllTagInfo(QSqlDatabase &db)
 {
     QVector<TagData> tagList;
 
-    QSqlQuery query(m_db);
+    QSqlQuery query(db);
     query.prepare(
             R"(SELECT "id","name","color","relative_position","child_notes_count" FROM tag_table;)");
     bool status = query.exec();
@@ -250,8 +766,8 @@ QVector<TagData> DBManager::getAllTagInfo()
 QSet<int> DBManager::getAllTagForNote(int noteId)
 {
     QSet<int> tagIds;
-    QSqlQuery query(m_db);
-    query.prepare(R"(SELECT "tag_id" FROM tag_relationship WHERE node_id = :node_id;)");
+    QSqlQuery &query =
+            cachedQuery(R"(SELECT "tag_id" FROM tag_relationship WHERE node_id = :node_id;)");
     query.bindValue(":node_id", noteId);
     bool status = query.exec();
     if (status) {
@@ -261,52 +777,259 @@ QSet<int> DBManager::getAllTagForNote(int noteId)
     } else {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
+    query.finish();
     return tagIds;
 }
 
-int DBManager::addNode(const NodeData &node)
+/*!
+ * \brief DBManager::getNoteList
+ * Loads every note matching the condition in three passes: the notes themselves, their tags and
+ * the folder titles, instead of querying tags and parent per note.
+ * Only the stored preview of each note is read, the body is loaded on demand with getNoteContent
+ * Gives up between passes once \a requestId has been superseded by a newer list request
+ * \param db the writer connection or a reader connection
+ * \param condition WHERE clause on node_table
+ * \param bindValues values for the placeholders used in the condition
+ * \param requestId list request this query belongs to, 0 if it can't go stale
+ * \return
+ */
+QVector<NodeData> DBManager::getNoteList(QSqlDatabase &db, const QString &condition,
+                                         const QMap<QString, QVariant> &bindValues,
+                                         quint64 requestId)
 {
-    QSqlQuery query(m_db);
-    QString emptyStr;
-
-    qint64 epochTimeDateCreated = node.creationDateTime().toMSecsSinceEpoch();
-    QString content = node.content().replace("'", "''").replace(QChar('\x0'), emptyStr);
-    QString fullTitle = node.fullTitle().replace("'", "''").replace(QChar('\x0'), emptyStr);
-
-    qint64 epochTimeDateLastModified = node.lastModificationdateTime().isNull()
-            ? epochTimeDateCreated
-            : node.lastModificationdateTime().toMSecsSinceEpoch();
-
-    int relationalPosition = 0;
-    if (node.parentId() != -1) {
-        query.prepare(R"(SELECT relative_position FROM "node_table" )"
-                      R"(WHERE parent_id = :parent_id AND node_type = :node_type;)");
-        query.bindValue(":parent_id", node.parentId());
-        query.bindValue(":node_type", static_cast<int>(node.nodeType()));
-        bool status = query.exec();
-        if (status) {
-            while (query.next()) {
-                if (relationalPosition <= query.value(0).toInt()) {
-                    relationalPosition = query.value(0).toInt() + 1;
-                }
-            }
-        } else {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    QVector<NodeData> nodeList;
+    QHash<int, QString> folderTitles;
+    QHash<int, QSet<int>> noteTagIds;
+    const NoteListStatements statements = noteListStatements(condition);
+
+    // the three reads must see one snapshot, or a save in between could list a note with
+    // tags or a folder title of another version. false when the caller already runs one.
+    bool isOwnTransaction = db.transaction();
+    QSqlQuery query(db);
+    auto endSnapshot = [&db, &query, isOwnTransaction]() {
+        query.clear();
+        if (isOwnTransaction && !db.commit()) {
+            qDebug() << "getNoteList" << __LINE__ << db.lastError();
         }
-        query.finish();
+    };
+    query.prepare(statements.folders);
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Folder));
+    bool status = query.exec();
+    if (status) {
+        while (query.next()) {
+            folderTitles[query.value(0).toInt()] = query.value(1).toString();
+        }
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    int nodeId = nextAvailableNodeId();
-    QString absolutePath;
-    if (node.parentId() != -1) {
-        absolutePath = getNodeAbsolutePath(node.parentId()).path();
+    query.clear();
+    if (isListRequestStale(requestId)) {
+        endSnapshot();
+        return nodeList;
     }
-    absolutePath += PATH_SEPARATOR + QString::number(nodeId);
-    QString queryStr =
-            R"(INSERT INTO "node_table")"
-            R"(("id", "title", "creation_date", "modification_date", "deletion_date", "content", "node_type", "parent_id", "relative_position", "scrollbar_position", "absolute_path", "is_pinned_note", "relative_position_an", "child_notes_count"))"
-            R"(VALUES (:id, :title, :creation_date, :modification_date, :deletion_date, :content, :node_type, :parent_id, :relative_position, :scrollbar_position, :absolute_path, :is_pinned_note, :relative_position_an, :child_notes_count);)";
 
-    query.prepare(queryStr);
+    query.prepare(statements.tags);
+    for (auto it = bindValues.constBegin(); it != bindValues.constEnd(); ++it) {
+        query.bindValue(it.key(), it.value());
+    }
+    status = query.exec();
+    if (status) {
+        while (query.next()) {
+            noteTagIds[query.value(0).toInt()].insert(query.value(1).toInt());
+        }
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+    if (isListRequestStale(requestId)) {
+        endSnapshot();
+        return nodeList;
+    }
+
+    query.prepare(statements.notes);
+    for (auto it = bindValues.constBegin(); it != bindValues.constEnd(); ++it) {
+        query.bindValue(it.key(), it.value());
+    }
+    status = query.exec();
+    if (status) {
+        while (query.next()) {
+            if (nodeList.size() % 256 == 255 && isListRequestStale(requestId)) {
+                nodeList.clear();
+                break;
+            }
+            NodeData node;
+            node.setId(query.value(0).toInt());
+            node.setFullTitle(query.value(1).toString());
+            node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
+            node.setLastModificationDateTime(
+                    QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
+            node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
+            if (query.value(14).isNull()) {
+                // not backfilled yet
+                node.setPreview(NotePreview::secondLine(query.value(5).toString()));
+            } else {
+                node.setPreview(query.value(14).toString());
+            }
+            node.setIsContentLoaded(false);
+            node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
+            node.setParentId(query.value(7).toInt());
+            node.setRelativePosition(query.value(8).toInt());
+            node.setScrollBarPosition(query.value(9).toInt());
+            node.setAbsolutePath(query.value(10).toString());
+            node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
+            node.setRelativePosAN(query.value(12).toInt());
+            node.setChildNotesCount(query.value(13).toInt());
+            node.setTagIds(noteTagIds.value(node.id()));
+            node.setParentName(folderTitles.value(node.parentId()));
+            nodeList.append(node);
+        }
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    endSnapshot();
+    return nodeList;
+}
+
+/*!
+ * \brief DBManager::noteListStatements
+ * \param condition WHERE clause on node_table
+ * \return the statements getNoteList prepares for \a condition
+ */
+NoteListStatements DBManager::noteListStatements(const QString &condition)
+{
+    NoteListStatements statements;
+    statements.folders =
+            QStringLiteral(R"(SELECT "id", "title" FROM node_table WHERE node_type = :node_type;)");
+    statements.tags = QStringLiteral(R"(SELECT tag_relationship.node_id, tag_relationship.tag_id )"
+                                     R"(FROM tag_relationship INNER JOIN node_table )"
+                                     R"(ON node_table.id = tag_relationship.node_id WHERE )")
+            + condition + QStringLiteral(";");
+    statements.notes = QStringLiteral(R"(SELECT )"
+                                      R"("id",)"
+                                      R"("title",)"
+                                      R"("creation_date",)"
+                                      R"("modification_date",)"
+                                      R"("deletion_date",)"
+                                      R"(CASE WHEN "preview" IS NULL THEN "content" END,)"
+                                      R"("node_type",)"
+                                      R"("parent_id",)"
+                                      R"("relative_position",)"
+                                      R"("scrollbar_position",)"
+                                      R"("absolute_path", )"
+                                      R"("is_pinned_note", )"
+                                      R"("relative_position_an", )"
+                                      R"("child_notes_count", )"
+                                      R"("preview" )"
+                                      R"(FROM node_table WHERE )")
+            + condition + QStringLiteral(";");
+    return statements;
+}
+
+/*!
+ * \brief DBManager::folderListCondition
+ * Condition for the notes listed in a folder, in all notes when \a parentId is the root
+ * \param parentPath absolute path of the folder, only used when \a isRecursive
+ * \param bindValues receives the values for the placeholders of the condition
+ * \return
+ */
+QString DBManager::folderListCondition(int parentId, bool isRecursive, const QString &parentPath,
+                                       QMap<QString, QVariant> &bindValues)
+{
+    bindValues[QStringLiteral(":node_type")] = static_cast<int>(NodeData::Note);
+    if (parentId == SpecialNodeID::RootFolder) {
+        bindValues[QStringLiteral(":parent_id")] = static_cast<int>(SpecialNodeID::TrashFolder);
+        return QStringLiteral("node_type = (:node_type) AND parent_id != (:parent_id)");
+    }
+    if (!isRecursive) {
+        bindValues[QStringLiteral(":parent_id")] = parentId;
+        return QStringLiteral("parent_id = (:parent_id) AND node_type = (:node_type)");
+    }
+    QString prefix = parentPath + PATH_SEPARATOR;
+    bindValues[QStringLiteral(":path_expr")] = prefix;
+    bindValues[QStringLiteral(":path_end")] = pathPrefixEnd(prefix);
+    return QStringLiteral("node_type = (:node_type) AND absolute_path >= "
+                          "(:path_expr) AND absolute_path < (:path_end)");
+}
+
+/*!
+ * \brief DBManager::tagListCondition
+ * Condition for the notes listed when \a tagIds are selected
+ * \param bindValues receives the values for the placeholders of the condition
+ * \return
+ */
+QString DBManager::tagListCondition(const QSet<int> &tagIds, QMap<QString, QVariant> &bindValues)
+{
+    bindValues[QStringLiteral(":node_type")] = static_cast<int>(NodeData::Note);
+    return QStringLiteral("node_type = (:node_type) AND ") + tagFilterClause(tagIds, bindValues);
+}
+
+/*!
+ * \brief DBManager::tagFilterClause
+ * Builds a condition matching the nodes that have all of the given tags
+ * \param tagIds
+ * \param bindValues receives the values for the placeholders of the condition
+ * \return
+ */
+QString DBManager::tagFilterClause(const QSet<int> &tagIds, QMap<QString, QVariant> &bindValues)
+{
+    QStringList placeholders;
+    for (const auto &tagId : tagIds) {
+        QString placeholder = QStringLiteral(":tag_id_%1").arg(placeholders.size());
+        bindValues[placeholder] = tagId;
+        placeholders.append(placeholder);
+    }
+    return QStringLiteral("id IN (SELECT node_id FROM tag_relationship WHERE tag_id IN (%1) "
+                          "GROUP BY node_id HAVING count(*) = %2)")
+            .arg(placeholders.join(QStringLiteral(", ")))
+            .arg(placeholders.size());
+}
+
+int DBManager::addNode(const NodeData &node)
+{
+    assertOnDatabaseThread(__FUNCTION__);
+    // false when the caller already runs a transaction, the insert then becomes part of it
+    bool isOwnTransaction = m_db.transaction();
+    QSqlQuery query(m_db);
+    QString emptyStr;
+
+    qint64 epochTimeDateCreated = node.creationDateTime().toMSecsSinceEpoch();
+    QString content = node.content().replace(QChar('\x0'), emptyStr);
+    QString fullTitle = node.fullTitle().replace(QChar('\x0'), emptyStr);
+
+    qint64 epochTimeDateLastModified = node.lastModificationdateTime().isNull()
+            ? epochTimeDateCreated
+            : node.lastModificationdateTime().toMSecsSinceEpoch();
+
+    int relationalPosition = 0;
+    if (node.parentId() != -1) {
+        query.prepare(R"(SELECT relative_position FROM "node_table" )"
+                      R"(WHERE parent_id = :parent_id AND node_type = :node_type;)");
+        query.bindValue(":parent_id", node.parentId());
+        query.bindValue(":node_type", static_cast<int>(node.nodeType()));
+        bool status = query.exec();
+        if (status) {
+            while (query.next()) {
+                if (relationalPosition <= query.value(0).toInt()) {
+                    relationalPosition = query.value(0).toInt() + 1;
+                }
+            }
+        } else {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.finish();
+    }
+    int nodeId = reserveNodeIds(1);
+    QString absolutePath;
+    if (node.parentId() != -1) {
+        absolutePath = getNodeAbsolutePath(node.parentId()).path();
+    }
+    absolutePath += PATH_SEPARATOR + QString::number(nodeId);
+    QString queryStr =
+            R"(INSERT INTO "node_table")"
+            R"(("id", "title", "creation_date", "modification_date", "deletion_date", "content", "node_type", "parent_id", "relative_position", "scrollbar_position", "absolute_path", "is_pinned_note", "relative_position_an", "child_notes_count", "preview"))"
+            R"(VALUES (:id, :title, :creation_date, :modification_date, :deletion_date, :content, :node_type, :parent_id, :relative_position, :scrollbar_position, :absolute_path, :is_pinned_note, :relative_position_an, :child_notes_count, :preview);)";
+
+    query.prepare(queryStr);
     query.bindValue(":id", nodeId);
     query.bindValue(":title", fullTitle);
     query.bindValue(":creation_date", epochTimeDateCreated);
@@ -325,20 +1048,25 @@ int DBManager::addNode(const NodeData &node)
     query.bindValue(":is_pinned_note", node.isPinnedNote() ? 1 : 0);
     query.bindValue(":relative_position_an", node.relativePosAN());
     query.bindValue(":child_notes_count", node.childNotesCount());
+    query.bindValue(":preview", notePreview(node));
 
     if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        query.finish();
+        if (isOwnTransaction) {
+            m_db.rollback();
+        }
+        return SpecialNodeID::InvalidNodeId;
     }
     query.finish();
-
-    query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)");
-    query.bindValue(":value", nodeId + 1);
-    if (!query.exec()) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    if (isOwnTransaction && !m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        m_db.rollback();
+        return SpecialNodeID::InvalidNodeId;
     }
     if (node.nodeType() == NodeData::Note) {
-        increaseChildNotesCountFolder(node.parentId());
-        increaseChildNotesCountFolder(SpecialNodeID::RootFolder);
+        notifyChildNotesCountFolder(node.parentId());
+        notifyChildNotesCountFolder(SpecialNodeID::RootFolder);
     }
     return nodeId;
 }
@@ -349,8 +1077,8 @@ int DBManager::addNodePreComputed(const NodeData &node)
     QString emptyStr;
 
     qint64 epochTimeDateCreated = node.creationDateTime().toMSecsSinceEpoch();
-    QString content = node.content().replace("'", "''").replace(QChar('\x0'), emptyStr);
-    QString fullTitle = node.fullTitle().replace("'", "''").replace(QChar('\x0'), emptyStr);
+    QString content = node.content().replace(QChar('\x0'), emptyStr);
+    QString fullTitle = node.fullTitle().replace(QChar('\x0'), emptyStr);
 
     qint64 epochTimeDateLastModified = node.lastModificationdateTime().isNull()
             ? epochTimeDateCreated
@@ -361,8 +1089,8 @@ int DBManager::addNodePreComputed(const NodeData &node)
     QString absolutePath = node.absolutePath();
     QString queryStr =
             R"(INSERT INTO "node_table" )"
-            R"(("id", "title", "creation_date", "modification_date", "deletion_date", "content", "node_type", "parent_id", "relative_position", "scrollbar_position", "absolute_path", "is_pinned_note", "relative_position_an", "child_notes_count") )"
-            R"(VALUES (:id, :title, :creation_date, :modification_date, :deletion_date, :content, :node_type, :parent_id, :relative_position, :scrollbar_position, :absolute_path, :is_pinned_note, :relative_position_an, :child_notes_count);)";
+            R"(("id", "title", "creation_date", "modification_date", "deletion_date", "content", "node_type", "parent_id", "relative_position", "scrollbar_position", "absolute_path", "is_pinned_note", "relative_position_an", "child_notes_count", "preview") )"
+            R"(VALUES (:id, :title, :creation_date, :modification_date, :deletion_date, :content, :node_type, :parent_id, :relative_position, :scrollbar_position, :absolute_path, :is_pinned_note, :relative_position_an, :child_notes_count, :preview);)";
 
     query.prepare(queryStr);
     query.bindValue(":id", nodeId);
@@ -383,6 +1111,7 @@ int DBManager::addNodePreComputed(const NodeData &node)
     query.bindValue(":is_pinned_note", node.isPinnedNote() ? 1 : 0);
     query.bindValue(":relative_position_an", node.relativePosAN());
     query.bindValue(":child_notes_count", node.childNotesCount());
+    query.bindValue(":preview", notePreview(node));
 
     bool status = query.exec();
     if (!status) {
@@ -394,291 +1123,377 @@ int DBManager::addNodePreComputed(const NodeData &node)
     return nodeId;
 }
 
-void DBManager::recalculateChildNotesCount()
+/*!
+ * \brief DBManager::loadIdCounters
+ * Seeds the id allocator from metadata, or from the highest id in use if that is larger
+ */
+void DBManager::loadIdCounters()
 {
-    QSet<int> tagIds;
     QSqlQuery query(m_db);
-    query.prepare(R"(SELECT id FROM "tag_table")");
-    bool status = query.exec();
-    if (status) {
-        while (query.next()) {
-            tagIds.insert(query.value(0).toInt());
-        }
-    } else {
+    if (!query.exec(R"(SELECT )"
+                    R"(max(coalesce((SELECT "value" FROM metadata WHERE "key"='next_node_id'), 0), )"
+                    R"(    (SELECT coalesce(max(id), -1) + 1 FROM node_table)), )"
+                    R"(max(coalesce((SELECT "value" FROM metadata WHERE "key"='next_tag_id'), 0), )"
+                    R"(    (SELECT coalesce(max(id), -1) + 1 FROM tag_table));)")
+        || !query.next()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return;
     }
-    query.clear();
-    for (const auto &id : qAsConst(tagIds)) {
-        query.prepare("SELECT count(*) FROM tag_relationship WHERE tag_id=:id");
-        query.bindValue(QStringLiteral(":id"), id);
-        status = query.exec();
-        int childNotesCount = 0;
-        if (status) {
-            query.next();
-            childNotesCount = query.value(0).toInt();
-        } else {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    m_nextNodeId = query.value(0).toInt();
+    m_nextTagId = query.value(1).toInt();
+}
+
+/*!
+ * \brief DBManager::reserveNodeIds
+ * Takes \a count consecutive ids from the in-memory allocator. The new counter is written
+ * to metadata right away, call it inside the transaction that inserts the rows so both
+ * are committed together.
+ * \param count
+ * \return the first reserved id
+ */
+int DBManager::reserveNodeIds(int count)
+{
+    if (m_nextNodeId < 0) {
+        loadIdCounters();
+    }
+    int firstId = m_nextNodeId;
+    m_nextNodeId += count;
+    QSqlQuery &query = cachedQuery(
+            R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)");
+    query.bindValue(":value", m_nextNodeId);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    return firstId;
+}
+
+/*!
+ * \brief DBManager::reserveTagIds
+ * Tag counterpart of reserveNodeIds
+ */
+int DBManager::reserveTagIds(int count)
+{
+    if (m_nextTagId < 0) {
+        loadIdCounters();
+    }
+    int firstId = m_nextTagId;
+    m_nextTagId += count;
+    QSqlQuery &query =
+            cachedQuery(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_tag_id';)");
+    query.bindValue(":value", m_nextTagId);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    return firstId;
+}
+
+/*!
+ * \brief DBManager::addNodesBulk
+ * Bulk counterpart of addNode for imports: ids are reserved once, rows go in with multi-row
+ * INSERT statements inside one transaction and the child note counters are announced once
+ * at the end. Ids, absolute paths and relative positions of \a nodes are ignored and
+ * assigned here, in order, after the existing children of each parent.
+ * All rows go in or none do: on any failure the transaction is rolled back.
+ * \param nodes
+ * \return the ids given to \a nodes, empty if the insert failed
+ */
+QVector<int> DBManager::addNodesBulk(const QVector<NodeData> &nodes)
+{
+    assertOnDatabaseThread(__FUNCTION__);
+    // 15 columns per row, stays below SQLite's historical 999 host parameter limit
+    static const int rowsPerStatement = 64;
+    static const QString insertHead = QStringLiteral(
+            R"(INSERT INTO "node_table" )"
+            R"(("id", "title", "creation_date", "modification_date", "deletion_date", "content", "node_type", "parent_id", "relative_position", "scrollbar_position", "absolute_path", "is_pinned_note", "relative_position_an", "child_notes_count", "preview") )"
+            R"(VALUES )");
+    static const QString rowPlaceholders =
+            QStringLiteral("(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+
+    QVector<int> ids;
+    if (nodes.isEmpty()) {
+        return ids;
+    }
+    ids.reserve(nodes.size());
+    QString emptyStr;
+    QHash<int, QString> parentPaths;
+    QHash<QPair<int, int>, int> nextPositions;
+
+    if (!m_db.transaction()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        return QVector<int>();
+    }
+    int nodeId = reserveNodeIds(nodes.size());
+    QSqlQuery query(m_db);
+    for (int start = 0; start < nodes.size(); start += rowsPerStatement) {
+        int rowCount = qMin(rowsPerStatement, static_cast<int>(nodes.size()) - start);
+        QStringList rows;
+        for (int i = 0; i < rowCount; ++i) {
+            rows.append(rowPlaceholders);
         }
-        query.clear();
-        query.prepare(QStringLiteral("UPDATE tag_table SET child_notes_count = :child_notes_count "
-                                     "WHERE id = :id"));
-        query.bindValue(QStringLiteral(":id"), id);
-        query.bindValue(QStringLiteral(":child_notes_count"), childNotesCount);
-        status = query.exec();
-        if (!status) {
+        query.prepare(insertHead + rows.join(QStringLiteral(", ")) + QStringLiteral(";"));
+        for (int i = start; i < start + rowCount; ++i) {
+            const auto &node = nodes[i];
+            if (!parentPaths.contains(node.parentId())) {
+                parentPaths[node.parentId()] = getNodeAbsolutePath(node.parentId()).path();
+            }
+            auto positionKey = qMakePair(node.parentId(), static_cast<int>(node.nodeType()));
+            if (!nextPositions.contains(positionKey)) {
+                nextPositions[positionKey] = nextAvailablePosition(node.parentId(), node.nodeType());
+            }
+            qint64 epochTimeDateCreated = node.creationDateTime().toMSecsSinceEpoch();
+            qint64 epochTimeDateLastModified = node.lastModificationdateTime().isNull()
+                    ? epochTimeDateCreated
+                    : node.lastModificationdateTime().toMSecsSinceEpoch();
+            query.addBindValue(nodeId);
+            query.addBindValue(QString(node.fullTitle()).replace(QChar('\x0'), emptyStr));
+            query.addBindValue(epochTimeDateCreated);
+            query.addBindValue(epochTimeDateLastModified);
+            query.addBindValue(node.deletionDateTime().isNull()
+                                       ? -1
+                                       : node.deletionDateTime().toMSecsSinceEpoch());
+            query.addBindValue(QString(node.content()).replace(QChar('\x0'), emptyStr));
+            query.addBindValue(static_cast<int>(node.nodeType()));
+            query.addBindValue(node.parentId());
+            query.addBindValue(nextPositions[positionKey]++);
+            query.addBindValue(node.scrollBarPosition());
+            query.addBindValue(parentPaths[node.parentId()] + PATH_SEPARATOR
+                               + QString::number(nodeId));
+            query.addBindValue(node.isPinnedNote() ? 1 : 0);
+            query.addBindValue(node.relativePosAN());
+            query.addBindValue(0);
+            query.addBindValue(notePreview(node));
+            ids.append(nodeId);
+            ++nodeId;
+        }
+        if (!query.exec()) {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            m_db.rollback();
+            return QVector<int>();
         }
-        emit childNotesCountUpdatedTag(id, childNotesCount);
     }
-    query.clear();
-    QMap<int, QString> folderIds;
-    query.prepare(R"(SELECT id, absolute_path )"
-                  R"(FROM node_table WHERE node_type=:node_type;)");
-    query.bindValue(":node_type", static_cast<int>(NodeData::Type::Folder));
-    status = query.exec();
-    if (status) {
-        while (query.next()) {
-            auto id = query.value(0).toInt();
-            if (id != SpecialNodeID::RootFolder) {
-                folderIds[id] = query.value(1).toString();
-            }
+    if (!m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        m_db.rollback();
+        return QVector<int>();
+    }
+
+    QSet<int> touchedFolders;
+    for (const auto &node : nodes) {
+        if (node.nodeType() == NodeData::Note) {
+            touchedFolders.insert(node.parentId());
         }
-    } else {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    for (const auto &id : folderIds.keys()) {
-        query.prepare(R"(SELECT count(*) FROM node_table )"
-                      R"(WHERE node_type = (:node_type) AND parent_id = (:parent_id);)");
-        query.bindValue(QStringLiteral(":parent_id"), id);
-        query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Note));
-        status = query.exec();
-        int childNotesCount = 0;
-        if (status) {
-            query.next();
-            childNotesCount = query.value(0).toInt();
-        } else {
+    if (!touchedFolders.isEmpty()) {
+        touchedFolders.insert(SpecialNodeID::RootFolder);
+    }
+    for (const auto &folderId : qAsConst(touchedFolders)) {
+        notifyChildNotesCountFolder(folderId);
+    }
+    return ids;
+}
+
+/*!
+ * \brief DBManager::createChildNotesCountTriggers
+ * Keeps child_notes_count of folders and tags up to date on every insert, delete or move,
+ * so it never has to be recounted. A folder counts its direct notes, the root folder counts
+ * every note outside the trash and a tag counts its relationships.
+ */
+void DBManager::createChildNotesCountTriggers()
+{
+    QSqlQuery query(m_db);
+    const QString noteType = QString::number(static_cast<int>(NodeData::Note));
+    const QString rootId = QString::number(SpecialNodeID::RootFolder);
+    const QString trashId = QString::number(SpecialNodeID::TrashFolder);
+    const QStringList triggers = {
+        R"(CREATE TRIGGER IF NOT EXISTS "child_notes_count_insert" AFTER INSERT ON "node_table" )"
+        R"(WHEN new.node_type = )" + noteType + R"( BEGIN )"
+        R"(UPDATE node_table SET child_notes_count = child_notes_count + 1 )"
+        R"(WHERE id = new.parent_id AND new.parent_id != )" + rootId + R"(; )"
+        R"(UPDATE node_table SET child_notes_count = child_notes_count + 1 )"
+        R"(WHERE id = )" + rootId + R"( AND new.parent_id != )" + trashId + R"(; )"
+        R"(END;)",
+        R"(CREATE TRIGGER IF NOT EXISTS "child_notes_count_delete" AFTER DELETE ON "node_table" )"
+        R"(WHEN old.node_type = )" + noteType + R"( BEGIN )"
+        R"(UPDATE node_table SET child_notes_count = max(child_notes_count - 1, 0) )"
+        R"(WHERE id = old.parent_id AND old.parent_id != )" + rootId + R"(; )"
+        R"(UPDATE node_table SET child_notes_count = max(child_notes_count - 1, 0) )"
+        R"(WHERE id = )" + rootId + R"( AND old.parent_id != )" + trashId + R"(; )"
+        R"(END;)",
+        R"(CREATE TRIGGER IF NOT EXISTS "child_notes_count_move" AFTER UPDATE OF parent_id ON "node_table" )"
+        R"(WHEN new.node_type = )" + noteType + R"( AND old.parent_id != new.parent_id BEGIN )"
+        R"(UPDATE node_table SET child_notes_count = max(child_notes_count - 1, 0) )"
+        R"(WHERE id = old.parent_id AND old.parent_id != )" + rootId + R"(; )"
+        R"(UPDATE node_table SET child_notes_count = child_notes_count + 1 )"
+        R"(WHERE id = new.parent_id AND new.parent_id != )" + rootId + R"(; )"
+        R"(UPDATE node_table SET child_notes_count = max(child_notes_count - 1, 0) )"
+        R"(WHERE id = )" + rootId + R"( AND new.parent_id = )" + trashId + R"(; )"
+        R"(UPDATE node_table SET child_notes_count = child_notes_count + 1 )"
+        R"(WHERE id = )" + rootId + R"( AND old.parent_id = )" + trashId + R"(; )"
+        R"(END;)",
+        R"(CREATE TRIGGER IF NOT EXISTS "child_notes_count_tag_insert" AFTER INSERT ON "tag_relationship" )"
+        R"(BEGIN )"
+        R"(UPDATE tag_table SET child_notes_count = child_notes_count + 1 WHERE id = new.tag_id; )"
+        R"(END;)",
+        R"(CREATE TRIGGER IF NOT EXISTS "child_notes_count_tag_delete" AFTER DELETE ON "tag_relationship" )"
+        R"(BEGIN )"
+        R"(UPDATE tag_table SET child_notes_count = max(child_notes_count - 1, 0) )"
+        R"(WHERE id = old.tag_id; )"
+        R"(END;)",
+    };
+    for (const auto &trigger : triggers) {
+        if (!query.exec(trigger)) {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
         query.clear();
-        query.prepare(QStringLiteral("UPDATE node_table SET child_notes_count = :child_notes_count "
-                                     "WHERE id = :id"));
-        query.bindValue(QStringLiteral(":id"), id);
-        query.bindValue(QStringLiteral(":child_notes_count"), childNotesCount);
-        status = query.exec();
-        if (!status) {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        }
-        emit childNotesCountUpdatedFolder(id, folderIds[id], childNotesCount);
     }
-    recalculateChildNotesCountAllNotes();
 }
 
-void DBManager::recalculateChildNotesCountFolder(int folderId)
+/*!
+ * \brief DBManager::verifyChildNotesCounts
+ * Compares the stored counters with the real counts in one query per table and only rewrites
+ * the ones that drifted, e.g. in a database written before the counting triggers existed.
+ * Also seeds the counters notifyChildNotesCountFolder and notifyChildNotesCountTag compare to.
+ */
+void DBManager::verifyChildNotesCounts()
 {
+    QVector<QPair<int, int>> wrongTags;
     QSqlQuery query(m_db);
-    query.prepare(R"(SELECT count(*) FROM node_table )"
-                  R"(WHERE node_type = (:node_type) AND parent_id = (:parent_id);)");
-    query.bindValue(QStringLiteral(":parent_id"), folderId);
-    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Note));
-    bool status = query.exec();
-    int childNotesCount = 0;
-    if (status) {
-        query.next();
-        childNotesCount = query.value(0).toInt();
+    query.prepare(R"(SELECT id, child_notes_count, )"
+                  R"((SELECT count(*) FROM tag_relationship WHERE tag_id = tag_table.id) )"
+                  R"(FROM tag_table;)");
+    if (query.exec()) {
+        while (query.next()) {
+            int id = query.value(0).toInt();
+            int childNotesCount = query.value(2).toInt();
+            m_tagChildNotesCounts[id] = childNotesCount;
+            if (query.value(1).toInt() != childNotesCount) {
+                wrongTags.append(qMakePair(id, childNotesCount));
+            }
+        }
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+
+    QVector<QPair<int, int>> wrongFolders;
+    QHash<int, QString> folderPaths;
+    query.prepare(R"(SELECT id, absolute_path, child_notes_count, )"
+                  R"(CASE WHEN id = :root_id THEN )"
+                  R"((SELECT count(*) FROM node_table AS n )"
+                  R"(WHERE n.node_type = :note_type AND n.parent_id != :trash_id) )"
+                  R"(ELSE (SELECT count(*) FROM node_table AS n )"
+                  R"(WHERE n.parent_id = node_table.id AND n.node_type = :note_type) END )"
+                  R"(FROM node_table WHERE node_type = :folder_type;)");
+    query.bindValue(QStringLiteral(":root_id"), static_cast<int>(SpecialNodeID::RootFolder));
+    query.bindValue(QStringLiteral(":trash_id"), static_cast<int>(SpecialNodeID::TrashFolder));
+    query.bindValue(QStringLiteral(":note_type"), static_cast<int>(NodeData::Note));
+    query.bindValue(QStringLiteral(":folder_type"), static_cast<int>(NodeData::Folder));
+    if (query.exec()) {
+        while (query.next()) {
+            int id = query.value(0).toInt();
+            int childNotesCount = query.value(3).toInt();
+            m_folderChildNotesCounts[id] = childNotesCount;
+            if (query.value(2).toInt() != childNotesCount) {
+                folderPaths[id] = query.value(1).toString();
+                wrongFolders.append(qMakePair(id, childNotesCount));
+            }
+        }
     } else {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     query.clear();
+
+    if (wrongTags.isEmpty() && wrongFolders.isEmpty()) {
+        return;
+    }
+    m_db.transaction();
+    query.prepare(QStringLiteral("UPDATE tag_table SET child_notes_count = :child_notes_count "
+                                 "WHERE id = :id"));
+    for (const auto &tag : qAsConst(wrongTags)) {
+        query.bindValue(QStringLiteral(":id"), tag.first);
+        query.bindValue(QStringLiteral(":child_notes_count"), tag.second);
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+    }
     query.prepare(QStringLiteral("UPDATE node_table SET child_notes_count = :child_notes_count "
                                  "WHERE id = :id"));
+    for (const auto &folder : qAsConst(wrongFolders)) {
+        query.bindValue(QStringLiteral(":id"), folder.first);
+        query.bindValue(QStringLiteral(":child_notes_count"), folder.second);
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+    }
+    m_db.commit();
+    for (const auto &tag : qAsConst(wrongTags)) {
+        emit childNotesCountUpdatedTag(tag.first, tag.second);
+    }
+    for (const auto &folder : qAsConst(wrongFolders)) {
+        emit childNotesCountUpdatedFolder(folder.first, folderPaths[folder.first], folder.second);
+    }
+}
+
+/*!
+ * \brief DBManager::notifyChildNotesCountFolder
+ * Reads the trigger-maintained counter of a folder and emits childNotesCountUpdatedFolder
+ * if it differs from the last value sent
+ * \param folderId
+ */
+void DBManager::notifyChildNotesCountFolder(int folderId)
+{
+    QSqlQuery &query =
+            cachedQuery(R"(SELECT child_notes_count, absolute_path FROM "node_table" WHERE id=:id)");
     query.bindValue(QStringLiteral(":id"), folderId);
-    query.bindValue(QStringLiteral(":child_notes_count"), childNotesCount);
-    status = query.exec();
-    if (!status) {
+    if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return;
+    }
+    bool hasRow = query.next();
+    int childNotesCount = query.value(0).toInt();
+    QString absolutePath = query.value(1).toString();
+    query.finish();
+    if (!hasRow) {
+        return;
+    }
+    auto it = m_folderChildNotesCounts.constFind(folderId);
+    if (it != m_folderChildNotesCounts.constEnd() && it.value() == childNotesCount) {
+        return;
     }
-    emit childNotesCountUpdatedFolder(folderId, getNodeAbsolutePath(folderId).path(),
-                                      childNotesCount);
+    m_folderChildNotesCounts[folderId] = childNotesCount;
+    emit childNotesCountUpdatedFolder(folderId, absolutePath, childNotesCount);
 }
 
-void DBManager::recalculateChildNotesCountTag(int tagId)
+/*!
+ * \brief DBManager::notifyChildNotesCountTag
+ * \param tagId
+ */
+void DBManager::notifyChildNotesCountTag(int tagId)
 {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT count(*) FROM tag_relationship WHERE tag_id=:id");
+    QSqlQuery &query = cachedQuery(R"(SELECT child_notes_count FROM "tag_table" WHERE id=:id)");
     query.bindValue(QStringLiteral(":id"), tagId);
-    bool status = query.exec();
-    int childNotesCount = 0;
-    if (status) {
-        query.next();
-        childNotesCount = query.value(0).toInt();
-    } else {
+    if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return;
     }
-    query.clear();
-    query.prepare(QStringLiteral("UPDATE tag_table SET child_notes_count = :child_notes_count "
-                                 "WHERE id = :id"));
-    query.bindValue(QStringLiteral(":id"), tagId);
-    query.bindValue(QStringLiteral(":child_notes_count"), childNotesCount);
-    status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    bool hasRow = query.next();
+    int childNotesCount = query.value(0).toInt();
+    query.finish();
+    if (!hasRow) {
+        return;
     }
+    auto it = m_tagChildNotesCounts.constFind(tagId);
+    if (it != m_tagChildNotesCounts.constEnd() && it.value() == childNotesCount) {
+        return;
+    }
+    m_tagChildNotesCounts[tagId] = childNotesCount;
     emit childNotesCountUpdatedTag(tagId, childNotesCount);
 }
 
-void DBManager::recalculateChildNotesCountAllNotes()
-{
-    QSqlQuery query(m_db);
-    query.prepare(R"(SELECT count(*) FROM node_table )"
-                  R"(WHERE node_type = (:node_type) AND parent_id != (:parent_id);)");
-    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Note));
-    query.bindValue(QStringLiteral(":parent_id"), static_cast<int>(SpecialNodeID::TrashFolder));
-    bool status = query.exec();
-    int childNotesCount = 0;
-    if (status) {
-        query.next();
-        childNotesCount = query.value(0).toInt();
-    } else {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    query.clear();
-    query.prepare(QStringLiteral("UPDATE node_table SET child_notes_count = :child_notes_count "
-                                 "WHERE id = :id"));
-    query.bindValue(QStringLiteral(":id"), SpecialNodeID::RootFolder);
-    query.bindValue(QStringLiteral(":child_notes_count"), childNotesCount);
-    status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    emit childNotesCountUpdatedFolder(SpecialNodeID::RootFolder,
-                                      getNodeAbsolutePath(SpecialNodeID::RootFolder).path(),
-                                      childNotesCount);
-}
-
-void DBManager::increaseChildNotesCountTag(int tagId)
-{
-    QSqlQuery query(m_db);
-    query.prepare(R"(SELECT child_notes_count FROM "tag_table" WHERE id=:id)");
-    query.bindValue(QStringLiteral(":id"), tagId);
-    bool status = query.exec();
-    int childNotesCount = 0;
-    if (status) {
-        query.next();
-        childNotesCount = query.value(0).toInt();
-    } else {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        return;
-    }
-    query.clear();
-    childNotesCount += 1;
-
-    query.prepare(QStringLiteral("UPDATE tag_table SET child_notes_count = :child_notes_count "
-                                 "WHERE id = :id"));
-    query.bindValue(QStringLiteral(":id"), tagId);
-    query.bindValue(QStringLiteral(":child_notes_count"), childNotesCount);
-    status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    emit childNotesCountUpdatedTag(tagId, childNotesCount);
-}
-
-void DBManager::decreaseChildNotesCountTag(int tagId)
-{
-    QSqlQuery query(m_db);
-    query.prepare(R"(SELECT child_notes_count FROM "tag_table" WHERE id=:id)");
-    query.bindValue(QStringLiteral(":id"), tagId);
-    bool status = query.exec();
-    int childNoteCount = 0;
-    if (status) {
-        query.next();
-        childNoteCount = query.value(0).toInt();
-    } else {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        return;
-    }
-    query.clear();
-    childNoteCount -= 1;
-    if (childNoteCount < 0) {
-        childNoteCount = 0;
-    }
-
-    query.prepare(QStringLiteral("UPDATE tag_table SET child_notes_count = :child_notes_count "
-                                 "WHERE id = :id"));
-    query.bindValue(QStringLiteral(":id"), tagId);
-    query.bindValue(QStringLiteral(":child_notes_count"), childNoteCount);
-    status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    emit childNotesCountUpdatedTag(tagId, childNoteCount);
-}
-
-void DBManager::increaseChildNotesCountFolder(int folderId)
-{
-    QSqlQuery query(m_db);
-    query.prepare(R"(SELECT child_notes_count, absolute_path  FROM "node_table" WHERE id=:id)");
-    query.bindValue(QStringLiteral(":id"), folderId);
-    bool status = query.exec();
-    int childNotesCount = 0;
-    QString absPath;
-    if (status) {
-        query.next();
-        childNotesCount = query.value(0).toInt();
-        absPath = query.value(1).toString();
-    } else {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        return;
-    }
-    query.clear();
-    childNotesCount += 1;
-
-    query.prepare(QStringLiteral("UPDATE node_table SET child_notes_count = :child_notes_count "
-                                 "WHERE id = :id"));
-    query.bindValue(QStringLiteral(":id"), folderId);
-    query.bindValue(QStringLiteral(":child_notes_count"), childNotesCount);
-    status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    emit childNotesCountUpdatedFolder(folderId, absPath, childNotesCount);
-}
-
-void DBManager::decreaseChildNotesCountFolder(int folderId)
-{
-    QSqlQuery query(m_db);
-    query.prepare(R"(SELECT child_notes_count, absolute_path  FROM "node_table" WHERE id=:id)");
-    query.bindValue(QStringLiteral(":id"), folderId);
-    bool status = query.exec();
-    int childNotesCount = 0;
-    QString absPath;
-    if (status) {
-        query.next();
-        childNotesCount = query.value(0).toInt();
-        absPath = query.value(1).toString();
-    } else {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        return;
-    }
-    query.clear();
-    childNotesCount -= 1;
-    if (childNotesCount < 0) {
-        childNotesCount = 0;
-    }
-
-    query.prepare(QStringLiteral("UPDATE node_table SET child_notes_count = :child_notes_count "
-                                 "WHERE id = :id"));
-    query.bindValue(QStringLiteral(":id"), folderId);
-    query.bindValue(QStringLiteral(":child_notes_count"), childNotesCount);
-    status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    emit childNotesCountUpdatedFolder(folderId, absPath, childNotesCount);
-}
-
-int DBManager::addTag(const TagData &tag)
+int DBManager::addTag(const TagData &tag)
 {
+    assertOnDatabaseThread(__FUNCTION__);
+    bool isOwnTransaction = m_db.transaction();
     QSqlQuery query(m_db);
 
     int relationalPosition = 0;
@@ -694,7 +1509,7 @@ int DBManager::addTag(const TagData &tag)
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     query.finish();
-    int id = nextAvailableTagId();
+    int id = reserveTagIds(1);
 
     QString queryStr = R"(INSERT INTO "tag_table" )"
                        R"(("id","name","color","relative_position","child_notes_count") )"
@@ -709,11 +1524,8 @@ int DBManager::addTag(const TagData &tag)
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     query.finish();
-
-    query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_tag_id';)");
-    query.bindValue(":value", id + 1);
-    if (!query.exec()) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    if (isOwnTransaction) {
+        m_db.commit();
     }
     auto newTag = tag;
     newTag.setId(id);
@@ -723,60 +1535,52 @@ int DBManager::addTag(const TagData &tag)
 
 void DBManager::addNoteToTag(int noteId, int tagId)
 {
-    QSqlQuery query(m_db);
-    query.prepare(
+    QSqlQuery &query = cachedQuery(
             R"(INSERT OR IGNORE INTO "tag_relationship" ("node_id","tag_id") VALUES (:note_id, :tag_id);)");
     query.bindValue(":note_id", noteId);
     query.bindValue(":tag_id", tagId);
     if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    recalculateChildNotesCountTag(tagId);
+    notifyChildNotesCountTag(tagId);
 }
 
 void DBManager::removeNoteFromTag(int noteId, int tagId)
 {
-    QSqlQuery query(m_db);
-    query.prepare(R"(DELETE FROM "tag_relationship" )"
-                  R"(WHERE node_id = (:note_id) AND tag_id = (:tag_id);)");
+    QSqlQuery &query = cachedQuery(R"(DELETE FROM "tag_relationship" )"
+                                   R"(WHERE node_id = (:note_id) AND tag_id = (:tag_id);)");
     query.bindValue(":note_id", noteId);
     query.bindValue(":tag_id", tagId);
     if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    decreaseChildNotesCountTag(tagId);
+    notifyChildNotesCountTag(tagId);
 }
 
+/*!
+ * \brief DBManager::nextAvailableNodeId
+ * Id the next addNode will use, without taking it
+ */
 int DBManager::nextAvailableNodeId()
 {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT value FROM metadata WHERE key = :key");
-    query.bindValue(":key", "next_node_id");
-    if (!query.exec()) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    assertOnDatabaseThread(__FUNCTION__);
+    if (m_nextNodeId < 0) {
+        loadIdCounters();
     }
-    query.last();
-    int nodeId = query.value(0).toInt();
-    return nodeId;
+    return m_nextNodeId;
 }
 
 int DBManager::nextAvailableTagId()
 {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT value FROM metadata WHERE key = :key");
-    query.bindValue(":key", "next_tag_id");
-    if (!query.exec()) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    if (m_nextTagId < 0) {
+        loadIdCounters();
     }
-    query.last();
-    int nodeId = query.value(0).toInt();
-    return nodeId;
+    return m_nextTagId;
 }
 
 void DBManager::renameNode(int id, const QString &newName)
 {
-    QSqlQuery query(m_db);
-    query.prepare(R"(UPDATE "node_table" SET "title"=:title WHERE "id"=:id;)");
+    QSqlQuery &query = cachedQuery(R"(UPDATE "node_table" SET "title"=:title WHERE "id"=:id;)");
     query.bindValue(":title", newName);
     query.bindValue(":id", id);
     if (!query.exec()) {
@@ -816,6 +1620,7 @@ void DBManager::changeTagColor(int id, const QString &newColor)
 void DBManager::removeNote(const NodeData &note)
 {
     if (note.parentId() == SpecialNodeID::TrashFolder) {
+        auto tagIds = getAllTagForNote(note.id());
         QSqlQuery query(m_db);
         query.prepare(R"(DELETE FROM "node_table" )"
                       R"(WHERE id = (:id) AND node_type = (:node_type);)");
@@ -831,8 +1636,9 @@ void DBManager::removeNote(const NodeData &note)
         if (!query.exec()) {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
-        if (note.nodeType() == NodeData::Note) {
-            decreaseChildNotesCountFolder(SpecialNodeID::TrashFolder);
+        notifyChildNotesCountFolder(SpecialNodeID::TrashFolder);
+        for (const auto &tagId : qAsConst(tagIds)) {
+            notifyChildNotesCountTag(tagId);
         }
     } else {
         auto trashFolder = getNode(SpecialNodeID::TrashFolder);
@@ -850,12 +1656,14 @@ void DBManager::removeTag(int tagId)
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     query.clear();
-    query.prepare(R"(DELETE FROM "tag_relationship" )"
-                  R"(WHERE tag_id = (:id);)");
-    query.bindValue(QStringLiteral(":id"), tagId);
-    if (!query.exec()) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
+    QSqlQuery &relationshipQuery =
+            cachedQuery(R"(DELETE FROM "tag_relationship" WHERE tag_id = (:id);)");
+    relationshipQuery.bindValue(QStringLiteral(":id"), tagId);
+    if (!relationshipQuery.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << relationshipQuery.lastError();
+    }
+    relationshipQuery.finish();
+    m_tagChildNotesCounts.remove(tagId);
     emit tagRemoved(tagId);
 }
 
@@ -866,7 +1674,6 @@ void DBManager::removeTag(int tagId)
  */
 bool DBManager::updateNoteContent(const NodeData &note)
 {
-    QSqlQuery query(m_db);
     QString emptyStr;
 
     int id = note.id();
@@ -878,20 +1685,23 @@ bool DBManager::updateNoteContent(const NodeData &note)
     QString content = note.content().replace(QChar('\x0'), emptyStr);
     QString fullTitle = note.fullTitle().replace(QChar('\x0'), emptyStr);
 
-    query.prepare(QStringLiteral(
+    QSqlQuery &query = cachedQuery(QStringLiteral(
             "UPDATE node_table SET modification_date = :modification_date, content = :content, "
-            "title = :title, scrollbar_position = :scrollbar_position WHERE id = :id AND node_type "
-            "= :node_type;"));
+            "title = :title, scrollbar_position = :scrollbar_position, preview = :preview "
+            "WHERE id = :id AND node_type = :node_type;"));
     query.bindValue(QStringLiteral(":modification_date"), epochTimeDateModified);
     query.bindValue(QStringLiteral(":content"), content);
     query.bindValue(QStringLiteral(":title"), fullTitle);
     query.bindValue(QStringLiteral(":id"), id);
     query.bindValue(QStringLiteral(":scrollbar_position"), note.scrollBarPosition());
+    query.bindValue(QStringLiteral(":preview"), notePreview(note));
     query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Note));
     if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    return (query.numRowsAffected() == 1);
+    bool isUpdated = query.numRowsAffected() == 1;
+    query.finish();
+    return isUpdated;
 }
 
 QList<NodeData> DBManager::readOldNBK(const QString &fileName)
@@ -937,11 +1747,11 @@ QList<NodeData> DBManager::readOldNBK(const QString &fileName)
 
 int DBManager::nextAvailablePosition(int parentId, NodeData::Type nodeType)
 {
-    QSqlQuery query(m_db);
     int relationalPosition = 0;
     if (parentId != -1) {
-        query.prepare(R"(SELECT relative_position FROM "node_table" )"
-                      R"(WHERE parent_id = :parent_id AND node_type = :node_type;)");
+        QSqlQuery &query =
+                cachedQuery(R"(SELECT relative_position FROM "node_table" )"
+                            R"(WHERE parent_id = :parent_id AND node_type = :node_type;)");
         query.bindValue(":parent_id", parentId);
         query.bindValue(":node_type", static_cast<int>(nodeType));
         bool status = query.exec();
@@ -961,37 +1771,38 @@ int DBManager::nextAvailablePosition(int parentId, NodeData::Type nodeType)
 
 NodePath DBManager::getNodeAbsolutePath(int nodeId)
 {
-    QSqlQuery query(m_db);
-    query.prepare("SELECT absolute_path FROM node_table WHERE id = :id");
+    QSqlQuery &query =
+            cachedQuery(QStringLiteral("SELECT absolute_path FROM node_table WHERE id = :id"));
     query.bindValue(":id", nodeId);
     bool status = query.exec();
     if (!status) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError() << query.isValid();
     }
-    query.last();
+    query.next();
     auto absolutePath = query.value(0).toString();
+    query.finish();
     return absolutePath;
 }
 
 NodeData DBManager::getNode(int nodeId)
 {
-    QSqlQuery query(m_db);
-    query.prepare(R"(SELECT)"
-                  R"("id",)"
-                  R"("title",)"
-                  R"("creation_date",)"
-                  R"("modification_date",)"
-                  R"("deletion_date",)"
-                  R"("content",)"
-                  R"("node_type",)"
-                  R"("parent_id",)"
-                  R"("relative_position",)"
-                  R"("scrollbar_position",)"
-                  R"("absolute_path", )"
-                  R"("is_pinned_note", )"
-                  R"("relative_position_an", )"
-                  R"("child_notes_count" )"
-                  R"(FROM node_table WHERE id=:id LIMIT 1;)");
+    assertOnDatabaseThread(__FUNCTION__);
+    QSqlQuery &query = cachedQuery(R"(SELECT)"
+                                   R"("id",)"
+                                   R"("title",)"
+                                   R"("creation_date",)"
+                                   R"("modification_date",)"
+                                   R"("deletion_date",)"
+                                   R"("content",)"
+                                   R"("node_type",)"
+                                   R"("parent_id",)"
+                                   R"("relative_position",)"
+                                   R"("scrollbar_position",)"
+                                   R"("absolute_path", )"
+                                   R"("is_pinned_note", )"
+                                   R"("relative_position_an", )"
+                                   R"("child_notes_count" )"
+                                   R"(FROM node_table WHERE id=:id LIMIT 1;)");
     query.bindValue(":id", nodeId);
     bool status = query.exec();
     if (status) {
@@ -1012,12 +1823,13 @@ NodeData DBManager::getNode(int nodeId)
         node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
         node.setRelativePosAN(query.value(13).toInt());
         node.setRelativePosAN(query.value(14).toInt());
+        // reset before the nested lookups, they may run cached statements of their own
+        query.finish();
         if (node.nodeType() == NodeData::Note) {
             node.setTagIds(getAllTagForNote(node.id()));
-            QSqlQuery query2(m_db);
-            query2.prepare(R"(SELECT)"
-                           R"("title" )"
-                           R"(FROM node_table WHERE id=:id LIMIT 1;)");
+            QSqlQuery &query2 = cachedQuery(R"(SELECT)"
+                                            R"("title" )"
+                                            R"(FROM node_table WHERE id=:id LIMIT 1;)");
             query2.bindValue(":id", node.parentId());
             if (query2.exec()) {
                 query2.next();
@@ -1025,6 +1837,7 @@ NodeData DBManager::getNode(int nodeId)
             } else {
                 qDebug() << __FUNCTION__ << __LINE__ << query2.lastError();
             }
+            query2.finish();
         }
         return node;
     } else {
@@ -1035,49 +1848,123 @@ NodeData DBManager::getNode(int nodeId)
     return NodeData();
 }
 
+QString DBManager::getNoteContent(int noteId)
+{
+    assertOnDatabaseThread(__FUNCTION__);
+    QSqlQuery &query = cachedQuery(R"(SELECT "content" FROM node_table WHERE id=:id LIMIT 1;)");
+    query.bindValue(":id", noteId);
+    QString content;
+    if (query.exec() && query.next()) {
+        content = query.value(0).toString();
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.finish();
+    return content;
+}
+
+/*!
+ * \brief DBManager::getNoteContents
+ * Bodies of \a noteIds by id, read in one transaction. Ids that no longer exist are missing
+ * from the result.
+ */
+QHash<int, QString> DBManager::getNoteContents(const QVector<int> &noteIds)
+{
+    assertOnDatabaseThread(__FUNCTION__);
+    // stays below SQLite's historical 999 host parameter limit
+    static const int idsPerStatement = 500;
+    QHash<int, QString> contents;
+    contents.reserve(noteIds.size());
+    m_db.transaction();
+    QSqlQuery query(m_db);
+    for (int start = 0; start < noteIds.size(); start += idsPerStatement) {
+        int idCount = qMin(idsPerStatement, static_cast<int>(noteIds.size()) - start);
+        QStringList placeholders;
+        for (int i = 0; i < idCount; ++i) {
+            placeholders.append(QStringLiteral("?"));
+        }
+        query.prepare(QStringLiteral(R"(SELECT "id", "content" FROM node_table WHERE id IN (%1);)")
+                              .arg(placeholders.join(QStringLiteral(", "))));
+        for (int i = start; i < start + idCount; ++i) {
+            query.addBindValue(noteIds[i]);
+        }
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            continue;
+        }
+        while (query.next()) {
+            contents.insert(query.value(0).toInt(), query.value(1).toString());
+        }
+    }
+    m_db.commit();
+    return contents;
+}
+
 void DBManager::moveFolderToTrash(const NodeData &node)
 {
     QSqlQuery query(m_db);
     QString parentPath = node.absolutePath() + PATH_SEPARATOR;
-    query.prepare(R"(SELECT id FROM "node_table" )"
-                  R"(WHERE absolute_path like (:path_expr) || '%' AND node_type = (:node_type);)");
+    auto trashFolder = getNode(SpecialNodeID::TrashFolder);
+    // the notes, the subfolders and the folder go together, a half applied trash leaves
+    // notes under a folder that is gone
+    bool isOwnTransaction = m_db.transaction();
+    auto abort = [this, isOwnTransaction]() {
+        if (isOwnTransaction) {
+            m_db.rollback();
+        }
+    };
+    // every note of the subtree goes straight under the trash in one statement
+    query.prepare(R"(UPDATE "node_table" SET parent_id = :trash_id, )"
+                  R"(absolute_path = :trash_path || id, is_pinned_note = 0, )"
+                  R"(deletion_date = :deletion_date )"
+                  R"(WHERE absolute_path >= (:path_expr) AND absolute_path < (:path_end) )"
+                  R"(AND node_type = (:node_type);)");
+    query.bindValue(QStringLiteral(":trash_id"), trashFolder.id());
+    query.bindValue(QStringLiteral(":trash_path"), trashFolder.absolutePath() + PATH_SEPARATOR);
+    query.bindValue(QStringLiteral(":deletion_date"), QDateTime::currentMSecsSinceEpoch());
     query.bindValue(QStringLiteral(":path_expr"), parentPath);
+    query.bindValue(QStringLiteral(":path_end"), pathPrefixEnd(parentPath));
     query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Note));
-    bool status = query.exec();
-    QSet<int> childIds;
-    if (status) {
-        while (query.next()) {
-            childIds.insert(query.value(0).toInt());
-        }
-    } else {
+    if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        abort();
+        return;
     }
     query.clear();
-    auto trashFolder = getNode(SpecialNodeID::TrashFolder);
-    for (const auto &id : childIds) {
-        moveNode(id, trashFolder);
-    }
     query.prepare(R"(DELETE FROM "node_table" )"
-                  R"(WHERE absolute_path like (:path_expr) || '%' AND node_type = (:node_type);)");
+                  R"(WHERE absolute_path >= (:path_expr) AND absolute_path < (:path_end) )"
+                  R"(AND node_type = (:node_type);)");
     query.bindValue(QStringLiteral(":path_expr"), parentPath);
+    query.bindValue(QStringLiteral(":path_end"), pathPrefixEnd(parentPath));
     query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Folder));
-    status = query.exec();
-    if (!status) {
+    if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        abort();
+        return;
     }
     query.clear();
     query.prepare(R"(DELETE FROM "node_table" )"
-                  R"(WHERE absolute_path like (:path_expr) AND node_type = (:node_type);)");
+                  R"(WHERE absolute_path = (:path_expr) AND node_type = (:node_type);)");
     query.bindValue(QStringLiteral(":path_expr"), node.absolutePath());
     query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Folder));
-    status = query.exec();
-    if (!status) {
+    if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        abort();
+        return;
     }
+    query.clear();
+    if (isOwnTransaction && !m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        m_db.rollback();
+        return;
+    }
+    notifyChildNotesCountFolder(SpecialNodeID::TrashFolder);
+    notifyChildNotesCountFolder(SpecialNodeID::RootFolder);
 }
 
 FolderListType DBManager::getFolderList()
 {
+    assertOnDatabaseThread(__FUNCTION__);
     QMap<int, QString> result;
     QSqlQuery query(m_db);
     query.prepare(
@@ -1104,6 +1991,9 @@ void DBManager::moveNode(int nodeId, const NodeData &target)
     auto node = getNode(nodeId);
 
     QString newAbsolutePath = target.absolutePath() + PATH_SEPARATOR + QString::number(nodeId);
+    // the folder row and its subtree must move together, a half applied move leaves
+    // descendants pointing at a path that no longer exists
+    bool isOwnTransaction = m_db.transaction();
     if (target.id() == SpecialNodeID::TrashFolder) {
         qint64 deletionTime = QDateTime::currentMSecsSinceEpoch();
         query.prepare(QStringLiteral(
@@ -1126,314 +2016,275 @@ void DBManager::moveNode(int nodeId, const NodeData &target)
     bool status = query.exec();
     if (!status) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError() << query.lastQuery();
+        if (isOwnTransaction) {
+            m_db.rollback();
+        }
+        return;
     }
 
     if (node.nodeType() == NodeData::Folder) {
-        QString oldAbsolutePath = node.absolutePath();
-        QMap<int, QString> children;
+        // absolute_path is a materialized path, so the whole subtree is one index range and
+        // can be re-rooted with a single statement instead of one UPDATE per descendant
+        QString oldPrefix = node.absolutePath() + PATH_SEPARATOR;
+        QString newPrefix = newAbsolutePath + PATH_SEPARATOR;
         query.clear();
-        query.prepare(R"(SELECT id, absolute_path FROM "node_table" )"
-                      R"(WHERE absolute_path like (:path_expr) || '%';)");
-        query.bindValue(QStringLiteral(":path_expr"), oldAbsolutePath);
-        if (query.exec()) {
-            while (query.next()) {
-                if (query.value(0).toInt() != node.id()) {
-                    children[query.value(0).toInt()] = query.value(1).toString();
-                }
-            }
+        if (target.id() == SpecialNodeID::TrashFolder) {
+            query.prepare(QStringLiteral(
+                    "UPDATE node_table SET "
+                    "absolute_path = :new_prefix || substr(absolute_path, :old_length + 1), "
+                    "is_pinned_note = :is_pinned_note, deletion_date = :deletion_date "
+                    "WHERE absolute_path >= :path_expr AND absolute_path < :path_end;"));
+            query.bindValue(QStringLiteral(":is_pinned_note"), false);
+            query.bindValue(QStringLiteral(":deletion_date"), QDateTime::currentMSecsSinceEpoch());
         } else {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            query.prepare(QStringLiteral(
+                    "UPDATE node_table SET "
+                    "absolute_path = :new_prefix || substr(absolute_path, :old_length + 1) "
+                    "WHERE absolute_path >= :path_expr AND absolute_path < :path_end;"));
         }
-        for (const auto id : children.keys()) {
-            QString oldP = children[id];
-            QString newP = oldP.replace(oldP.indexOf(oldAbsolutePath), oldAbsolutePath.size(),
-                                        newAbsolutePath);
-            if (target.id() == SpecialNodeID::TrashFolder) {
-                qint64 deletionTime = QDateTime::currentMSecsSinceEpoch();
-                query.prepare(QStringLiteral(
-                        "UPDATE node_table SET absolute_path = :absolute_path, is_pinned_note = "
-                        ":is_pinned_note, deletion_date = :deletion_date "
-                        "WHERE id = :id;"));
-                query.bindValue(QStringLiteral(":absolute_path"), newP);
-                query.bindValue(QStringLiteral(":id"), id);
-                query.bindValue(QStringLiteral(":is_pinned_note"), false);
-                query.bindValue(QStringLiteral(":deletion_date"), deletionTime);
-            } else {
-                query.prepare(QStringLiteral("UPDATE node_table SET absolute_path = :absolute_path "
-                                             "WHERE id = :id;"));
-                query.bindValue(QStringLiteral(":absolute_path"), newP);
-                query.bindValue(QStringLiteral(":id"), id);
-            }
-            if (!query.exec()) {
-                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-            }
-        }
-        recalculateChildNotesCount();
-    } else {
-        decreaseChildNotesCountFolder(node.parentId());
-        if (node.parentId() != SpecialNodeID::TrashFolder
-            && target.id() == SpecialNodeID::TrashFolder) {
-            decreaseChildNotesCountFolder(SpecialNodeID::RootFolder);
-            auto allTagInNote = getAllTagForNote(node.id());
-            for (const auto &tagId : qAsConst(allTagInNote)) {
-                decreaseChildNotesCountTag(tagId);
-            }
-        } else if (node.parentId() == SpecialNodeID::TrashFolder
-                   && target.id() != SpecialNodeID::TrashFolder) {
-            increaseChildNotesCountFolder(SpecialNodeID::RootFolder);
-            auto allTagInNote = getAllTagForNote(node.id());
-            for (const auto &tagId : qAsConst(allTagInNote)) {
-                increaseChildNotesCountTag(tagId);
+        query.bindValue(QStringLiteral(":new_prefix"), newPrefix);
+        query.bindValue(QStringLiteral(":old_length"), oldPrefix.size());
+        query.bindValue(QStringLiteral(":path_expr"), oldPrefix);
+        query.bindValue(QStringLiteral(":path_end"), pathPrefixEnd(oldPrefix));
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            if (isOwnTransaction) {
+                m_db.rollback();
             }
+            return;
         }
-        increaseChildNotesCountFolder(target.id());
+    }
+    if (isOwnTransaction && !m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        m_db.rollback();
+        return;
+    }
+
+    // notes keep their parent when a folder moves, so only a note move changes counters
+    if (node.nodeType() != NodeData::Folder) {
+        notifyChildNotesCountFolder(node.parentId());
+        notifyChildNotesCountFolder(target.id());
+        notifyChildNotesCountFolder(SpecialNodeID::RootFolder);
     }
 }
 
 void DBManager::searchForNotes(const QString &keyword, const ListViewInfo &inf)
 {
-    QVector<NodeData> nodeList;
-    QSqlQuery query(m_db);
+    if (isListRequestStale(inf.requestId)) {
+        return;
+    }
+    bool useFullTextIndex = canUseFullTextIndex(keyword);
+    QString searchClause = useFullTextIndex
+            ? QStringLiteral("id IN (SELECT rowid FROM note_fts WHERE note_fts MATCH (:search_expr))")
+            : QStringLiteral("content like  '%' || (:search_expr) || '%'");
+    QMap<QString, QVariant> bindValues;
+    bindValues[QStringLiteral(":node_type")] = static_cast<int>(NodeData::Note);
+    bindValues[QStringLiteral(":search_expr")] =
+            useFullTextIndex ? fullTextMatchExpression(keyword) : keyword;
+    QString condition;
     if (!inf.isInTag && inf.parentFolderId == SpecialNodeID::RootFolder) {
-        query.prepare(R"(SELECT )"
-                      R"("id",)"
-                      R"("title",)"
-                      R"("creation_date",)"
-                      R"("modification_date",)"
-                      R"("deletion_date",)"
-                      R"("content",)"
-                      R"("node_type",)"
-                      R"("parent_id",)"
-                      R"("relative_position", )"
-                      R"("scrollbar_position",)"
-                      R"("absolute_path", )"
-                      R"("is_pinned_note", )"
-                      R"("relative_position_an", )"
-                      R"("child_notes_count" )"
-                      R"(FROM node_table )"
-                      R"(WHERE node_type = (:node_type) AND parent_id != (:parent_id) )"
-                      R"(AND content like  '%' || (:search_expr) || '%';)");
-        query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Note));
-        query.bindValue(QStringLiteral(":parent_id"), static_cast<int>(SpecialNodeID::TrashFolder));
-        query.bindValue(QStringLiteral(":search_expr"), keyword);
-
-        bool status = query.exec();
-        if (status) {
-            while (query.next()) {
-                NodeData node;
-                node.setId(query.value(0).toInt());
-                node.setFullTitle(query.value(1).toString());
-                node.setCreationDateTime(
-                        QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
-                node.setLastModificationDateTime(
-                        QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
-                node.setDeletionDateTime(
-                        QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-                node.setContent(query.value(5).toString());
-                node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
-                node.setParentId(query.value(7).toInt());
-                node.setRelativePosition(query.value(8).toInt());
-                node.setScrollBarPosition(query.value(9).toInt());
-                node.setAbsolutePath(query.value(10).toString());
-                node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
-                node.setRelativePosAN(query.value(13).toInt());
-                node.setChildNotesCount(query.value(14).toInt());
-                node.setTagIds(getAllTagForNote(node.id()));
-                auto p = getNode(node.parentId());
-                node.setParentName(p.fullTitle());
-                nodeList.append(node);
-            }
-        } else {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        }
+        bindValues[QStringLiteral(":parent_id")] = static_cast<int>(SpecialNodeID::TrashFolder);
+        condition = QStringLiteral("node_type = (:node_type) AND parent_id != (:parent_id) AND ")
+                + searchClause;
     } else if (!inf.isInTag) {
-        query.prepare(R"(SELECT )"
-                      R"("id",)"
-                      R"("title",)"
-                      R"("creation_date",)"
-                      R"("modification_date",)"
-                      R"("deletion_date",)"
-                      R"("content",)"
-                      R"("node_type",)"
-                      R"("parent_id",)"
-                      R"("relative_position", )"
-                      R"("scrollbar_position",)"
-                      R"("absolute_path", )"
-                      R"("is_pinned_note", )"
-                      R"("relative_position_an", )"
-                      R"("child_notes_count" )"
-                      R"(FROM node_table )"
-                      R"(WHERE node_type = (:node_type) AND parent_id == (:parent_id) )"
-                      R"(AND content like  '%' || (:search_expr) || '%';)");
-        query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Note));
-        query.bindValue(QStringLiteral(":parent_id"), static_cast<int>(inf.parentFolderId));
-        query.bindValue(QStringLiteral(":search_expr"), keyword);
-
-        bool status = query.exec();
-        if (status) {
-            while (query.next()) {
-                NodeData node;
-                node.setId(query.value(0).toInt());
-                node.setFullTitle(query.value(1).toString());
-                node.setCreationDateTime(
-                        QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
-                node.setLastModificationDateTime(
-                        QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
-                node.setDeletionDateTime(
-                        QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-                node.setContent(query.value(5).toString());
-                node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
-                node.setParentId(query.value(7).toInt());
-                node.setRelativePosition(query.value(8).toInt());
-                node.setScrollBarPosition(query.value(9).toInt());
-                node.setAbsolutePath(query.value(10).toString());
-                node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
-                node.setRelativePosAN(query.value(13).toInt());
-                node.setChildNotesCount(query.value(14).toInt());
-                node.setTagIds(getAllTagForNote(node.id()));
-                auto p = getNode(node.parentId());
-                node.setParentName(p.fullTitle());
-                nodeList.append(node);
-            }
-        } else {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        }
+        bindValues[QStringLiteral(":parent_id")] = static_cast<int>(inf.parentFolderId);
+        condition = QStringLiteral("node_type = (:node_type) AND parent_id == (:parent_id) AND ")
+                + searchClause;
     } else if (inf.isInTag) {
-        QVector<QSet<int>> nds;
-        for (const auto &tagId : inf.currentTagList) {
-            QSet<int> nd;
-            query.prepare(R"(SELECT "node_id" FROM tag_relationship WHERE tag_id = :tag_id;)");
-            query.bindValue(QStringLiteral(":tag_id"), tagId);
-            bool status = query.exec();
-            if (status) {
-                while (query.next()) {
-                    nd.insert(query.value(0).toInt());
-                }
-            } else {
-                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-            }
-            nds.append(nd);
-        }
-        if (nds.size() == 0) {
-            emit notesListReceived(nodeList, inf);
+        if (inf.currentTagList.isEmpty()) {
+            emit notesListReceived(QVector<NodeData>(), inf);
             return;
         }
-        QSet<int> noteIds;
-        int nds_id = 0;
-        for (int i = 1; i < nds.size(); ++i) {
-            if (nds[i].size() < nds[nds_id].size()) {
-                nds_id = i;
-            }
-        }
-        for (const int id : qAsConst(nds[nds_id])) {
-            bool ok = true;
-            for (int i = 0; i < nds.size(); ++i) {
-                if (i == nds_id) {
-                    continue;
-                }
-                if (!nds[i].contains(id)) {
-                    ok = false;
-                }
-            }
-            if (ok) {
-                noteIds.insert(id);
-            }
-        }
-        for (const auto &id : noteIds) {
-            NodeData node = getNode(id);
-            if (node.id() != SpecialNodeID::InvalidNodeId && node.nodeType() == NodeData::Note
-                && node.content().contains(keyword)) {
-                nodeList.append(node);
-            } else {
-                qDebug() << __FUNCTION__ << "Note with id" << id << "is not valid";
-            }
-        }
+        condition = QStringLiteral("node_type = (:node_type) AND ")
+                + tagFilterClause(inf.currentTagList, bindValues) + QStringLiteral(" AND ")
+                + searchClause;
     } else {
         qDebug() << __FUNCTION__ << __LINE__ << "not supported";
     }
-    ListViewInfo _inf = inf;
-    _inf.isInSearch = true;
-    std::sort(nodeList.begin(), nodeList.end(), [](const NodeData &a, const NodeData &b) -> bool {
-        return a.lastModificationdateTime() > b.lastModificationdateTime();
+    runOnReader([this, condition, bindValues, inf](QSqlDatabase &db) {
+        QVector<NodeData> nodeList;
+        if (!condition.isEmpty()) {
+            nodeList = getNoteList(db, condition, bindValues, inf.requestId);
+        }
+        if (isListRequestStale(inf.requestId)) {
+            return;
+        }
+        ListViewInfo _inf = inf;
+        _inf.isInSearch = true;
+        std::sort(nodeList.begin(), nodeList.end(),
+                  [](const NodeData &a, const NodeData &b) -> bool {
+                      return a.lastModificationdateTime() > b.lastModificationdateTime();
+                  });
+        emit notesListReceived(nodeList, _inf);
     });
-    emit notesListReceived(nodeList, _inf);
 }
 
 void DBManager::clearSearch(const ListViewInfo &inf)
 {
     if (inf.isInTag) {
-        onNotesListInTagsRequested(inf.currentTagList, inf.needCreateNewNote, inf.scrollToId);
+        onNotesListInTagsRequested(inf.currentTagList, inf.needCreateNewNote, inf.scrollToId,
+                                   inf.requestId);
     } else {
         if (inf.parentFolderId == SpecialNodeID::RootFolder) {
             onNotesListInFolderRequested(inf.parentFolderId, true, inf.needCreateNewNote,
-                                         inf.scrollToId);
+                                         inf.scrollToId, inf.requestId);
         } else {
             onNotesListInFolderRequested(inf.parentFolderId, false, inf.needCreateNewNote,
-                                         inf.scrollToId);
+                                         inf.scrollToId, inf.requestId);
         }
     }
 }
 
-void DBManager::updateRelPosNode(int nodeId, int relPos)
+/*!
+ * \brief DBManager::sparsePositions
+ * Picks new positions for a list whose order changed while touching as few of them as
+ * possible: the longest run of entries that are still in increasing order keeps its
+ * positions and the others are spread over the gaps around them. If a gap is too narrow,
+ * the whole list is renumbered RELATIVE_POSITION_GAP apart so that later moves fit again.
+ * \param positions current positions, in the new order
+ * \return the new positions, in the same order
+ */
+QVector<int> DBManager::sparsePositions(const QVector<int> &positions)
 {
-    QSqlQuery query(m_db);
-    query.prepare(QStringLiteral("UPDATE node_table SET relative_position = :relative_position "
-                                 "WHERE id = :id;"));
-    query.bindValue(QStringLiteral(":relative_position"), relPos);
-    query.bindValue(QStringLiteral(":id"), nodeId);
-    bool status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    int count = positions.size();
+    QVector<bool> isKept = IncreasingRun::longest(positions);
+
+    QVector<int> result = positions;
+    int i = 0;
+    while (i < count) {
+        if (isKept[i]) {
+            ++i;
+            continue;
+        }
+        int runEnd = i;
+        while (runEnd < count && !isKept[runEnd]) {
+            ++runEnd;
+        }
+        int runLength = runEnd - i;
+        // a run can't reach both ends, at least one entry is kept
+        qint64 room = qint64(RELATIVE_POSITION_GAP) * (runLength + 1);
+        qint64 low = i > 0 ? result[i - 1] : result[runEnd] - room;
+        qint64 high = runEnd < count ? result[runEnd] : low + room;
+        qint64 step = (high - low) / (runLength + 1);
+        if (step < 1 || low < std::numeric_limits<int>::min() / 2
+            || high > std::numeric_limits<int>::max() / 2) {
+            for (int j = 0; j < count; ++j) {
+                result[j] = j * RELATIVE_POSITION_GAP;
+            }
+            return result;
+        }
+        for (int j = 0; j < runLength; ++j) {
+            result[i + j] = static_cast<int>(low + step * (j + 1));
+        }
+        i = runEnd;
     }
+    return result;
 }
 
-void DBManager::updateRelPosTag(int tagId, int relPos)
+/*!
+ * \brief DBManager::updateRelativePositions
+ * Stores the new order of \a ids in one transaction, only the rows whose position has to
+ * change are written. The current positions are read with one statement per 500 ids, and
+ * nothing is written if any read or write fails.
+ * \param table node_table or tag_table
+ * \param column position column to order by
+ * \param ids every item of the list, in the new order
+ */
+void DBManager::updateRelativePositions(const QString &table, const QString &column,
+                                        const QVector<int> &ids)
 {
-    QSqlQuery query(m_db);
-    query.prepare(QStringLiteral("UPDATE tag_table SET relative_position = :relative_position "
-                                 "WHERE id = :id;"));
-    query.bindValue(QStringLiteral(":relative_position"), relPos);
-    query.bindValue(QStringLiteral(":id"), tagId);
-    bool status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    // stays below SQLite's historical 999 host parameter limit
+    static const int idsPerStatement = 500;
+    // the positions must be read in the same transaction they are rewritten in
+    bool isOwnTransaction = m_db.transaction();
+    auto abort = [this, isOwnTransaction]() {
+        if (isOwnTransaction) {
+            m_db.rollback();
+        }
+    };
+
+    QHash<int, int> positionById;
+    positionById.reserve(ids.size());
+    {
+        QSqlQuery selectQuery(m_db);
+        for (int start = 0; start < ids.size(); start += idsPerStatement) {
+            int idCount = qMin(idsPerStatement, static_cast<int>(ids.size()) - start);
+            QStringList placeholders;
+            for (int i = 0; i < idCount; ++i) {
+                placeholders.append(QStringLiteral("?"));
+            }
+            selectQuery.prepare(QStringLiteral("SELECT id, %1 FROM %2 WHERE id IN (%3);")
+                                        .arg(column, table,
+                                             placeholders.join(QStringLiteral(", "))));
+            for (int i = start; i < start + idCount; ++i) {
+                selectQuery.addBindValue(ids[i]);
+            }
+            if (!selectQuery.exec()) {
+                qDebug() << __FUNCTION__ << __LINE__ << selectQuery.lastError();
+                abort();
+                return;
+            }
+            while (selectQuery.next()) {
+                positionById.insert(selectQuery.value(0).toInt(), selectQuery.value(1).toInt());
+            }
+        }
+    }
+    QVector<int> positions;
+    positions.reserve(ids.size());
+    for (const auto &id : ids) {
+        positions.append(positionById.value(id, 0));
+    }
+    QVector<int> newPositions = sparsePositions(positions);
+
+    QSqlQuery &updateQuery = cachedQuery(
+            QStringLiteral("UPDATE %1 SET %2 = :position WHERE id = :id;").arg(table, column));
+    for (int i = 0; i < ids.size(); ++i) {
+        if (newPositions[i] == positions[i]) {
+            continue;
+        }
+        updateQuery.bindValue(QStringLiteral(":position"), newPositions[i]);
+        updateQuery.bindValue(QStringLiteral(":id"), ids[i]);
+        if (!updateQuery.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << updateQuery.lastError();
+            abort();
+            return;
+        }
+    }
+    if (isOwnTransaction && !m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        m_db.rollback();
     }
 }
 
-void DBManager::updateRelPosPinnedNote(int nodeId, int relPos)
+void DBManager::updateRelPosNodes(const QVector<int> &nodeIds)
 {
-    QSqlQuery query(m_db);
-    query.prepare(QStringLiteral("UPDATE node_table SET relative_position = :relative_position "
-                                 "WHERE id = :id AND node_type=:node_type;"));
-    query.bindValue(QStringLiteral(":relative_position"), relPos);
-    query.bindValue(QStringLiteral(":id"), nodeId);
-    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
-    bool status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
+    updateRelativePositions(QStringLiteral("node_table"), QStringLiteral("relative_position"),
+                            nodeIds);
 }
 
-void DBManager::updateRelPosPinnedNoteAN(int nodeId, int relPos)
+void DBManager::updateRelPosTags(const QVector<int> &tagIds)
 {
-    QSqlQuery query(m_db);
-    query.prepare(
-            QStringLiteral("UPDATE node_table SET relative_position_an = :relative_position_an "
-                           "WHERE id = :id AND node_type=:node_type;"));
-    query.bindValue(QStringLiteral(":relative_position_an"), relPos);
-    query.bindValue(QStringLiteral(":id"), nodeId);
-    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
-    bool status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
+    updateRelativePositions(QStringLiteral("tag_table"), QStringLiteral("relative_position"),
+                            tagIds);
+}
+
+void DBManager::updateRelPosPinnedNotes(const QVector<int> &noteIds)
+{
+    updateRelativePositions(QStringLiteral("node_table"), QStringLiteral("relative_position"),
+                            noteIds);
+}
+
+void DBManager::updateRelPosPinnedNotesAN(const QVector<int> &noteIds)
+{
+    updateRelativePositions(QStringLiteral("node_table"), QStringLiteral("relative_position_an"),
+                            noteIds);
 }
 
 void DBManager::setNoteIsPinned(int noteId, bool isPinned)
 {
-    QSqlQuery query(m_db);
-    query.prepare(QStringLiteral("UPDATE node_table SET is_pinned_note = :is_pinned_note "
-                                 "WHERE id = :id AND node_type=:node_type;"));
+    QSqlQuery &query =
+            cachedQuery(QStringLiteral("UPDATE node_table SET is_pinned_note = :is_pinned_note "
+                                       "WHERE id = :id AND node_type=:node_type;"));
     query.bindValue(QStringLiteral(":is_pinned_note"), isPinned);
     query.bindValue(QStringLiteral(":id"), noteId);
     query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
@@ -1445,11 +2296,12 @@ void DBManager::setNoteIsPinned(int noteId, bool isPinned)
 
 NodeData DBManager::getChildNotesCountFolder(int folderId)
 {
+    assertOnDatabaseThread(__FUNCTION__);
     NodeData d;
     d.setNodeType(NodeData::Folder);
     d.setId(folderId);
-    QSqlQuery query(m_db);
-    query.prepare(R"(SELECT child_notes_count, absolute_path  FROM "node_table" WHERE id=:id)");
+    QSqlQuery &query =
+            cachedQuery(R"(SELECT child_notes_count, absolute_path FROM "node_table" WHERE id=:id)");
     query.bindValue(QStringLiteral(":id"), folderId);
     bool status = query.exec();
     int childNotesCount = 0;
@@ -1461,175 +2313,263 @@ NodeData DBManager::getChildNotesCountFolder(int folderId)
     } else {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
+    query.finish();
     d.setChildNotesCount(childNotesCount);
     d.setAbsolutePath(absPath);
     return d;
 }
 
-void DBManager::onNodeTagTreeRequested()
+/*!
+ * \brief DBManager::cachedQuery
+ * Statement registry for the per-row helpers: each statement is prepared once per connection
+ * and later calls only rebind and execute it. Callers must finish() the query once they
+ * have read the results, so no read transaction stays open, and must not keep iterating
+ * a cached query while calling into code that may run the same statement.
+ * \param statement SQL text, also the cache key
+ */
+QSqlQuery &DBManager::cachedQuery(const QString &statement)
 {
-    NodeTagTreeData d;
-    d.nodeTreeData = getAllFolders();
-    d.tagTreeData = getAllTagInfo();
-    emit nodesTagTreeReceived(d);
+    auto it = m_statementCache.constFind(statement);
+    if (it == m_statementCache.constEnd()) {
+        auto query = new QSqlQuery(m_db);
+        if (!query->prepare(statement)) {
+            qDebug() << __FUNCTION__ << __LINE__ << query->lastError() << statement;
+        }
+        it = m_statementCache.insert(statement, query);
+        ++m_statementCacheStats.prepares;
+    }
+    ++m_statementCacheStats.lookups;
+    return *it.value();
 }
 
 /*!
- * \brief DBManager::onNotesListRequested
+ * \brief DBManager::clearStatementCache
+ * Must run before the connection is closed or replaced
  */
-void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, bool newNote,
-                                             int scrollToId)
+void DBManager::clearStatementCache()
 {
-    QVector<NodeData> nodeList;
-    QSqlQuery query(m_db);
-    if (parentID == SpecialNodeID::RootFolder) {
-        query.prepare(R"(SELECT )"
-                      R"("id",)"
-                      R"("title",)"
-                      R"("creation_date",)"
-                      R"("modification_date",)"
-                      R"("deletion_date",)"
-                      R"("content",)"
-                      R"("node_type",)"
-                      R"("parent_id",)"
-                      R"("relative_position",)"
-                      R"("scrollbar_position",)"
-                      R"("absolute_path", )"
-                      R"("is_pinned_note", )"
-                      R"("relative_position_an", )"
-                      R"("child_notes_count" )"
-                      R"(FROM node_table )"
-                      R"(WHERE node_type = (:node_type) AND parent_id != (:parent_id);)");
-        query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Note));
-        query.bindValue(QStringLiteral(":parent_id"), static_cast<int>(SpecialNodeID::TrashFolder));
+    qDeleteAll(m_statementCache);
+    m_statementCache.clear();
+}
 
-        bool status = query.exec();
-        if (status) {
-            while (query.next()) {
-                NodeData node;
-                node.setId(query.value(0).toInt());
-                node.setFullTitle(query.value(1).toString());
-                node.setCreationDateTime(
-                        QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
-                node.setLastModificationDateTime(
-                        QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
-                node.setDeletionDateTime(
-                        QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-                node.setContent(query.value(5).toString());
-                node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
-                node.setParentId(query.value(7).toInt());
-                node.setRelativePosition(query.value(8).toInt());
-                node.setScrollBarPosition(query.value(9).toInt());
-                node.setAbsolutePath(query.value(10).toString());
-                node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
-                node.setRelativePosAN(query.value(13).toInt());
-                node.setChildNotesCount(query.value(14).toInt());
-                node.setTagIds(getAllTagForNote(node.id()));
-                auto p = getNode(node.parentId());
-                node.setParentName(p.fullTitle());
-                nodeList.append(node);
-            }
-        } else {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+StatementCacheStats DBManager::statementCacheStats() const
+{
+    return m_statementCacheStats;
+}
+
+/*!
+ * \brief DBManager::cachedStatements
+ * \return the SQL of every statement prepared through cachedQuery so far
+ */
+QStringList DBManager::cachedStatements() const
+{
+    return m_statementCache.keys();
+}
+
+/*!
+ * \brief DBManager::startReaders
+ * Readers only run beside the writer in WAL mode, with a rollback journal their shared
+ * locks would make note saves fail with SQLITE_BUSY, so lists are then read on this thread.
+ */
+void DBManager::startReaders()
+{
+    stopReaders();
+    if (!isWriteAheadLogEnabled()) {
+        return;
+    }
+    m_readerPool = new QThreadPool(this);
+    m_readerPool->setMaxThreadCount(READER_CONNECTION_COUNT);
+    // keep the threads, and with them their connections, until stopReaders()
+    m_readerPool->setExpiryTimeout(-1);
+}
+
+/*!
+ * \brief DBManager::stopReaders
+ * Drops the queued reads, waits for the running ones and closes every reader connection.
+ * Must run before the database file is closed, replaced or leaves WAL mode.
+ */
+void DBManager::stopReaders()
+{
+    if (!m_readerPool) {
+        return;
+    }
+    m_readerPool->clear();
+    // the pool joins its threads, which removes their connections
+    delete m_readerPool;
+    m_readerPool = nullptr;
+}
+
+/*!
+ * \brief DBManager::readerDatabase
+ * Read-only connection of the calling pool thread, opened on first use
+ */
+QSqlDatabase DBManager::readerDatabase(const QString &path, const StorageSettings &settings)
+{
+    if (!readerConnections.hasLocalData() || readerConnections.localData()->path != path) {
+        auto connection = new ReaderConnection;
+        connection->name = QStringLiteral("reader_database_%1")
+                                   .arg(reinterpret_cast<quintptr>(QThread::currentThread()));
+        connection->path = path;
+        // deletes the previous connection of this thread, if any
+        readerConnections.setLocalData(connection);
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection->name);
+        db.setDatabaseName(path);
+        db.setConnectOptions(QStringLiteral("QSQLITE_OPEN_READONLY"));
+        if (!db.open()) {
+            qDebug() << __FUNCTION__ << __LINE__ << db.lastError();
+            return db;
         }
-    } else if (!isRecursive) {
-        query.prepare(R"(SELECT )"
-                      R"("id",)"
-                      R"("title",)"
-                      R"("creation_date",)"
-                      R"("modification_date",)"
-                      R"("deletion_date",)"
-                      R"("content",)"
-                      R"("node_type",)"
-                      R"("parent_id",)"
-                      R"("relative_position", )"
-                      R"("scrollbar_position",)"
-                      R"("absolute_path", )"
-                      R"("is_pinned_note", )"
-                      R"("relative_position_an", )"
-                      R"("child_notes_count" )"
-                      R"(FROM node_table )"
-                      R"(WHERE parent_id = (:parent_id) AND node_type = (:node_type);)");
-        query.bindValue(QStringLiteral(":parent_id"), parentID);
-        query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Note));
-        bool status = query.exec();
-        if (status) {
-            while (query.next()) {
-                NodeData node;
-                node.setId(query.value(0).toInt());
-                node.setFullTitle(query.value(1).toString());
-                node.setCreationDateTime(
-                        QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
-                node.setLastModificationDateTime(
-                        QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
-                node.setDeletionDateTime(
-                        QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-                node.setContent(query.value(5).toString());
-                node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
-                node.setParentId(query.value(7).toInt());
-                node.setRelativePosition(query.value(8).toInt());
-                node.setScrollBarPosition(query.value(9).toInt());
-                node.setAbsolutePath(query.value(10).toString());
-                node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
-                node.setRelativePosAN(query.value(13).toInt());
-                node.setChildNotesCount(query.value(14).toInt());
-                node.setTagIds(getAllTagForNote(node.id()));
-                nodeList.append(node);
+        QSqlQuery query(db);
+        const QStringList pragmas = {
+            QStringLiteral("PRAGMA cache_size = %1;").arg(-qMax(settings.cacheSizeKiB, 0)),
+            QStringLiteral("PRAGMA mmap_size = %1;")
+                    .arg(qint64(qMax(settings.mmapSizeMiB, 0)) * 1024 * 1024),
+            QStringLiteral("PRAGMA query_only = 1;"),
+        };
+        for (const auto &pragma : pragmas) {
+            if (!query.exec(pragma)) {
+                qDebug() << __FUNCTION__ << __LINE__ << query.lastError() << pragma;
             }
-        } else {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
-    } else {
-        auto parentPath = getNodeAbsolutePath(parentID).path() + PATH_SEPARATOR;
-        query.prepare(
-                R"(SELECT )"
-                R"("id",)"
-                R"("title",)"
-                R"("creation_date",)"
-                R"("modification_date",)"
-                R"("deletion_date",)"
-                R"("content",)"
-                R"("node_type",)"
-                R"("parent_id",)"
-                R"("relative_position", )"
-                R"("scrollbar_position",)"
-                R"("absolute_path", )"
-                R"("is_pinned_note", )"
-                R"("relative_position_an", )"
-                R"("child_notes_count" )"
-                R"(FROM node_table )"
-                R"(WHERE absolute_path like (:path_expr) || '%' AND node_type = (:node_type);)");
-        query.bindValue(QStringLiteral(":path_expr"), parentPath);
-        query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Note));
+    }
+    return QSqlDatabase::database(readerConnections.localData()->name, false);
+}
 
-        bool status = query.exec();
-        if (status) {
-            while (query.next()) {
-                NodeData node;
-                node.setId(query.value(0).toInt());
-                node.setFullTitle(query.value(1).toString());
-                node.setCreationDateTime(
-                        QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
-                node.setLastModificationDateTime(
-                        QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
-                node.setDeletionDateTime(
-                        QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-                node.setContent(query.value(5).toString());
-                node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
-                node.setParentId(query.value(7).toInt());
-                node.setRelativePosition(query.value(8).toInt());
-                node.setScrollBarPosition(query.value(9).toInt());
-                node.setAbsolutePath(query.value(10).toString());
-                node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
-                node.setRelativePosAN(query.value(13).toInt());
-                node.setChildNotesCount(query.value(14).toInt());
-                node.setTagIds(getAllTagForNote(node.id()));
-                nodeList.append(node);
-            }
-        } else {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        }
+/*!
+ * \brief DBManager::assertOnDatabaseThread
+ * The synchronous accessors touch m_db directly and must only run on the database
+ * thread. Other threads go through the request*() functions, which never block.
+ * \param function
+ */
+void DBManager::assertOnDatabaseThread(const char *function) const
+{
+#ifndef QT_NO_DEBUG
+    Q_ASSERT_X(QThread::currentThread() == thread(), function,
+               "synchronous DBManager call from another thread, use the request API");
+#else
+    Q_UNUSED(function);
+#endif
+}
+
+QFuture<NodeData> DBManager::requestNode(int nodeId)
+{
+    return runRequest<NodeData>([this, nodeId]() { return getNode(nodeId); });
+}
+
+QFuture<QString> DBManager::requestNoteContent(int noteId)
+{
+    return runRequest<QString>([this, noteId]() { return getNoteContent(noteId); });
+}
+
+QFuture<QHash<int, QString>> DBManager::requestNoteContents(const QVector<int> &noteIds)
+{
+    return runRequest<QHash<int, QString>>([this, noteIds]() { return getNoteContents(noteIds); });
+}
+
+QFuture<FolderListType> DBManager::requestFolderList()
+{
+    return runRequest<FolderListType>([this]() { return getFolderList(); });
+}
+
+QFuture<int> DBManager::requestAddNode(const NodeData &node)
+{
+    return runRequest<int>([this, node]() { return addNode(node); });
+}
+
+QFuture<QVector<int>> DBManager::requestAddNodesBulk(const QVector<NodeData> &nodes)
+{
+    return runRequest<QVector<int>>([this, nodes]() { return addNodesBulk(nodes); });
+}
+
+QFuture<QHash<QString, int>> DBManager::requestAddFolderTree(const QString &rootTitle,
+                                                             const QStringList &relativeDirs)
+{
+    return runRequest<QHash<QString, int>>(
+            [this, rootTitle, relativeDirs]() { return addFolderTree(rootTitle, relativeDirs); });
+}
+
+QFuture<int> DBManager::requestAddTag(const TagData &tag)
+{
+    return runRequest<int>([this, tag]() { return addTag(tag); });
+}
+
+QFuture<int> DBManager::requestNextAvailableNodeId()
+{
+    return runRequest<int>([this]() { return nextAvailableNodeId(); });
+}
+
+QFuture<NodeData> DBManager::requestChildNotesCountFolder(int folderId)
+{
+    return runRequest<NodeData>([this, folderId]() { return getChildNotesCountFolder(folderId); });
+}
+
+QFuture<NoteExportSnapshot> DBManager::requestExportSnapshot()
+{
+    return runRequest<NoteExportSnapshot>([this]() { return exportSnapshot(); });
+}
+
+QFuture<bool> DBManager::requestImportNotes(const QString &fileName)
+{
+    return runRequest<bool>([this, fileName]() { return onImportNotesRequested(fileName); });
+}
+
+QFuture<bool> DBManager::requestRestoreNotes(const QString &fileName)
+{
+    return runRequest<bool>([this, fileName]() { return onRestoreNotesRequested(fileName); });
+}
+
+QFuture<bool> DBManager::requestChangeDatabasePath(const QString &newPath)
+{
+    return runRequest<bool>([this, newPath]() { return onChangeDatabasePathRequested(newPath); });
+}
+
+/*!
+ * \brief DBManager::beginListRequest
+ * Called from the GUI thread before asking for a note list or a search. Every list request
+ * issued earlier becomes stale and is dropped before or while it runs.
+ * \return id to pass along with the request
+ */
+quint64 DBManager::beginListRequest()
+{
+    return ++m_latestListRequestId;
+}
+
+/*!
+ * \brief DBManager::isListRequestStale
+ * \param requestId id returned by beginListRequest, 0 for requests that are never superseded
+ * \return true if a newer list request has been issued since
+ */
+bool DBManager::isListRequestStale(quint64 requestId) const
+{
+    return requestId != 0 && requestId != m_latestListRequestId.load();
+}
+
+void DBManager::onNodeTagTreeRequested()
+{
+    runOnReader([this](QSqlDatabase &db) {
+        NodeTagTreeData d;
+        d.nodeTreeData = getAllFolders(db);
+        d.tagTreeData = getAllTagInfo(db);
+        emit nodesTagTreeReceived(d);
+    });
+}
+
+/*!
+ * \brief DBManager::onNotesListRequested
+ */
+void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, bool newNote,
+                                             int scrollToId, quint64 requestId)
+{
+    // a newer request is already queued behind this one, skip the work
+    if (isListRequestStale(requestId)) {
+        return;
     }
+    QMap<QString, QVariant> bindValues;
+    QString parentPath;
+    if (parentID != SpecialNodeID::RootFolder && isRecursive) {
+        parentPath = getNodeAbsolutePath(parentID).path();
+    }
+    QString condition = folderListCondition(parentID, isRecursive, parentPath, bindValues);
     ListViewInfo inf;
     inf.isInSearch = false;
     inf.isInTag = false;
@@ -1637,75 +2577,51 @@ void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, boo
     inf.currentNotesId = { SpecialNodeID::InvalidNodeId };
     inf.needCreateNewNote = newNote;
     inf.scrollToId = scrollToId;
-    std::sort(nodeList.begin(), nodeList.end(), [](const NodeData &a, const NodeData &b) -> bool {
-        return a.lastModificationdateTime() > b.lastModificationdateTime();
+    inf.requestId = requestId;
+    runOnReader([this, condition, bindValues, inf](QSqlDatabase &db) {
+        QVector<NodeData> nodeList = getNoteList(db, condition, bindValues, inf.requestId);
+        if (isListRequestStale(inf.requestId)) {
+            return;
+        }
+        std::sort(nodeList.begin(), nodeList.end(),
+                  [](const NodeData &a, const NodeData &b) -> bool {
+                      return a.lastModificationdateTime() > b.lastModificationdateTime();
+                  });
+        emit notesListReceived(nodeList, inf);
     });
-    emit notesListReceived(nodeList, inf);
 }
 
-void DBManager::onNotesListInTagsRequested(const QSet<int> &tagIds, bool newNote, int scrollToId)
+void DBManager::onNotesListInTagsRequested(const QSet<int> &tagIds, bool newNote, int scrollToId,
+                                           quint64 requestId)
 {
-    QVector<NodeData> nodeList;
-    QVector<QSet<int>> nds;
+    if (isListRequestStale(requestId)) {
+        return;
+    }
     ListViewInfo inf;
     inf.isInSearch = false;
     inf.isInTag = true;
     inf.currentTagList = tagIds;
     inf.currentNotesId = { SpecialNodeID::InvalidNodeId };
-    inf.needCreateNewNote = newNote;
-    inf.scrollToId = scrollToId;
-    for (const auto &tagId : tagIds) {
-        QSet<int> nd;
-        QSqlQuery query(m_db);
-        query.prepare(R"(SELECT "node_id" FROM tag_relationship WHERE tag_id = :tag_id;)");
-        query.bindValue(QStringLiteral(":tag_id"), tagId);
-        bool status = query.exec();
-        if (status) {
-            while (query.next()) {
-                nd.insert(query.value(0).toInt());
-            }
-        } else {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        }
-        nds.append(nd);
-    }
-    if (nds.size() == 0) {
-        emit notesListReceived(nodeList, inf);
+    inf.needCreateNewNote = newNote;
+    inf.scrollToId = scrollToId;
+    inf.requestId = requestId;
+    if (tagIds.isEmpty()) {
+        emit notesListReceived(QVector<NodeData>(), inf);
         return;
     }
-    QSet<int> noteIds;
-    int nds_id = 0;
-    for (int i = 1; i < nds.size(); ++i) {
-        if (nds[i].size() < nds[nds_id].size()) {
-            nds_id = i;
-        }
-    }
-    for (const int id : qAsConst(nds[nds_id])) {
-        bool ok = true;
-        for (int i = 0; i < nds.size(); ++i) {
-            if (i == nds_id) {
-                continue;
-            }
-            if (!nds[i].contains(id)) {
-                ok = false;
-            }
-        }
-        if (ok) {
-            noteIds.insert(id);
-        }
-    }
-    for (const auto &id : noteIds) {
-        NodeData node = getNode(id);
-        if (node.id() != SpecialNodeID::InvalidNodeId && node.nodeType() == NodeData::Note) {
-            nodeList.append(node);
-        } else {
-            qDebug() << __FUNCTION__ << "Note with id" << id << "is not valid";
+    QMap<QString, QVariant> bindValues;
+    QString condition = tagListCondition(tagIds, bindValues);
+    runOnReader([this, condition, bindValues, inf](QSqlDatabase &db) {
+        QVector<NodeData> nodeList = getNoteList(db, condition, bindValues, inf.requestId);
+        if (isListRequestStale(inf.requestId)) {
+            return;
         }
-    }
-    std::sort(nodeList.begin(), nodeList.end(), [](const NodeData &a, const NodeData &b) -> bool {
-        return a.lastModificationdateTime() > b.lastModificationdateTime();
+        std::sort(nodeList.begin(), nodeList.end(),
+                  [](const NodeData &a, const NodeData &b) -> bool {
+                      return a.lastModificationdateTime() > b.lastModificationdateTime();
+                  });
+        emit notesListReceived(nodeList, inf);
     });
-    emit notesListReceived(nodeList, inf);
 }
 
 /*!
@@ -1729,6 +2645,10 @@ void DBManager::onCreateUpdateRequestedNoteContent(const NodeData &note)
         qDebug() << "Wrong node type";
         return;
     }
+    if (!note.isContentLoaded()) {
+        qDebug() << "Note content is not loaded, refusing to overwrite it";
+        return;
+    }
     bool exists = isNodeExist(note);
 
     if (exists) {
@@ -1738,330 +2658,207 @@ void DBManager::onCreateUpdateRequestedNoteContent(const NodeData &note)
     }
 }
 
+/*!
+ * \brief DBManager::importDatabase
+ * Merge another Plume database into this one. The file is attached and everything is copied
+ * with set-based INSERT ... SELECT statements in one transaction, temporary tables map the
+ * outside ids to new ones:
+ * - tags are matched by name and color, the rest is added once per name/color pair
+ * - special folders map onto ours, other folders are matched by title under their mapped
+ *   parent or created, one tree level per round
+ * - notes get new ids and paths below their mapped folder and keep their tags
+ * Previews are left NULL for backfillNotePreviews, the triggers keep the full text index and
+ * child note counters up to date.
+ * \return false if nothing could be imported
+ */
+bool DBManager::importDatabase(const QString &fileName)
+{
+    assertOnDatabaseThread(__FUNCTION__);
+    QSqlQuery query(m_db);
+    query.prepare(QStringLiteral("ATTACH DATABASE :file_name AS import_db;"));
+    query.bindValue(QStringLiteral(":file_name"), fileName);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return false;
+    }
+
+    static const QString insertNodeHead = QStringLiteral(
+            R"(INSERT INTO main.node_table )"
+            R"(("id", "title", "creation_date", "modification_date", "deletion_date", "content", "node_type", "parent_id", "relative_position", "scrollbar_position", "absolute_path", "is_pinned_note", "relative_position_an", "child_notes_count", "preview") )");
+    // Appended after the existing children of the mapped parent, in their original order
+    static const QString selectNodeColumns = QStringLiteral(
+            R"(SELECT m.new_id, o.title, o.creation_date, o.modification_date, o.deletion_date, )"
+            R"(o.content, o.node_type, p.new_id, )"
+            R"((SELECT coalesce(max(e.relative_position) + 1, 0) FROM main.node_table e )"
+            R"( WHERE e.parent_id = p.new_id AND e.node_type = o.node_type) )"
+            R"(+ ROW_NUMBER() OVER (PARTITION BY p.new_id ORDER BY o.relative_position, o.id) - 1, )"
+            R"(o.scrollbar_position, parent.absolute_path || :separator || m.new_id, )"
+            R"(o.is_pinned_note, 0, 0, NULL )");
+
+    bool isSuccess = true;
+    auto exec = [&](const QString &statement, const QMap<QString, QVariant> &bindValues = {}) {
+        if (!isSuccess) {
+            return 0;
+        }
+        query.prepare(statement);
+        for (auto it = bindValues.constBegin(); it != bindValues.constEnd(); ++it) {
+            query.bindValue(it.key(), it.value());
+        }
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError() << statement;
+            isSuccess = false;
+            return 0;
+        }
+        return query.numRowsAffected();
+    };
+
+    m_db.transaction();
+    for (const auto &table : { QStringLiteral("import_tag_map"), QStringLiteral("import_folder_map"),
+                               QStringLiteral("import_note_map") }) {
+        exec(QStringLiteral("DROP TABLE IF EXISTS temp.%1;").arg(table));
+        exec(QStringLiteral("CREATE TEMP TABLE %1 "
+                            "(old_id INTEGER PRIMARY KEY, new_id INTEGER NOT NULL);")
+                     .arg(table));
+    }
+
+    // Tags
+    int firstTagId = nextAvailableTagId();
+    int firstTagPosition = 0;
+    if (query.exec(QStringLiteral(
+                "SELECT coalesce(max(relative_position) + 1, 0) FROM main.tag_table;"))
+        && query.next()) {
+        firstTagPosition = query.value(0).toInt();
+    }
+    exec(R"(INSERT INTO import_tag_map (old_id, new_id) )"
+         R"(SELECT o.id, t.id FROM import_db.tag_table o )"
+         R"(JOIN main.tag_table t ON t.id = (SELECT min(e.id) FROM main.tag_table e )"
+         R"( WHERE e.name = o.name AND e.color = o.color);)");
+    exec(R"(INSERT INTO main.tag_table ("id", "name", "color", "relative_position", "child_notes_count") )"
+         R"(SELECT :first_id + ROW_NUMBER() OVER (ORDER BY min(relative_position), min(id)) - 1, )"
+         R"(name, color, )"
+         R"(:first_position + ROW_NUMBER() OVER (ORDER BY min(relative_position), min(id)) - 1, 0 )"
+         R"(FROM import_db.tag_table WHERE id NOT IN (SELECT old_id FROM import_tag_map) )"
+         R"(GROUP BY name, color;)",
+         { { QStringLiteral(":first_id"), firstTagId },
+           { QStringLiteral(":first_position"), firstTagPosition } });
+    exec(R"(INSERT INTO import_tag_map (old_id, new_id) )"
+         R"(SELECT o.id, t.id FROM import_db.tag_table o )"
+         R"(JOIN main.tag_table t ON t.name = o.name AND t.color = o.color AND t.id >= :first_id )"
+         R"(WHERE o.id NOT IN (SELECT old_id FROM import_tag_map);)",
+         { { QStringLiteral(":first_id"), firstTagId } });
+    exec(R"(UPDATE "metadata" SET "value" = max("value", )"
+         R"((SELECT coalesce(max(id), -1) + 1 FROM main.tag_table)) WHERE "key"='next_tag_id';)");
+
+    // Folders
+    exec(R"(INSERT INTO import_folder_map (old_id, new_id) )"
+         R"(VALUES (:root, :root), (:trash, :trash), (:notes, :notes);)",
+         { { QStringLiteral(":root"), static_cast<int>(SpecialNodeID::RootFolder) },
+           { QStringLiteral(":trash"), static_cast<int>(SpecialNodeID::TrashFolder) },
+           { QStringLiteral(":notes"), static_cast<int>(SpecialNodeID::DefaultNotesFolder) } });
+    int nextId = nextAvailableNodeId();
+    const QMap<QString, QVariant> folderType = {
+        { QStringLiteral(":folder_type"), static_cast<int>(NodeData::Folder) }
+    };
+    while (isSuccess) {
+        int matched = exec(
+                R"(INSERT INTO import_folder_map (old_id, new_id) )"
+                R"(SELECT id, match_id FROM ()"
+                R"( SELECT o.id, (SELECT min(n.id) FROM main.node_table n )"
+                R"(  WHERE n.node_type = :folder_type AND n.parent_id = p.new_id AND n.title = o.title) AS match_id )"
+                R"( FROM import_db.node_table o JOIN import_folder_map p ON p.old_id = o.parent_id )"
+                R"( WHERE o.node_type = :folder_type AND o.id NOT IN (SELECT old_id FROM import_folder_map)) )"
+                R"(WHERE match_id IS NOT NULL;)",
+                folderType);
+        int created = exec(
+                R"(INSERT INTO import_folder_map (old_id, new_id) )"
+                R"(SELECT o.id, :first_id + ROW_NUMBER() OVER (ORDER BY o.relative_position, o.id) - 1 )"
+                R"(FROM import_db.node_table o JOIN import_folder_map p ON p.old_id = o.parent_id )"
+                R"(WHERE o.node_type = :folder_type AND o.id NOT IN (SELECT old_id FROM import_folder_map);)",
+                { { QStringLiteral(":folder_type"), static_cast<int>(NodeData::Folder) },
+                  { QStringLiteral(":first_id"), nextId } });
+        if (created > 0) {
+            exec(insertNodeHead + selectNodeColumns
+                         + R"(FROM import_folder_map m JOIN import_db.node_table o ON o.id = m.old_id )"
+                           R"(JOIN import_folder_map p ON p.old_id = o.parent_id )"
+                           R"(JOIN main.node_table parent ON parent.id = p.new_id )"
+                           R"(WHERE m.new_id >= :first_id;)",
+                 { { QStringLiteral(":separator"), QStringLiteral(PATH_SEPARATOR) },
+                   { QStringLiteral(":first_id"), nextId } });
+            nextId += created;
+        }
+        if (matched == 0 && created == 0) {
+            break;
+        }
+    }
+
+    // Notes, the ones whose folder couldn't be mapped are skipped
+    nextId += exec(R"(INSERT INTO import_note_map (old_id, new_id) )"
+                   R"(SELECT o.id, :first_id + ROW_NUMBER() OVER (ORDER BY o.id) - 1 )"
+                   R"(FROM import_db.node_table o JOIN import_folder_map p ON p.old_id = o.parent_id )"
+                   R"(WHERE o.node_type = :note_type;)",
+                   { { QStringLiteral(":first_id"), nextId },
+                     { QStringLiteral(":note_type"), static_cast<int>(NodeData::Note) } });
+    exec(insertNodeHead + selectNodeColumns
+                 + R"(FROM import_note_map m JOIN import_db.node_table o ON o.id = m.old_id )"
+                   R"(JOIN import_folder_map p ON p.old_id = o.parent_id )"
+                   R"(JOIN main.node_table parent ON parent.id = p.new_id;)",
+         { { QStringLiteral(":separator"), QStringLiteral(PATH_SEPARATOR) } });
+    exec(R"(INSERT OR IGNORE INTO main.tag_relationship ("node_id", "tag_id") )"
+         R"(SELECT n.new_id, t.new_id FROM import_db.tag_relationship r )"
+         R"(JOIN import_note_map n ON n.old_id = r.node_id )"
+         R"(JOIN import_tag_map t ON t.old_id = r.tag_id;)");
+    exec(R"(UPDATE "metadata" SET "value" = max("value", )"
+         R"((SELECT coalesce(max(id), -1) + 1 FROM main.node_table)) WHERE "key"='next_node_id';)");
+
+    if (isSuccess) {
+        m_db.commit();
+    } else {
+        m_db.rollback();
+    }
+    // the ids were assigned in SQL above, pick up the counters it left in metadata
+    loadIdCounters();
+    query.exec(QStringLiteral("DROP TABLE IF EXISTS temp.import_tag_map;"));
+    query.exec(QStringLiteral("DROP TABLE IF EXISTS temp.import_folder_map;"));
+    query.exec(QStringLiteral("DROP TABLE IF EXISTS temp.import_note_map;"));
+    query.finish();
+    if (!query.exec(QStringLiteral("DETACH DATABASE import_db;"))) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    return isSuccess;
+}
+
 /*!
  * \brief DBManager::onImportNotesRequested
- * \param noteList
+ * \param fileName
+ * \return false if nothing could be imported
  */
-void DBManager::onImportNotesRequested(const QString &fileName)
+bool DBManager::onImportNotesRequested(const QString &fileName)
 {
     QFile file(fileName);
     if (!file.open(QIODevice::ReadOnly)) {
         qDebug() << __FUNCTION__ << __LINE__ << "fail to open file";
-        return;
+        return false;
     }
     auto magic_header = file.read(16);
     file.close();
+    bool isImported = true;
     if (QString::fromUtf8(magic_header).startsWith(QStringLiteral("SQLite format 3"))) {
-        qDebug() << __FUNCTION__;
-        auto outside_db = QSqlDatabase::addDatabase("QSQLITE", OUTSIDE_DATABASE_NAME);
-        outside_db.setDatabaseName(fileName);
-        if (!outside_db.open()) {
-            qDebug() << __FUNCTION__ << "Error: connection with database fail";
-            return;
-        } else {
-            qDebug() << __FUNCTION__ << "Database: connection ok";
-        }
-
-        QMap<int, int> folderIdMap, noteIdMap, tagIdMap;
-        {
-            QVector<TagData> tagList;
-            QSqlQuery out_qr(outside_db);
-            out_qr.prepare(
-                    R"(SELECT "id","name","color","relative_position","child_notes_count" FROM tag_table;)");
-            bool status = out_qr.exec();
-            if (status) {
-                while (out_qr.next()) {
-                    TagData tag;
-                    tag.setId(out_qr.value(0).toInt());
-                    tag.setName(out_qr.value(1).toString());
-                    tag.setColor(out_qr.value(2).toString());
-                    tag.setRelativePosition(out_qr.value(3).toInt());
-                    tag.setChildNotesCount(out_qr.value(4).toInt());
-                    tagList.append(tag);
-                }
-            } else {
-                qDebug() << __FUNCTION__ << __LINE__ << out_qr.lastError();
-            }
-            out_qr.finish();
-            std::sort(tagList.begin(), tagList.end(),
-                      [](auto a, auto b) { return a.relativePosition() < b.relativePosition(); });
-            for (const auto &tag : qAsConst(tagList)) {
-                QSqlQuery qr(m_db);
-                qr.prepare(R"(SELECT "id" FROM tag_table WHERE name = :name AND color = :color;)");
-                qr.bindValue(QStringLiteral(":name"), tag.name());
-                qr.bindValue(QStringLiteral(":color"), tag.color());
-                QVector<int> ids;
-                if (qr.exec()) {
-                    while (qr.next()) {
-                        ids.append(qr.value(0).toInt());
-                    }
-                } else {
-                    qDebug() << __FUNCTION__ << __LINE__ << qr.lastError();
-                }
-                qr.finish();
-                if (ids.isEmpty()) {
-                    ids.append(addTag(tag));
-                }
-                tagIdMap[tag.id()] = ids[0];
-            }
-        }
-        {
-            folderIdMap[SpecialNodeID::RootFolder] = SpecialNodeID::RootFolder;
-            folderIdMap[SpecialNodeID::TrashFolder] = SpecialNodeID::TrashFolder;
-            folderIdMap[SpecialNodeID::DefaultNotesFolder] = SpecialNodeID::DefaultNotesFolder;
-            QSqlQuery out_qr(outside_db);
-            out_qr.prepare(R"(SELECT)"
-                           R"("id",)"
-                           R"("title",)"
-                           R"("creation_date",)"
-                           R"("modification_date",)"
-                           R"("deletion_date",)"
-                           R"("content",)"
-                           R"("node_type",)"
-                           R"("parent_id",)"
-                           R"("relative_position",)"
-                           R"("absolute_path" )"
-                           R"(FROM node_table WHERE node_type=:node_type;)");
-            out_qr.bindValue(":node_type", static_cast<int>(NodeData::Type::Folder));
-            bool status = out_qr.exec();
-            QMap<int, NodeData> nodeList;
-            if (status) {
-                while (out_qr.next()) {
-                    NodeData node;
-                    node.setId(out_qr.value(0).toInt());
-                    node.setFullTitle(out_qr.value(1).toString());
-                    node.setCreationDateTime(
-                            QDateTime::fromMSecsSinceEpoch(out_qr.value(2).toLongLong()));
-                    node.setLastModificationDateTime(
-                            QDateTime::fromMSecsSinceEpoch(out_qr.value(3).toLongLong()));
-                    node.setDeletionDateTime(
-                            QDateTime::fromMSecsSinceEpoch(out_qr.value(4).toLongLong()));
-                    node.setContent(out_qr.value(5).toString());
-                    node.setNodeType(static_cast<NodeData::Type>(out_qr.value(6).toInt()));
-                    node.setParentId(out_qr.value(7).toInt());
-                    node.setRelativePosition(out_qr.value(8).toInt());
-                    node.setAbsolutePath(out_qr.value(9).toString());
-                    nodeList[node.id()] = node;
-                }
-                auto matchFolderFunc = [&](int id, const auto &matchFolderFunctor) {
-                    if (!nodeList.contains(id)) {
-                        qDebug() << __FUNCTION__ << __LINE__ << "node not found";
-                        return;
-                    }
-                    if (folderIdMap.contains(id)) {
-                        return;
-                    }
-                    auto node = nodeList[id];
-                    if (folderIdMap.contains(node.parentId())) {
-                        QSqlQuery qr(m_db);
-                        qr.prepare(
-                                R"(SELECT "id" FROM node_table WHERE title = :title AND node_type = :node_type AND parent_id = :parent_id;)");
-                        qr.bindValue(QStringLiteral(":title"), node.fullTitle());
-                        qr.bindValue(QStringLiteral(":node_type"),
-                                     static_cast<int>(NodeData::Folder));
-                        qr.bindValue(QStringLiteral(":parent_id"), folderIdMap[node.parentId()]);
-                        QVector<int> ids;
-                        if (qr.exec()) {
-                            while (qr.next()) {
-                                ids.append(qr.value(0).toInt());
-                            }
-                        } else {
-                            qDebug() << __FUNCTION__ << __LINE__ << qr.lastError();
-                        }
-                        qr.finish();
-                        if (!ids.isEmpty()) {
-                            folderIdMap[id] = ids[0];
-                        } else {
-                            node.setParentId(folderIdMap[node.parentId()]);
-                            int newId = addNode(node);
-                            folderIdMap[id] = newId;
-                        }
-                    } else {
-                        auto prL = NodePath(node.absolutePath()).separate();
-                        for (const auto &pr : qAsConst(prL)) {
-                            matchFolderFunctor(pr.toInt(), matchFolderFunctor);
-                        }
-                    }
-                };
-
-                struct Folder
-                {
-                    int id;
-                    int parentId;
-                    std::vector<Folder *> children;
-                };
-                Folder *rootFolder = nullptr;
-                QHash<int, Folder> needImportFolderMap;
-                for (const auto &node : qAsConst(nodeList)) {
-                    Folder f;
-                    f.id = node.id();
-                    f.parentId = node.parentId();
-                    needImportFolderMap[node.id()] = f;
-                    if (f.id == SpecialNodeID::RootFolder) {
-                        rootFolder = &needImportFolderMap[node.id()];
-                    }
-                }
-                if (rootFolder) {
-                    for (const auto &folder : qAsConst(needImportFolderMap)) {
-                        if (folder.id != SpecialNodeID::RootFolder) {
-                            needImportFolderMap[folder.parentId].children.push_back(
-                                    &needImportFolderMap[folder.id]);
-                        }
-                    }
-                    auto sortChildFunc = [&](Folder *f) {
-                        std::sort(f->children.begin(), f->children.end(),
-                                  [&](Folder *f1, Folder *f2) {
-                                      return nodeList[f1->id].relativePosition()
-                                              < nodeList[f2->id].relativePosition();
-                                  });
-                    };
-                    auto sortFunc = [&](Folder *f, const auto &sf) -> void {
-                        sortChildFunc(f);
-                        for (auto c : f->children) {
-                            sf(c, sf);
-                        }
-                    };
-                    sortFunc(rootFolder, sortFunc);
-                    auto matchFunc = [&](Folder *f, const auto &mf) -> void {
-                        matchFolderFunc(f->id, matchFolderFunc);
-                        for (auto c : f->children) {
-                            mf(c, mf);
-                        }
-                    };
-                    matchFunc(rootFolder, matchFunc);
-                } else {
-                    qDebug() << __FUNCTION__ << "Error while keeping folder position";
-                    for (const auto &node : qAsConst(nodeList)) {
-                        matchFolderFunc(node.id(), matchFolderFunc);
-                    }
-                }
-            } else {
-                qDebug() << __FUNCTION__ << __LINE__ << out_qr.lastError();
-            }
-        }
-        {
-            QSqlQuery out_qr(outside_db);
-            out_qr.prepare(R"(SELECT)"
-                           R"("id",)"
-                           R"("title",)"
-                           R"("creation_date",)"
-                           R"("modification_date",)"
-                           R"("deletion_date",)"
-                           R"("content",)"
-                           R"("node_type",)"
-                           R"("parent_id",)"
-                           R"("relative_position",)"
-                           R"("scrollbar_position",)"
-                           R"("absolute_path", )"
-                           R"("is_pinned_note", )"
-                           R"("relative_position_an" )"
-                           R"(FROM node_table WHERE node_type=:node_type;)");
-
-            out_qr.bindValue(":node_type", static_cast<int>(NodeData::Type::Note));
-            bool status = out_qr.exec();
-            QVector<NodeData> nodeList;
-            QMap<int, std::pair<NodeData, int>> parents;
-            for (const auto &id : qAsConst(folderIdMap)) {
-                if (parents.contains(id)) {
-                    continue;
-                }
-                auto node = getNode(id);
-                auto rel = nextAvailablePosition(id, NodeData::Note);
-                parents[id] = std::make_pair(node, rel);
-            }
-            if (status) {
-                while (out_qr.next()) {
-                    NodeData node;
-                    node.setId(out_qr.value(0).toInt());
-                    node.setFullTitle(out_qr.value(1).toString());
-                    node.setCreationDateTime(
-                            QDateTime::fromMSecsSinceEpoch(out_qr.value(2).toLongLong()));
-                    node.setLastModificationDateTime(
-                            QDateTime::fromMSecsSinceEpoch(out_qr.value(3).toLongLong()));
-                    node.setDeletionDateTime(
-                            QDateTime::fromMSecsSinceEpoch(out_qr.value(4).toLongLong()));
-                    node.setContent(out_qr.value(5).toString());
-                    node.setNodeType(static_cast<NodeData::Type>(out_qr.value(6).toInt()));
-                    node.setParentId(out_qr.value(7).toInt());
-                    node.setRelativePosition(out_qr.value(8).toInt());
-                    node.setScrollBarPosition(out_qr.value(9).toInt());
-                    node.setAbsolutePath(out_qr.value(10).toString());
-                    node.setIsPinnedNote(static_cast<bool>(out_qr.value(11).toInt()));
-                    node.setRelativePosAN(out_qr.value(13).toInt());
-                    node.setChildNotesCount(out_qr.value(14).toInt());
-                    node.setTagIds(getAllTagForNote(node.id()));
-                    nodeList.append(node);
-                }
-                m_db.transaction();
-                auto nodeId = nextAvailableNodeId();
-                for (auto node : qAsConst(nodeList)) {
-                    if (folderIdMap.contains(node.parentId())
-                        && parents.contains(folderIdMap[node.parentId()])) {
-                        auto parentId = folderIdMap[node.parentId()];
-                        auto parent = parents[parentId].first;
-                        auto oldId = node.id();
-                        node.setId(nodeId);
-                        node.setRelativePosition(parents[parentId].second);
-                        node.setAbsolutePath(parent.absolutePath() + PATH_SEPARATOR
-                                             + QString::number(nodeId));
-                        node.setParentId(parentId);
-                        addNodePreComputed(node);
-                        ++nodeId;
-                        parents[parentId].second = node.relativePosition() + 1;
-                        noteIdMap[oldId] = node.id();
-                    } else {
-                        qDebug() << __FUNCTION__ << __LINE__ << "can't find parent for note";
-                    }
-                }
-                QSqlQuery query(m_db);
-                query.prepare(
-                        R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)");
-                query.bindValue(":value", nodeId + 1);
-                if (!query.exec()) {
-                    qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-                }
-                m_db.commit();
-            } else {
-                qDebug() << __FUNCTION__ << __LINE__ << out_qr.lastError();
-            }
-        }
-        {
-            QSqlQuery out_qr(outside_db);
-            out_qr.prepare(R"(SELECT "tag_id", "node_id" FROM tag_relationship)");
-            bool status = out_qr.exec();
-            QVector<std::pair<int, int>> tagRela;
-            if (status) {
-                while (out_qr.next()) {
-                    tagRela.append(
-                            std::make_pair(out_qr.value(0).toInt(), out_qr.value(1).toInt()));
-                }
-                m_db.transaction();
-                for (const auto &rel : qAsConst(tagRela)) {
-                    if (tagIdMap.contains(rel.first) && noteIdMap.contains(rel.second)) {
-                        addNoteToTag(noteIdMap[rel.second], tagIdMap[rel.first]);
-                    } else {
-                        qDebug() << __FUNCTION__ << __LINE__ << "tag relationship is not valid";
-                    }
-                }
-                m_db.commit();
-            } else {
-                qDebug() << __FUNCTION__ << __LINE__ << out_qr.lastError();
-            }
-        }
-        {
-            outside_db.close();
-            outside_db = QSqlDatabase::database();
+        isImported = importDatabase(fileName);
+        if (!isImported) {
+            emit showErrorMessage(tr("Invalid file"), "Please select a valid notes export file");
         }
+        QTimer::singleShot(0, this, &DBManager::backfillNotePreviews);
     } else {
         auto noteList = readOldNBK(fileName);
         if (noteList.isEmpty()) {
+            isImported = false;
             emit showErrorMessage(tr("Invalid file"), "Please select a valid notes export file");
         } else {
             auto defaultNoteFolder = getNode(SpecialNodeID::DefaultNotesFolder);
-            int nodeId = nextAvailableNodeId();
             int notePos = nextAvailablePosition(defaultNoteFolder.id(), NodeData::Note);
             QString parentAbsPath = defaultNoteFolder.absolutePath();
             m_db.transaction();
+            int nodeId = reserveNodeIds(noteList.size());
             for (auto &note : noteList) {
                 note.setId(nodeId);
                 note.setRelativePosition(notePos);
@@ -2074,60 +2871,100 @@ void DBManager::onImportNotesRequested(const QString &fileName)
                 ++nodeId;
                 ++notePos;
             }
-            QSqlQuery query(m_db);
-            query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)");
-            query.bindValue(":value", nodeId + 1);
-            if (!query.exec()) {
-                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-            }
             m_db.commit();
         }
     }
-    recalculateChildNotesCount();
+    verifyChildNotesCounts();
     onNodeTagTreeRequested();
+    return isImported;
 }
 
 /*!
  * \brief DBManager::onRestoreNotesRequested
- * \param noteList
+ * \param fileName
+ * \return false if the notes could not be replaced
  */
-void DBManager::onRestoreNotesRequested(const QString &fileName)
+bool DBManager::onRestoreNotesRequested(const QString &fileName)
 {
     QFile file(fileName);
     if (!file.open(QIODevice::ReadOnly)) {
         qDebug() << __FUNCTION__ << __LINE__ << "fail to open file";
-        return;
+        return false;
     }
     auto magic_header = file.read(16);
     file.close();
     if (QString::fromUtf8(magic_header).startsWith(QStringLiteral("SQLite format 3"))) {
+        // Rebuild the backup into a file next to the database first, the live database is
+        // only swapped out once a complete and checked copy exists
+        QString restorePath = m_dbpath + QStringLiteral(".restore");
+        QFile::remove(restorePath);
+        bool isValid = false;
         {
-            m_db.close();
-            m_db = QSqlDatabase::database();
+            QSqlDatabase source = QSqlDatabase::addDatabase("QSQLITE", OUTSIDE_DATABASE_NAME);
+            source.setDatabaseName(fileName);
+            source.setConnectOptions(QStringLiteral("QSQLITE_OPEN_READONLY"));
+            if (source.open()) {
+                QSqlQuery query(source);
+                isValid = query.exec(QStringLiteral("PRAGMA quick_check;")) && query.next()
+                        && query.value(0).toString() == QStringLiteral("ok");
+                query.finish();
+                isValid = isValid && vacuumInto(source, restorePath);
+                source.close();
+            }
         }
-        QSqlDatabase::removeDatabase(DEFAULT_DATABASE_NAME);
-        QFile::remove(m_dbpath);
-        if (!QFile::copy(fileName, m_dbpath)) {
+        QSqlDatabase::removeDatabase(OUTSIDE_DATABASE_NAME);
+        if (!isValid) {
             qDebug() << __FUNCTION__ << "Can't import notes";
-        };
-        open(m_dbpath, false);
+            QFile::remove(restorePath);
+            emit showErrorMessage(tr("Invalid file"), "Please select a valid notes export file");
+            return false;
+        }
+        // the live database is only moved aside, it comes back if the restored copy can't
+        // be put in place or opened and is deleted once the copy is open
+        QString oldPath = m_dbpath + QStringLiteral(".old");
+        close();
+        removeDatabaseFiles(oldPath);
+        if (!moveDatabaseFiles(m_dbpath, oldPath)) {
+            QFile::remove(restorePath);
+            open(m_dbpath, false);
+            emit showErrorMessage(tr("Restore failed"),
+                                  tr("The current notes could not be moved aside."));
+            return false;
+        }
+        if (!moveDatabaseFiles(restorePath, m_dbpath) || !open(m_dbpath, false)) {
+            qDebug() << __FUNCTION__ << "Can't import notes";
+            close();
+            removeDatabaseFiles(m_dbpath);
+            QFile::remove(restorePath);
+            moveDatabaseFiles(oldPath, m_dbpath);
+            open(m_dbpath, false);
+            emit showErrorMessage(tr("Restore failed"), tr("The current notes were kept."));
+            return false;
+        }
+        removeDatabaseFiles(oldPath);
     } else {
         auto noteList = readOldNBK(fileName);
         if (noteList.isEmpty()) {
             emit showErrorMessage(tr("Invalid file"), "Please select a valid notes export file");
+            return false;
         } else {
-            {
-                m_db.close();
-                m_db = QSqlDatabase::database();
+            QString oldPath = m_dbpath + QStringLiteral(".old");
+            close();
+            removeDatabaseFiles(oldPath);
+            if (!moveDatabaseFiles(m_dbpath, oldPath) || !open(m_dbpath, true)) {
+                close();
+                removeDatabaseFiles(m_dbpath);
+                moveDatabaseFiles(oldPath, m_dbpath);
+                open(m_dbpath, false);
+                emit showErrorMessage(tr("Restore failed"), tr("The current notes were kept."));
+                return false;
             }
-            QSqlDatabase::removeDatabase(DEFAULT_DATABASE_NAME);
-            QFile::remove(m_dbpath);
-            open(m_dbpath, true);
+            removeDatabaseFiles(oldPath);
             auto defaultNoteFolder = getNode(SpecialNodeID::DefaultNotesFolder);
-            int nodeId = nextAvailableNodeId();
             int notePos = nextAvailablePosition(defaultNoteFolder.id(), NodeData::Note);
             QString parentAbsPath = defaultNoteFolder.absolutePath();
             m_db.transaction();
+            int nodeId = reserveNodeIds(noteList.size());
             for (auto &note : noteList) {
                 note.setId(nodeId);
                 note.setRelativePosition(notePos);
@@ -2140,40 +2977,204 @@ void DBManager::onRestoreNotesRequested(const QString &fileName)
                 ++nodeId;
                 ++notePos;
             }
-            QSqlQuery query(m_db);
-            query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)");
-            query.bindValue(":value", nodeId + 1);
-            if (!query.exec()) {
-                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-            }
             m_db.commit();
         }
     }
-    recalculateChildNotesCount();
+    verifyChildNotesCounts();
     onNodeTagTreeRequested();
+    return true;
 }
 
 /*!
  * \brief DBManager::onExportNotesRequested
+ * Write a consistent copy of the database to \a fileName, see startBackup
  * \param fileName
  */
 void DBManager::onExportNotesRequested(const QString &fileName)
+{
+    startBackup(fileName, false);
+}
+
+/*!
+ * \brief DBManager::vacuumInto
+ * Let SQLite write a compacted, transactionally consistent copy of \a db to \a fileName.
+ * Pages still in the write-ahead log are included, unlike a plain file copy. The copy is
+ * one statement inside one read transaction, it can't be paused or done in steps.
+ */
+bool DBManager::vacuumInto(QSqlDatabase &db, const QString &fileName)
+{
+    QSqlQuery query(db);
+    query.prepare(QStringLiteral("VACUUM INTO :file_name;"));
+    query.bindValue(QStringLiteral(":file_name"), fileName);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return false;
+    }
+    return true;
+}
+
+bool DBManager::isWriteAheadLogEnabled()
 {
     QSqlQuery query(m_db);
-    query.prepare("BEGIN IMMEDIATE;");
-    bool status = query.exec();
-    if (!status) {
+    if (!query.exec(QStringLiteral("PRAGMA journal_mode;")) || !query.next()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return false;
+    }
+    return query.value(0).toString().compare(QStringLiteral("wal"), Qt::CaseInsensitive) == 0;
+}
+
+/*!
+ * \brief DBManager::startBackup
+ * The copy is written to "<fileName>.part" and renamed when complete. It runs on its own
+ * read-only connection on the thread pool, so note saves keep going through this thread
+ * meanwhile and progress is reported from the growing file.
+ * That needs WAL mode: with a rollback journal the reader's lock would make those saves fail
+ * with SQLITE_BUSY, and VACUUM INTO is a single statement that, unlike sqlite3_backup_step,
+ * can't hand the database back between pages. Automatic backups are skipped then, a backup
+ * asked for by the user runs here and backupStarted tells that saves wait until it is done.
+ * \param fileName
+ * \param isAutomatic if true, older automatic backups are pruned afterwards
+ */
+void DBManager::startBackup(const QString &fileName, bool isAutomatic)
+{
+    if (m_isBackupRunning) {
+        qDebug() << __FUNCTION__ << __LINE__ << "a backup is already running";
+        if (!isAutomatic) {
+            emit backupFinished(fileName, false);
+        }
+        return;
+    }
+    bool isWriteAheadLog = isWriteAheadLogEnabled();
+    if (!isWriteAheadLog && isAutomatic) {
+        qDebug() << __FUNCTION__ << __LINE__
+                 << "automatic backup skipped, it would block saves without WAL mode";
+        return;
+    }
+    m_isBackupRunning = true;
+
+    qint64 totalBytes = 0;
+    QSqlQuery query(m_db);
+    if (query.exec(QStringLiteral("SELECT page_count - freelist_count, page_size "
+                                  "FROM pragma_page_count(), pragma_freelist_count(), "
+                                  "pragma_page_size();"))
+        && query.next()) {
+        totalBytes = query.value(0).toLongLong() * query.value(1).toLongLong();
+    }
+    QString partPath = fileName + QStringLiteral(".part");
+    QFile::remove(partPath);
+    emit backupStarted(fileName, !isWriteAheadLog);
+    emit backupProgress(0, totalBytes);
+
+    if (!isWriteAheadLog) {
+        finishBackup(fileName, vacuumInto(m_db, partPath), isAutomatic);
+        return;
+    }
+
+    if (!m_backupProgressTimer) {
+        m_backupProgressTimer = new QTimer(this);
+        m_backupProgressTimer->setInterval(200);
+    }
+    m_backupProgressTimer->disconnect();
+    connect(m_backupProgressTimer, &QTimer::timeout, this, [this, partPath, totalBytes]() {
+        emit backupProgress(qMin(QFileInfo(partPath).size(), totalBytes), totalBytes);
+    });
+    m_backupProgressTimer->start();
+
+    QString dbPath = m_dbpath;
+    // kept so that closing or moving the database can wait for the copy to let go of it
+    m_backupTask = QtConcurrent::run([dbPath, partPath]() {
+        QString connectionName = QStringLiteral("backup_database");
+        bool isSuccess = false;
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+            db.setDatabaseName(dbPath);
+            db.setConnectOptions(QStringLiteral("QSQLITE_OPEN_READONLY"));
+            isSuccess = db.open() && vacuumInto(db, partPath);
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(connectionName);
+        return isSuccess;
+    });
+    m_backupTask.then(this, [this, fileName, isAutomatic](bool isSuccess) {
+        m_backupProgressTimer->stop();
+        finishBackup(fileName, isSuccess, isAutomatic);
+    });
+}
+
+void DBManager::finishBackup(const QString &fileName, bool isSuccess, bool isAutomatic)
+{
+    QString partPath = fileName + QStringLiteral(".part");
+    if (isSuccess) {
+        QFile::remove(fileName);
+        isSuccess = QFile::rename(partPath, fileName);
     }
-    QFile::remove(fileName);
-    if (!QFile::copy(m_dbpath, fileName)) {
+    if (!isSuccess) {
         qDebug() << __FUNCTION__ << "Can't export notes";
-    };
+        QFile::remove(partPath);
+    }
+    m_isBackupRunning = false;
+    qint64 size = QFileInfo(fileName).size();
+    emit backupProgress(size, size);
+    emit backupFinished(fileName, isSuccess);
+    if (isSuccess && isAutomatic) {
+        pruneAutoBackups();
+    }
+}
 
-    query.prepare("ROLLBACK;");
-    status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+QString DBManager::autoBackupDirectory() const
+{
+    return QFileInfo(m_dbpath).absolutePath() + QStringLiteral("/backups");
+}
+
+/*!
+ * \brief DBManager::setAutoBackup
+ * Snapshot the database into a "backups" directory next to it every \a intervalMinutes,
+ * keeping the \a keepCount most recent snapshots. An interval of 0 turns it off, so does a
+ * database without WAL mode, where every snapshot would hold up note saves.
+ */
+void DBManager::setAutoBackup(int intervalMinutes, int keepCount)
+{
+    m_autoBackupKeepCount = qMax(keepCount, 1);
+    if (intervalMinutes > 0 && !isWriteAheadLogEnabled()) {
+        emit showErrorMessage(tr("Automatic backups are off"),
+                              tr("Automatic backups need the database in WAL mode, with the "
+                                 "\"compatible\" storage profile they would pause saving."));
+        intervalMinutes = 0;
+    }
+    if (intervalMinutes <= 0) {
+        if (m_autoBackupTimer) {
+            m_autoBackupTimer->stop();
+        }
+        return;
+    }
+    if (!m_autoBackupTimer) {
+        m_autoBackupTimer = new QTimer(this);
+        connect(m_autoBackupTimer, &QTimer::timeout, this, &DBManager::onAutoBackupTimeout);
+    }
+    m_autoBackupTimer->start(intervalMinutes * 60 * 1000);
+}
+
+void DBManager::onAutoBackupTimeout()
+{
+    QString directory = autoBackupDirectory();
+    if (!QDir().mkpath(directory)) {
+        qDebug() << __FUNCTION__ << __LINE__ << "Can't create" << directory;
+        return;
+    }
+    QString fileName = directory + QStringLiteral("/notes_")
+            + QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd_HHmmss"))
+            + QStringLiteral(".nbk");
+    startBackup(fileName, true);
+}
+
+void DBManager::pruneAutoBackups()
+{
+    QDir directory(autoBackupDirectory());
+    // the timestamp in the name sorts oldest first
+    QStringList backups = directory.entryList({ QStringLiteral("notes_*.nbk") }, QDir::Files,
+                                              QDir::Name);
+    while (backups.size() > m_autoBackupKeepCount) {
+        directory.remove(backups.takeFirst());
     }
 }
 
@@ -2184,11 +3185,11 @@ void DBManager::onExportNotesRequested(const QString &fileName)
 void DBManager::onMigrateNotesFromV0_9_0Requested(QVector<NodeData> &noteList)
 {
     auto defaultNoteFolder = getNode(SpecialNodeID::DefaultNotesFolder);
-    int nodeId = nextAvailableNodeId();
     int notePos = nextAvailablePosition(defaultNoteFolder.id(), NodeData::Note);
     QString parentAbsPath = defaultNoteFolder.absolutePath();
 
     m_db.transaction();
+    int nodeId = reserveNodeIds(noteList.size());
     for (auto &note : noteList) {
         note.setId(nodeId);
         note.setRelativePosition(notePos);
@@ -2201,14 +3202,8 @@ void DBManager::onMigrateNotesFromV0_9_0Requested(QVector<NodeData> &noteList)
         ++nodeId;
         ++notePos;
     }
-    QSqlQuery query(m_db);
-    query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)");
-    query.bindValue(":value", nodeId + 1);
-    if (!query.exec()) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
     m_db.commit();
-    recalculateChildNotesCount();
+    verifyChildNotesCounts();
 }
 
 /*!
@@ -2218,11 +3213,11 @@ void DBManager::onMigrateNotesFromV0_9_0Requested(QVector<NodeData> &noteList)
 void DBManager::onMigrateTrashFrom0_9_0Requested(QVector<NodeData> &noteList)
 {
     auto trashFolder = getNode(SpecialNodeID::TrashFolder);
-    int nodeId = nextAvailableNodeId();
     int notePos = nextAvailablePosition(trashFolder.id(), NodeData::Note);
     QString parentAbsPath = trashFolder.absolutePath();
 
     m_db.transaction();
+    int nodeId = reserveNodeIds(noteList.size());
     for (auto &note : noteList) {
         note.setId(nodeId);
         note.setRelativePosition(notePos);
@@ -2235,14 +3230,8 @@ void DBManager::onMigrateTrashFrom0_9_0Requested(QVector<NodeData> &noteList)
         ++nodeId;
         ++notePos;
     }
-    QSqlQuery query(m_db);
-    query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)");
-    query.bindValue(":value", nodeId + 1);
-    if (!query.exec()) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
     m_db.commit();
-    recalculateChildNotesCount();
+    verifyChildNotesCounts();
 }
 
 void DBManager::onMigrateNotesFrom1_5_0Requested(const QString &fileName)
@@ -2315,10 +3304,10 @@ void DBManager::onMigrateNotesFrom1_5_0Requested(const QString &fileName)
     }
     auto defaultNoteFolder = getNode(SpecialNodeID::DefaultNotesFolder);
     auto trashFolder = getNode(SpecialNodeID::TrashFolder);
-    int nodeId = nextAvailableNodeId();
     int notePos = nextAvailablePosition(defaultNoteFolder.id(), NodeData::Note);
     QString parentAbsPath = defaultNoteFolder.absolutePath();
     m_db.transaction();
+    int nodeId = reserveNodeIds(notes.size() + trash.size());
     for (auto &note : notes) {
         note.setId(nodeId);
         note.setRelativePosition(notePos);
@@ -2345,30 +3334,58 @@ void DBManager::onMigrateNotesFrom1_5_0Requested(const QString &fileName)
         ++nodeId;
         ++notePos;
     }
-    QSqlQuery query(m_db);
-    query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)");
-    query.bindValue(":value", nodeId + 1);
-    if (!query.exec()) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
     m_db.commit();
     {
         old_db.close();
         old_db = QSqlDatabase::database();
     }
     QSqlDatabase::removeDatabase(OUTSIDE_DATABASE_NAME);
-    recalculateChildNotesCount();
+    verifyChildNotesCounts();
 }
 
-void DBManager::onChangeDatabasePathRequested(const QString &newPath)
+/*!
+ * \brief DBManager::onChangeDatabasePathRequested
+ * Move the database to \a newPath. The write-ahead log is checkpointed into the main file
+ * first. The database stays where it is if it can't be moved, and is moved back if it
+ * can't be opened at \a newPath.
+ * \return false if the database is still at the old path
+ */
+bool DBManager::onChangeDatabasePathRequested(const QString &newPath)
 {
+    const QString oldPath = m_dbpath;
+    m_backupTask.waitForFinished();
+    // readers hold snapshots that keep a checkpoint from truncating the log
+    stopReaders();
+    clearStatementCache();
     {
-        m_db.commit();
-        m_db.close();
-        m_db = QSqlDatabase::database();
+        QSqlQuery query(m_db);
+        if (!query.exec(QStringLiteral("PRAGMA wal_checkpoint(TRUNCATE);"))) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+    }
+    close();
+    if (!moveDatabaseFiles(oldPath, newPath)) {
+        open(oldPath, false);
+        emit showErrorMessage(tr("Unable to change database path"),
+                              tr("The database could not be moved to %1.").arg(newPath));
+        return false;
+    }
+    if (open(newPath, false)) {
+        return true;
+    }
+    // the caller keeps the old path in the settings, so the notes have to be there again
+    close();
+    if (!moveDatabaseFiles(newPath, oldPath)) {
+        qDebug() << __FUNCTION__ << __LINE__ << "Can't move the database back to" << oldPath;
+        emit showErrorMessage(tr("Unable to change database path"),
+                              tr("The database could not be opened or moved back, it is at %1.")
+                                      .arg(newPath));
+        return false;
     }
-    QFile::rename(m_dbpath, newPath);
-    open(newPath, false);
+    open(oldPath, false);
+    emit showErrorMessage(tr("Unable to change database path"),
+                          tr("The database could not be opened at %1.").arg(newPath));
+    return false;
 }
 
 bool DBManager::IsDatabaseHasNotes()
@@ -2445,170 +3462,140 @@ void DBManager::addExampleNotes()
 
 void DBManager::addNotesToDefaultFolder(const QStringList &notes)
 {
-    auto defaultNoteFolder = getNode(SpecialNodeID::DefaultNotesFolder);
-    int nodeId = nextAvailableNodeId();
-    int notePos = nextAvailablePosition(defaultNoteFolder.id(), NodeData::Note);
-    QString parentAbsPath = defaultNoteFolder.absolutePath();
     QDateTime currentDate = QDateTime::currentDateTime();
-
+    QVector<NodeData> newNotes;
+    newNotes.reserve(notes.size());
     for (auto &noteString : notes) {
         NodeData note;
         note.setFullTitle(noteString.split("\n", Qt::SkipEmptyParts).first());
         note.setContent(noteString);
-        note.setId(nodeId);
-        note.setRelativePosition(notePos);
-        note.setAbsolutePath(parentAbsPath + PATH_SEPARATOR + QString::number(nodeId));
         note.setNodeType(NodeData::Note);
-        note.setParentId(defaultNoteFolder.id());
+        note.setParentId(SpecialNodeID::DefaultNotesFolder);
         note.setParentName("Notes");
         note.setIsTempNote(false);
         note.setCreationDateTime(currentDate);
         note.setLastModificationDateTime(currentDate);
-
-        addNode(note);
-        ++nodeId;
-        ++notePos;
+        newNotes.append(note);
     }
+    addNodesBulk(newNotes);
 
-    recalculateChildNotesCount();
     onNodeTagTreeRequested();
 }
 
-void DBManager::addNotesToNewImportedFolder(const QList<QPair<QString, QDateTime>> &fileDatas)
+/*!
+ * \brief DBManager::addFolderTree
+ * Create a folder named \a rootTitle under the root folder and recreate \a relativeDirs
+ * ('/' separated, relative to the imported directory) below it. Missing intermediate
+ * folders are created as well. The whole tree is one transaction.
+ * \return folder id for every relative directory, the empty string maps to the new root;
+ * empty if a folder couldn't be added, nothing is left behind then
+ */
+QHash<QString, int> DBManager::addFolderTree(const QString &rootTitle,
+                                             const QStringList &relativeDirs)
 {
-    NodeData newFolder;
-    newFolder.setNodeType(NodeData::Folder);
+    assertOnDatabaseThread(__FUNCTION__);
+    QHash<QString, int> folderIds;
     QDateTime currentDate = QDateTime::currentDateTime();
-    newFolder.setCreationDateTime(currentDate);
-    newFolder.setLastModificationDateTime(currentDate);
-    newFolder.setFullTitle("Imported Notes");
-    newFolder.setParentId(SpecialNodeID::RootFolder);
-
-    int newFolderId = addNode(newFolder);
-    if (newFolderId <= 0) {
-        qDebug() << "Failed to add 'Imported Notes' folder.";
-        return;
-    }
-
-    NodeData createdFolder = getNode(newFolderId);
-    QString parentAbsPath = createdFolder.absolutePath();
-
-    int nodeId = nextAvailableNodeId();
-    int notePos = 0;
-
-    for (const auto &noteData : fileDatas) {
-        NodeData note;
-        note.setFullTitle(noteData.first.section('\n', 0, 0, QString::SectionSkipEmpty));
-        note.setContent(noteData.first);
-        note.setId(nodeId++);
-        note.setRelativePosition(notePos++);
-        note.setAbsolutePath(parentAbsPath + PATH_SEPARATOR + QString::number(note.id()));
-        note.setNodeType(NodeData::Note);
-        note.setParentId(newFolderId);
-        note.setCreationDateTime(noteData.second);
-        note.setLastModificationDateTime(noteData.second);
-
-        addNode(note);
-    }
-
-    recalculateChildNotesCount();
-    onNodeTagTreeRequested();
-}
-
-void DBManager::exportNotes(const QString &baseExportPath, const QString &extension)
-{
-    // Ensure the export directory exists
-    QString rootFolderName = QStringLiteral("Plume Notes");
-    QString exportPathNew = baseExportPath + QDir::separator() + rootFolderName;
-    QDir directory;
-
-    int counter = 1;
-    while (directory.exists(exportPathNew)) {
-        exportPathNew = baseExportPath + QDir::separator() + rootFolderName + " " + QString::number(counter++);
-    }
-    qDebug() << "Exporting notes to:" << exportPathNew;
-    directory.mkpath(exportPathNew);
-
-           // Retrieve all folders first to create the directory structure
-    QVector<NodeData> folders = getAllFolders();
-
-           // Create directories for each folder
-    QMap<int, QString> folderPaths;
-    for (const NodeData &folder : folders) {
-        QString path = exportPathNew;
-        if (folder.id() != SpecialNodeID::RootFolder) { // Skip root folder
-            QStringList folderNames;
-            QString currentPath = folder.absolutePath();
-            QStringList pathParts = currentPath.split(QDir::separator(), Qt::SkipEmptyParts);
-            for (const auto &part : pathParts) {
-                int id = part.toInt();
-                if (id == SpecialNodeID::RootFolder)
-                    continue;
-                auto folderTemp = getNode(id);
-                folderNames << folderTemp.fullTitle();
-            }
-            QString relativePath = folderNames.join(QDir::separator());
-            path += QDir::separator() + relativePath;
+    auto addFolder = [&](const QString &title, int parentId) {
+        NodeData folder;
+        folder.setNodeType(NodeData::Folder);
+        folder.setCreationDateTime(currentDate);
+        folder.setLastModificationDateTime(currentDate);
+        folder.setFullTitle(title);
+        folder.setParentId(parentId);
+        return addNode(folder);
+    };
+    // a folder that fails must not leave its subtree flattened into its parent
+    bool isOwnTransaction = m_db.transaction();
+    auto abort = [this, isOwnTransaction]() {
+        if (isOwnTransaction) {
+            m_db.rollback();
+        }
+        return QHash<QString, int>();
+    };
 
-            counter = 1;
-            while (directory.exists(path)) {
-                path = exportPathNew + QDir::separator() + relativePath + " " + QString::number(counter++);
+    int rootId = addFolder(rootTitle, SpecialNodeID::RootFolder);
+    if (rootId <= 0) {
+        qDebug() << __FUNCTION__ << __LINE__ << "Failed to add folder" << rootTitle;
+        return abort();
+    }
+    folderIds[QString()] = rootId;
+
+    QStringList dirs = relativeDirs;
+    dirs.sort();
+    for (const auto &dir : qAsConst(dirs)) {
+        QString currentPath;
+        int parentId = rootId;
+        const QStringList parts = dir.split('/', Qt::SkipEmptyParts);
+        for (const auto &part : parts) {
+            currentPath = currentPath.isEmpty() ? part : currentPath + '/' + part;
+            auto it = folderIds.constFind(currentPath);
+            if (it == folderIds.constEnd()) {
+                int id = addFolder(part, parentId);
+                if (id <= 0) {
+                    qDebug() << __FUNCTION__ << __LINE__ << "Failed to add folder"
+                             << currentPath;
+                    return abort();
+                }
+                it = folderIds.insert(currentPath, id);
             }
-
-            QDir().mkpath(path);
+            parentId = it.value();
         }
-        // qDebug() << "path: " << path;
-        folderPaths.insert(folder.id(), path);
     }
+    if (isOwnTransaction && !m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        m_db.rollback();
+        return QHash<QString, int>();
+    }
+    return folderIds;
+}
 
-           // Retrieve all notes
+/*!
+ * \brief DBManager::exportSnapshot
+ * Read every folder and note needed for a plain text export in one read transaction,
+ * so the files can be written elsewhere without holding up the database thread.
+ * Folders carry id, title and absolute path, notes additionally parent id and
+ * modification date. Bodies are left out, getNoteContents loads them for the notes
+ * that actually have to be written.
+ */
+NoteExportSnapshot DBManager::exportSnapshot()
+{
+    assertOnDatabaseThread(__FUNCTION__);
+    NoteExportSnapshot snapshot;
+    m_db.transaction();
     QSqlQuery query(m_db);
-    query.prepare(R"(SELECT "id", "title", "content", "parent_id" FROM node_table WHERE node_type = :note_type)");
-    query.bindValue(":note_type", static_cast<int>(NodeData::Type::Note));
-
+    query.prepare(R"(SELECT "id", "title", "absolute_path" FROM node_table )"
+                  R"(WHERE node_type = :folder_type ORDER BY "absolute_path";)");
+    query.bindValue(":folder_type", static_cast<int>(NodeData::Type::Folder));
     if (!query.exec()) {
-        qDebug() << "Failed to retrieve notes for export:" << query.lastError();
-        return;
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-
-           // Export each note as a .txt file in its corresponding directory
-    QTextDocument doc;
     while (query.next()) {
-        // int noteId = query.value(0).toInt();
-        QString title = query.value(1).toString();
-        QString content = query.value(2).toString();
-        int parentId = query.value(3).toInt();
-
-        QString notePath = folderPaths[parentId];
-        QString safeTitle = title;
-        if (safeTitle.contains("<br />"))
-            safeTitle = safeTitle.section("<br />", 0, 0, QString::SectionSkipEmpty);
-        safeTitle = safeTitle.simplified();
-        doc.setMarkdown(safeTitle);
-        safeTitle = doc.toPlainText();
-        safeTitle.replace(QRegularExpression(R"([\/\\:*?"<>|])"), "_"); // Make the title filesystem-safe
-        QString filePath = notePath + QDir::separator() + safeTitle + extension;
-
-        if (safeTitle.isEmpty()) {
-            safeTitle = QStringLiteral("Untitled Note");
-        }
-
-        counter = 1;
-        while (directory.exists(filePath)) {
-            filePath = notePath + QDir::separator() + safeTitle + " " + QString::number(counter++) + extension;
-        }
-
-        // qDebug() << "Exporting note:" << filePath;
-
-        QFile file(filePath);
-        if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-            QTextStream out(&file);
-            out << content;
-            file.close();
-        } else {
-            qDebug() << "Failed to export note:" << filePath;
-        }
+        NodeData folder;
+        folder.setNodeType(NodeData::Folder);
+        folder.setId(query.value(0).toInt());
+        folder.setFullTitle(query.value(1).toString());
+        folder.setAbsolutePath(query.value(2).toString());
+        snapshot.folders.append(folder);
     }
 
-    qDebug() << "Export completed to:" << baseExportPath;
+    query.prepare(R"(SELECT "id", "title", "parent_id", "modification_date", "absolute_path" )"
+                  R"(FROM node_table WHERE node_type = :note_type;)");
+    query.bindValue(":note_type", static_cast<int>(NodeData::Type::Note));
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    while (query.next()) {
+        NodeData note;
+        note.setNodeType(NodeData::Note);
+        note.setId(query.value(0).toInt());
+        note.setFullTitle(query.value(1).toString());
+        note.setParentId(query.value(2).toInt());
+        note.setLastModificationDateTime(
+                QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
+        note.setAbsolutePath(query.value(4).toString());
+        snapshot.notes.append(note);
+    }
+    m_db.commit();
+    return snapshot;
 }
@@ -6,10 +6,25 @@
 #include "nodepath.h"
 #include <QObject>
 #include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
 #include <QPair>
 #include <QSet>
+#include <QHash>
+#include <QThreadPool>
 #include <QVector>
 #include <QTextDocument>
+#include <QFuture>
+#include <QPromise>
+#include <memory>
+#include <atomic>
+
+// the request API is built on QPromise and QFuture::then with a context object
+#if QT_VERSION < QT_VERSION_CHECK(6, 1, 0)
+#  error "Plume needs Qt 6.1 or later"
+#endif
+
+class QTimer;
+class QSettings;
 
 struct NodeTagTreeData
 {
@@ -26,6 +41,49 @@ struct ListViewInfo
     QSet<int> currentNotesId;
     bool needCreateNewNote;
     int scrollToId;
+    quint64 requestId = 0;
+};
+
+/*!
+ * The statements getNoteList runs for a list condition, in order
+ */
+struct NoteListStatements
+{
+    QString folders;
+    QString tags;
+    QString notes;
+};
+
+struct NoteExportSnapshot
+{
+    QVector<NodeData> folders;
+    QVector<NodeData> notes;
+};
+
+/*!
+ * Connection level pragmas applied when the database is opened.
+ * Profiles: "balanced" (default) WAL with synchronous=NORMAL, "durable" WAL with
+ * synchronous=FULL, "compatible" the SQLite defaults with a rollback journal.
+ */
+struct StorageSettings
+{
+    QString journalMode;
+    QString synchronous;
+    int cacheSizeKiB;
+    int mmapSizeMiB;
+    QString tempStore;
+    // passive WAL checkpoint once writes paused this long, 0 leaves it to SQLite
+    int checkpointIdleMs;
+
+    static StorageSettings fromProfile(const QString &profile);
+    static StorageSettings fromSettings(QSettings *settings);
+};
+
+struct StatementCacheStats
+{
+    quint64 prepares = 0;
+    // cachedQuery calls, whether the caller then executes the statement is up to it
+    quint64 lookups = 0;
 };
 
 using FolderListType = QMap<int, QString>;
@@ -34,40 +92,132 @@ class DBManager : public QObject
 {
     Q_OBJECT
 public:
-    void exportNotes(const QString &exportPath, const QString &extension);
+    NoteExportSnapshot exportSnapshot();
     void addExampleNotes();
-    void addNotesToNewImportedFolder(const QList<QPair<QString, QDateTime> > &fileDatas);
     void addNotesToDefaultFolder(const QStringList &notes);
     bool IsDatabaseHasNotes();
     explicit DBManager(QObject *parent = nullptr);
+    ~DBManager() override;
     Q_INVOKABLE NodePath getNodeAbsolutePath(int nodeId);
-    Q_INVOKABLE NodeData getNode(int nodeId);
+    NodeData getNode(int nodeId);
+    QString getNoteContent(int noteId);
+    QHash<int, QString> getNoteContents(const QVector<int> &noteIds);
     Q_INVOKABLE void moveFolderToTrash(const NodeData &node);
-    Q_INVOKABLE FolderListType getFolderList();
+    FolderListType getFolderList();
+    int addNode(const NodeData &node);
+    QVector<int> addNodesBulk(const QVector<NodeData> &nodes);
+    QHash<QString, int> addFolderTree(const QString &rootTitle, const QStringList &relativeDirs);
+    int addTag(const TagData &tag);
+    int nextAvailableNodeId();
+    NodeData getChildNotesCountFolder(int folderId);
+
+    QFuture<NodeData> requestNode(int nodeId);
+    QFuture<QString> requestNoteContent(int noteId);
+    QFuture<QHash<int, QString>> requestNoteContents(const QVector<int> &noteIds);
+    QFuture<FolderListType> requestFolderList();
+    QFuture<int> requestAddNode(const NodeData &node);
+    QFuture<QVector<int>> requestAddNodesBulk(const QVector<NodeData> &nodes);
+    QFuture<QHash<QString, int>> requestAddFolderTree(const QString &rootTitle,
+                                                      const QStringList &relativeDirs);
+    QFuture<int> requestAddTag(const TagData &tag);
+    QFuture<int> requestNextAvailableNodeId();
+    QFuture<NodeData> requestChildNotesCountFolder(int folderId);
+    QFuture<NoteExportSnapshot> requestExportSnapshot();
+    QFuture<bool> requestImportNotes(const QString &fileName);
+    QFuture<bool> requestRestoreNotes(const QString &fileName);
+    QFuture<bool> requestChangeDatabasePath(const QString &newPath);
+
+    void setStorageSettings(const StorageSettings &settings);
+    StatementCacheStats statementCacheStats() const;
+    QStringList cachedStatements() const;
+
+    static QString notePreview(const NodeData &note);
+    static NoteListStatements noteListStatements(const QString &condition);
+    static QString folderListCondition(int parentId, bool isRecursive, const QString &parentPath,
+                                       QMap<QString, QVariant> &bindValues);
+    static QString tagListCondition(const QSet<int> &tagIds, QMap<QString, QVariant> &bindValues);
+
+    quint64 beginListRequest();
+    bool isListRequestStale(quint64 requestId) const;
 
 private:
-    void open(const QString &path, bool doCreate = false);
+    template<typename T, typename Function>
+    QFuture<T> runRequest(Function function);
+    void assertOnDatabaseThread(const char *function) const;
+    QSqlQuery &cachedQuery(const QString &statement);
+    void clearStatementCache();
+    template<typename Function>
+    void runOnReader(Function function);
+    void startReaders();
+    void stopReaders();
+    static QSqlDatabase readerDatabase(const QString &path, const StorageSettings &settings);
+    bool open(const QString &path, bool doCreate = false);
+    void close();
+    static bool moveDatabaseFiles(const QString &from, const QString &to);
+    static void removeDatabaseFiles(const QString &path);
     void createTables();
+    void migrateTables();
+    QMap<QString, bool> tableColumns(const QString &tableName);
+    void createIndexes();
+    static QString pathPrefixEnd(const QString &prefix);
+    void backfillNotePreviews();
+    void createFullTextIndex();
+    bool canUseFullTextIndex(const QString &keyword) const;
+    static QString fullTextMatchExpression(const QString &keyword);
+    static bool vacuumInto(QSqlDatabase &db, const QString &fileName);
+    bool isWriteAheadLogEnabled();
+    void applyStorageSettings();
+    void onCheckpointTimeout();
+    void startBackup(const QString &fileName, bool isAutomatic);
+    void finishBackup(const QString &fileName, bool isSuccess, bool isAutomatic);
+    void onAutoBackupTimeout();
+    void pruneAutoBackups();
+    QString autoBackupDirectory() const;
 
     bool isNodeExist(const NodeData &node);
     QString m_dbpath;
     QSqlDatabase m_db;
+    bool m_hasFullTextIndex;
+    std::atomic<quint64> m_latestListRequestId;
+    QHash<int, int> m_folderChildNotesCounts;
+    QHash<int, int> m_tagChildNotesCounts;
+    StorageSettings m_storageSettings;
+    QHash<QString, QSqlQuery *> m_statementCache;
+    StatementCacheStats m_statementCacheStats;
+    QThreadPool *m_readerPool;
+    int m_nextNodeId;
+    int m_nextTagId;
+    QTimer *m_checkpointTimer;
+    qint64 m_lastTotalChanges;
+    qint64 m_checkpointedTotalChanges;
+    bool m_isBackupRunning;
+    QFuture<bool> m_backupTask;
+    QTimer *m_backupProgressTimer;
+    QTimer *m_autoBackupTimer;
+    int m_autoBackupKeepCount;
 
-    QVector<NodeData> getAllFolders();
-    QVector<TagData> getAllTagInfo();
+    static QVector<NodeData> getAllFolders(QSqlDatabase &db);
+    static QVector<TagData> getAllTagInfo(QSqlDatabase &db);
     QSet<int> getAllTagForNote(int noteId);
+    QVector<NodeData> getNoteList(QSqlDatabase &db, const QString &condition,
+                                  const QMap<QString, QVariant> &bindValues,
+                                  quint64 requestId = 0);
+    static QString tagFilterClause(const QSet<int> &tagIds, QMap<QString, QVariant> &bindValues);
     bool updateNoteContent(const NodeData &note);
     QList<NodeData> readOldNBK(const QString &fileName);
+    bool importDatabase(const QString &fileName);
     int nextAvailablePosition(int parentId, NodeData::Type nodeType);
     int addNodePreComputed(const NodeData &node);
-    void recalculateChildNotesCount();
-    void recalculateChildNotesCountFolder(int folderId);
-    void recalculateChildNotesCountTag(int tagId);
-    void recalculateChildNotesCountAllNotes();
-    void increaseChildNotesCountTag(int tagId);
-    void decreaseChildNotesCountTag(int tagId);
-    void increaseChildNotesCountFolder(int folderId);
-    void decreaseChildNotesCountFolder(int folderId);
+    void loadIdCounters();
+    int reserveNodeIds(int count);
+    int reserveTagIds(int count);
+    void createChildNotesCountTriggers();
+    void verifyChildNotesCounts();
+    void notifyChildNotesCountFolder(int folderId);
+    void notifyChildNotesCountTag(int tagId);
+    static QVector<int> sparsePositions(const QVector<int> &positions);
+    void updateRelativePositions(const QString &table, const QString &column,
+                                 const QVector<int> &ids);
 
 signals:
     void databaseOpened();
@@ -81,29 +231,31 @@ signals:
     void showErrorMessage(const QString &title, const QString &content);
     void childNotesCountUpdatedTag(int tagId, int childCount);
     void childNotesCountUpdatedFolder(int folderId, const QString &path, int childCount);
+    void backupStarted(const QString &fileName, bool isBlockingWrites);
+    void backupProgress(qint64 bytesWritten, qint64 totalBytes);
+    void backupFinished(const QString &fileName, bool isSuccess);
 
 public slots:
     void onNodeTagTreeRequested();
     void onNotesListInFolderRequested(int parentID, bool isRecursive, bool newNote = false,
-                                      int scrollToId = SpecialNodeID::InvalidNodeId);
+                                      int scrollToId = SpecialNodeID::InvalidNodeId,
+                                      quint64 requestId = 0);
     void onNotesListInTagsRequested(const QSet<int> &tagIds, bool newNote = false,
-                                    int scrollToId = SpecialNodeID::InvalidNodeId);
+                                    int scrollToId = SpecialNodeID::InvalidNodeId,
+                                    quint64 requestId = 0);
     void onOpenDBManagerRequested(const QString &path, bool doCreate);
     void onCreateUpdateRequestedNoteContent(const NodeData &note);
-    void onImportNotesRequested(const QString &fileName);
-    void onRestoreNotesRequested(const QString &fileName);
+    bool onImportNotesRequested(const QString &fileName);
+    bool onRestoreNotesRequested(const QString &fileName);
     void onExportNotesRequested(const QString &fileName);
     void onMigrateNotesFromV0_9_0Requested(QVector<NodeData> &noteList);
     void onMigrateTrashFrom0_9_0Requested(QVector<NodeData> &noteList);
     void onMigrateNotesFrom1_5_0Requested(const QString &fileName);
-    void onChangeDatabasePathRequested(const QString &newPath);
-
-    int addNode(const NodeData &node);
+    bool onChangeDatabasePathRequested(const QString &newPath);
+    void setAutoBackup(int intervalMinutes, int keepCount);
 
-    int addTag(const TagData &tag);
     void addNoteToTag(int noteId, int tagId);
     void removeNoteFromTag(int noteId, int tagId);
-    int nextAvailableNodeId();
     int nextAvailableTagId();
     void renameNode(int id, const QString &newName);
     void renameTag(int id, const QString &newName);
@@ -113,12 +265,53 @@ public slots:
     void moveNode(int nodeId, const NodeData &target);
     void searchForNotes(const QString &keyword, const ListViewInfo &inf);
     void clearSearch(const ListViewInfo &inf);
-    void updateRelPosNode(int nodeId, int relPos);
-    void updateRelPosTag(int tagId, int relPos);
-    void updateRelPosPinnedNote(int nodeId, int relPos);
-    void updateRelPosPinnedNoteAN(int nodeId, int relPos);
+    void updateRelPosNodes(const QVector<int> &nodeIds);
+    void updateRelPosTags(const QVector<int> &tagIds);
+    void updateRelPosPinnedNotes(const QVector<int> &noteIds);
+    void updateRelPosPinnedNotesAN(const QVector<int> &noteIds);
     void setNoteIsPinned(int noteId, bool isPinned);
-    NodeData getChildNotesCountFolder(int folderId);
 };
 
+/*!
+ * \brief DBManager::runRequest
+ * Queue \a function on the database thread and return a future for its result,
+ * so callers on the GUI thread can attach a continuation instead of blocking.
+ */
+template<typename T, typename Function>
+QFuture<T> DBManager::runRequest(Function function)
+{
+    auto promise = std::make_shared<QPromise<T>>();
+    QFuture<T> future = promise->future();
+    promise->start();
+    QMetaObject::invokeMethod(
+            this,
+            [promise, function]() {
+                promise->addResult(function());
+                promise->finish();
+            },
+            Qt::QueuedConnection);
+    return future;
+}
+
+/*!
+ * \brief DBManager::runOnReader
+ * Run the read-only \a function on a pooled reader connection so it doesn't hold up note
+ * saves, or right here on the writer connection when readers are unavailable.
+ * \a function may emit signals but must not touch the writer connection or cached queries.
+ */
+template<typename Function>
+void DBManager::runOnReader(Function function)
+{
+    if (!m_readerPool) {
+        function(m_db);
+        return;
+    }
+    QString path = m_dbpath;
+    StorageSettings settings = m_storageSettings;
+    m_readerPool->start([path, settings, function]() {
+        QSqlDatabase db = readerDatabase(path, settings);
+        function(db);
+    });
+}
+
 #endif // DBMANAGER_H
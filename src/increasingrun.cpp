@@ -0,0 +1,33 @@
+#include "increasingrun.h"
+#include <algorithm>
+
+/*!
+ * \brief IncreasingRun::longest
+ * Marks one longest strictly increasing subsequence of \a values, O(n log n). What is in
+ * it can stay where it is when a list is reordered, only the rest has to move.
+ * \param values
+ * \return true for every value in the run, in the order of \a values
+ */
+QVector<bool> IncreasingRun::longest(const QVector<int> &values)
+{
+    QVector<int> tails; // index of the smallest tail of each run length
+    QVector<int> previous(values.size(), -1);
+    for (int i = 0; i < values.size(); ++i) {
+        auto it = std::lower_bound(tails.begin(), tails.end(), values[i],
+                                   [&values](int index, int value) { return values[index] < value; });
+        int length = int(it - tails.begin());
+        if (length > 0) {
+            previous[i] = tails[length - 1];
+        }
+        if (it == tails.end()) {
+            tails.append(i);
+        } else {
+            *it = i;
+        }
+    }
+    QVector<bool> result(values.size(), false);
+    for (int i = tails.isEmpty() ? -1 : tails.last(); i != -1; i = previous[i]) {
+        result[i] = true;
+    }
+    return result;
+}
@@ -0,0 +1,12 @@
+#ifndef INCREASINGRUN_H
+#define INCREASINGRUN_H
+
+#include <QVector>
+
+class IncreasingRun
+{
+public:
+    static QVector<bool> longest(const QVector<int> &values);
+};
+
+#endif // INCREASINGRUN_H
@@ -65,9 +65,9 @@ ListViewLogic::ListViewLogic(NoteListView *noteView, NoteListModel *noteModel,
     connect(this, &ListViewLogic::requestClearSearchDb, dbManager, &DBManager::clearSearch,
             Qt::QueuedConnection);
     connect(m_listModel, &NoteListModel::requestUpdatePinnedRelPos, dbManager,
-            &DBManager::updateRelPosPinnedNote, Qt::QueuedConnection);
+            &DBManager::updateRelPosPinnedNotes, Qt::QueuedConnection);
     connect(m_listModel, &NoteListModel::requestUpdatePinnedRelPosAN, dbManager,
-            &DBManager::updateRelPosPinnedNoteAN, Qt::QueuedConnection);
+            &DBManager::updateRelPosPinnedNotesAN, Qt::QueuedConnection);
     connect(m_listModel, &NoteListModel::requestUpdatePinned, dbManager,
             &DBManager::setNoteIsPinned, Qt::QueuedConnection);
 
@@ -170,7 +170,11 @@ void ListViewLogic::setNoteData(const NodeData &note)
     if (noteIndex.isValid()) {
         QMap<int, QVariant> dataValue;
         auto wasTemp = noteIndex.data(NoteListModel::NoteIsTemp).toBool();
-        dataValue[NoteListModel::NoteContent] = QVariant::fromValue(note.content());
+        if (note.isContentLoaded()) {
+            // an unloaded body is empty, it must not replace the one the model may have
+            dataValue[NoteListModel::NoteContent] = QVariant::fromValue(note.content());
+        }
+        dataValue[NoteListModel::NotePreview] = QVariant::fromValue(note.preview());
         dataValue[NoteListModel::NoteFullTitle] = QVariant::fromValue(note.fullTitle());
         dataValue[NoteListModel::NoteLastModificationDateTime] =
                 QVariant::fromValue(note.lastModificationdateTime());
@@ -283,6 +287,7 @@ void ListViewLogic::onSearchEditTextChanged(const QString &keyword)
             }
         }
         m_clearButton->show();
+        m_listViewInfo.requestId = m_dbManager->beginListRequest();
         emit requestSearchInDb(keyword, m_listViewInfo);
     }
 }
@@ -291,12 +296,17 @@ void ListViewLogic::clearSearch(bool createNewNote, int scrollToId)
 {
     m_listViewInfo.needCreateNewNote = createNewNote;
     m_listViewInfo.scrollToId = scrollToId;
+    m_listViewInfo.requestId = m_dbManager->beginListRequest();
     emit requestClearSearchDb(m_listViewInfo);
     emit requestClearSearchUI();
 }
 
 void ListViewLogic::loadNoteListModel(const QVector<NodeData> &noteList, const ListViewInfo &inf)
 {
+    // the user moved on while this list was being built
+    if (m_dbManager->isListRequestStale(inf.requestId)) {
+        return;
+    }
     auto currentNotesId = m_listViewInfo.currentNotesId;
     m_listViewInfo = inf;
     if ((!m_listViewInfo.isInTag) && m_listViewInfo.parentFolderId == SpecialNodeID::RootFolder) {
@@ -401,16 +411,23 @@ void ListViewLogic::onNoteMovedOut(int nodeId, int targetId)
                 emit closeNoteEditor();
             }
         } else {
-            NodeData note;
-            QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection,
-                                      Q_RETURN_ARG(NodeData, note), Q_ARG(int, nodeId));
-            if (note.id() != SpecialNodeID::InvalidNodeId) {
+            // the note is still listed, only its parent changed, so ask for the target
+            // folder rather than re-reading the note after the move lands
+            m_dbManager->requestNode(targetId).then(this, [this, nodeId](const NodeData &target) {
+                auto index = m_listModel->getNoteIndex(nodeId);
+                if (!index.isValid() || target.nodeType() != NodeData::Folder) {
+                    qDebug() << __FUNCTION__ << "Note id" << nodeId << "not found!";
+                    return;
+                }
+                NodeData note = m_listModel->getNote(index);
+                note.setParentId(target.id());
+                note.setParentName(target.fullTitle());
+                note.setAbsolutePath(target.absolutePath() + PATH_SEPARATOR
+                                     + QString::number(nodeId));
                 m_listView->closePersistentEditorC(index);
                 m_listModel->setNoteData(index, note);
                 m_listView->openPersistentEditorC(index);
-            } else {
-                qDebug() << __FUNCTION__ << "Note id" << nodeId << "not found!";
-            }
+            });
         }
     }
 }
@@ -443,9 +460,11 @@ void ListViewLogic::onNotesListInFolderRequested(int parentID, bool isRecursive,
         m_listViewInfo.currentTagList = {};
         m_listViewInfo.scrollToId = SpecialNodeID::InvalidNodeId;
         m_clearButton->show();
+        m_listViewInfo.requestId = m_dbManager->beginListRequest();
         emit requestSearchInDb(m_searchEdit->text(), m_listViewInfo);
     } else {
-        emit requestNotesListInFolder(parentID, isRecursive, newNote, scrollToId);
+        emit requestNotesListInFolder(parentID, isRecursive, newNote, scrollToId,
+                                      m_dbManager->beginListRequest());
     }
 }
 
@@ -459,9 +478,10 @@ void ListViewLogic::onNotesListInTagsRequested(const QSet<int> &tagIds, bool new
         m_listViewInfo.needCreateNewNote = false;
         m_listViewInfo.currentTagList = tagIds;
         m_listViewInfo.scrollToId = SpecialNodeID::InvalidNodeId;
+        m_listViewInfo.requestId = m_dbManager->beginListRequest();
         emit requestSearchInDb(m_searchEdit->text(), m_listViewInfo);
     } else {
-        emit requestNotesListInTags(tagIds, newNote, scrollToId);
+        emit requestNotesListInTags(tagIds, newNote, scrollToId, m_dbManager->beginListRequest());
     }
 }
 
@@ -535,10 +555,7 @@ void ListViewLogic::deleteNoteRequestedI(const QModelIndexList &indexes)
         QModelIndexList needDeleteI;
         for (const auto &index : qAsConst(indexes)) {
             if (index.isValid()) {
-                auto id = index.data(NoteListModel::NoteID).toInt();
-                NodeData note;
-                QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection,
-                                          Q_RETURN_ARG(NodeData, note), Q_ARG(int, id));
+                const auto &note = m_listModel->getNote(index);
                 if (note.parentId() == SpecialNodeID::TrashFolder) {
                     isInTrash = true;
                 }
@@ -588,15 +605,12 @@ void ListViewLogic::restoreNotesRequestedI(const QModelIndexList &indexes)
     QSet<int> needRestored;
     for (const auto &index : qAsConst(indexes)) {
         if (index.isValid()) {
-            auto id = index.data(NoteListModel::NoteID).toInt();
-            NodeData note;
-            QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection,
-                                      Q_RETURN_ARG(NodeData, note), Q_ARG(int, id));
+            const auto &note = m_listModel->getNote(index);
             if (note.parentId() == SpecialNodeID::TrashFolder) {
                 needRestoredI.append(index);
                 needRestored.insert(note.id());
             } else {
-                qDebug() << "Note id" << id << "is currently not in Trash";
+                qDebug() << "Note id" << note.id() << "is currently not in Trash";
             }
         }
     }
@@ -608,13 +622,12 @@ void ListViewLogic::restoreNotesRequestedI(const QModelIndexList &indexes)
     if (needClose) {
         emit closeNoteEditor();
     }
-    NodeData defaultNotesFolder;
-    QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection,
-                              Q_RETURN_ARG(NodeData, defaultNotesFolder),
-                              Q_ARG(int, SpecialNodeID::DefaultNotesFolder));
-    for (const auto &id : qAsConst(needRestored)) {
-        emit requestMoveNoteDb(id, defaultNotesFolder);
-    }
+    m_dbManager->requestNode(SpecialNodeID::DefaultNotesFolder)
+            .then(this, [this, needRestored](const NodeData &defaultNotesFolder) {
+                for (const auto &id : needRestored) {
+                    emit requestMoveNoteDb(id, defaultNotesFolder);
+                }
+            });
 }
 
 void ListViewLogic::updateListViewLabel()
@@ -626,11 +639,16 @@ void ListViewLogic::updateListViewLabel()
                && m_listViewInfo.parentFolderId == SpecialNodeID::TrashFolder) {
         l1 = "Trash";
     } else if (!m_listViewInfo.isInTag) {
-        NodeData parentFolder;
-        QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(NodeData, parentFolder),
-                                  Q_ARG(int, m_listViewInfo.parentFolderId));
-        l1 = parentFolder.fullTitle();
+        int folderId = m_listViewInfo.parentFolderId;
+        m_dbManager->requestNode(folderId).then(this, [this, folderId](const NodeData &parentFolder) {
+            // the user may have switched folders while the title was loading
+            if (m_listViewInfo.isInTag || m_listViewInfo.parentFolderId != folderId) {
+                return;
+            }
+            emit listViewLabelChanged(parentFolder.fullTitle(),
+                                      QString::number(m_listModel->rowCount()));
+        });
+        return;
     } else {
         if (m_listViewInfo.currentTagList.size() == 0) {
             l1 = "Tags ...";
@@ -653,18 +671,7 @@ void ListViewLogic::updateListViewLabel()
 void ListViewLogic::onRowCountChanged()
 {
     m_listView->closeAllEditor();
-    m_listDelegate->clearSizeMap();
-    for (int i = 0; i < m_listModel->rowCount(); ++i) {
-        auto index = m_listModel->index(i, 0);
-        auto y = m_listView->visualRect(index).y();
-        auto range = abs(m_listView->viewport()->height());
-        if (y < -range) {
-            continue;
-        } else if (y > 2 * range) {
-            break;
-        }
-        m_listView->openPersistentEditorC(index);
-    }
+    m_listView->updateEditors();
 }
 
 void ListViewLogic::onNoteDoubleClicked(const QModelIndex &index)
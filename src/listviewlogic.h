@@ -65,8 +65,10 @@ signals:
     void moveNoteRequested(int id, int target);
     void listViewLabelChanged(const QString &label1, const QString &label2);
     void setNewNoteButtonVisible(bool visible);
-    void requestNotesListInFolder(int parentID, bool isRecursive, bool newNote, int scrollToId);
-    void requestNotesListInTags(const QSet<int> &tagIds, bool newNote, int scrollToId);
+    void requestNotesListInFolder(int parentID, bool isRecursive, bool newNote, int scrollToId,
+                                  quint64 requestId);
+    void requestNotesListInTags(const QSet<int> &tagIds, bool newNote, int scrollToId,
+                                quint64 requestId);
 
 private slots:
     void loadNoteListModel(const QVector<NodeData> &noteList, const ListViewInfo &inf);
@@ -11,6 +11,8 @@
 #include "listviewlogic.h"
 #include "noteeditorlogic.h"
 #include "tagpool.h"
+#include "plaintextimporter.h"
+#include "plaintextexporter.h"
 #include "splitterstyle.h"
 #include "editorsettingsoptions.h"
 
@@ -24,6 +26,7 @@
 #include <QMessageBox>
 #include <QList>
 #include <QWidgetAction>
+#include <QActionGroup>
 #include <QTimer>
 #include <QSqlDatabase>
 #include <QSqlQuery>
@@ -61,6 +64,8 @@ MainWindow::MainWindow(QWidget *parent)
       m_editorSettingsQuickView(nullptr),
       m_editorSettingsWidget(new QWidget(this)),
       m_tagPool(nullptr),
+      m_plainTextImporter(nullptr),
+      m_plainTextExporter(nullptr),
       m_dbManager(nullptr),
       m_dbThread(nullptr),
       m_aboutWindow(this),
@@ -127,7 +132,8 @@ MainWindow::MainWindow(QWidget *parent)
       m_mainMenu(nullptr),
       m_buyOrManageSubscriptionAction(new QAction(this)),
       m_isLicensedCheckedAfterStartup(false),
-      m_databaseFolderPath("")
+      m_databaseFolderPath(""),
+      m_isCreatingNewNote(false)
 {
     ui->setupUi(this);
     setupBlockEditorView();
@@ -185,11 +191,7 @@ void MainWindow::InitData()
             setButtonsAndFieldsEnabled(true);
         });
 
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
         QFuture<void> migration = QtConcurrent::run(&MainWindow::migrateFromV0_9_0, this);
-#else
-        QFuture<void> migration = QtConcurrent::run(this, &MainWindow::migrateFromV0_9_0);
-#endif
         watcher->setFuture(migration);
     }
     /// Check if it is running with an argument (ex. hide)
@@ -298,6 +300,9 @@ void MainWindow::resizeEvent(QResizeEvent *event)
 MainWindow::~MainWindow()
 {
     delete ui;
+    // the importer and exporter wait on database requests, finish them while the thread still runs
+    delete m_plainTextImporter;
+    delete m_plainTextExporter;
     m_dbThread->quit();
     m_dbThread->wait();
     delete m_dbThread;
@@ -611,13 +616,11 @@ void MainWindow::setupSignalsSlots()
 
     // MainWindow <-> DBManager
     connect(this, &MainWindow::requestNodesTree, m_dbManager, &DBManager::onNodeTagTreeRequested,
-            Qt::BlockingQueuedConnection);
-    connect(this, &MainWindow::requestRestoreNotes, m_dbManager,
-            &DBManager::onRestoreNotesRequested, Qt::BlockingQueuedConnection);
-    connect(this, &MainWindow::requestImportNotes, m_dbManager, &DBManager::onImportNotesRequested,
-            Qt::BlockingQueuedConnection);
+            Qt::QueuedConnection);
     connect(this, &MainWindow::requestExportNotes, m_dbManager, &DBManager::onExportNotesRequested,
-            Qt::BlockingQueuedConnection);
+            Qt::QueuedConnection);
+    // emitted by migrateFromV0_9_0 on a QtConcurrent thread, never on the GUI thread. It has
+    // to wait until the notes are stored before the old .ini files are renamed away
     connect(this, &MainWindow::requestMigrateNotesFromV0_9_0, m_dbManager,
             &DBManager::onMigrateNotesFromV0_9_0Requested, Qt::BlockingQueuedConnection);
     connect(this, &MainWindow::requestMigrateTrashFromV0_9_0, m_dbManager,
@@ -690,8 +693,6 @@ void MainWindow::setupSignalsSlots()
             &ListViewLogic::onNotesListInFolderRequested);
     connect(m_treeView, &NodeTreeView::loadNotesInTagsRequested, m_listViewLogic,
             &ListViewLogic::onNotesListInTagsRequested);
-    connect(this, &MainWindow::requestChangeDatabasePath, m_dbManager,
-            &DBManager::onChangeDatabasePathRequested, Qt::QueuedConnection);
 
 #if defined(Q_OS_MACOS)
     connect(this, &MainWindowBase::toggleFullScreen, this, [this](bool isFullScreen) {
@@ -805,10 +806,8 @@ void MainWindow::setupEditorSettings()
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
     QUrl source("qrc:/qt/qml/EditorSettings.qml");
-#elif QT_VERSION > QT_VERSION_CHECK(5, 12, 8)
-    QUrl source("qrc:/qml/EditorSettings.qml");
 #else
-    QUrl source("qrc:/qml/EditorSettingsQt512.qml");
+    QUrl source("qrc:/qml/EditorSettings.qml");
 #endif
 
     m_editorSettingsQuickView.rootContext()->setContextProperty("mainWindow", this);
@@ -1429,6 +1428,16 @@ void MainWindow::setupDatabases()
     connect(m_dbThread, &QThread::started, this, [=]() {
         setTheme(m_currentTheme);
         emit requestOpenDBManager(noteDBFilePath, doCreate);
+        int autoBackupInterval =
+                m_settingsDatabase->value(QStringLiteral("autoBackupIntervalMinutes"), 0).toInt();
+        int autoBackupKeepCount =
+                m_settingsDatabase->value(QStringLiteral("autoBackupKeepCount"), 10).toInt();
+        QMetaObject::invokeMethod(
+                m_dbManager,
+                [this, autoBackupInterval, autoBackupKeepCount]() {
+                    m_dbManager->setAutoBackup(autoBackupInterval, autoBackupKeepCount);
+                },
+                Qt::QueuedConnection);
         if (needMigrateFromV1_5_0) {
             emit requestMigrateNotesFromV1_5_0(dir.path() + QDir::separator()
                                                + QStringLiteral("oldNotes.db"));
@@ -1453,11 +1462,13 @@ void MainWindow::setupDatabases()
                     m_settingsDatabase->setValue(QStringLiteral("example_notes_added_at_version"),
                                                  qApp->applicationVersion());
                     m_settingsDatabase->sync();
-                    m_dbManager->addExampleNotes();
+                    QMetaObject::invokeMethod(m_dbManager, &DBManager::addExampleNotes,
+                                              Qt::QueuedConnection);
                 }
             },
             Qt::QueuedConnection);
 
+    m_dbManager->setStorageSettings(StorageSettings::fromSettings(m_settingsDatabase));
     m_dbThread->start();
 }
 
@@ -1468,6 +1479,8 @@ void MainWindow::setupModelView()
 {
     m_listView = ui->listView;
     m_tagPool = new TagPool(m_dbManager);
+    m_plainTextImporter = new PlainTextImporter(m_dbManager, this);
+    m_plainTextExporter = new PlainTextExporter(m_dbManager, this);
     m_listModel = new NoteListModel(m_listView);
     m_listView->setTagPool(m_tagPool);
     m_listView->setModel(m_listModel);
@@ -1826,10 +1839,16 @@ void MainWindow::setupGlobalSettingsMenu()
         if (btn == QMessageBox::Yes) {
             auto newDbPath = QFileDialog::getSaveFileName(this, "New Database path", "notes.db");
             if (!newDbPath.isEmpty()) {
-                m_settingsDatabase->setValue(QStringLiteral("noteDBFilePath"), newDbPath);
                 QFileInfo noteDBFilePathInf(newDbPath);
                 QDir().mkpath(noteDBFilePathInf.absolutePath());
-                emit requestChangeDatabasePath(newDbPath);
+                // the setting only follows once the database has actually moved
+                m_dbManager->requestChangeDatabasePath(newDbPath).then(
+                        this, [this, newDbPath](bool isMoved) {
+                            if (isMoved) {
+                                m_settingsDatabase->setValue(QStringLiteral("noteDBFilePath"),
+                                                             newDbPath);
+                            }
+                        });
             }
         }
     });
@@ -1860,6 +1879,10 @@ void MainWindow::setupGlobalSettingsMenu()
     importNotesPlainTextAction->setToolTip(tr("Import notes from .txt or .md files"));
     connect(importNotesPlainTextAction, &QAction::triggered, this, &MainWindow::importPlainTextFiles);
 
+    QAction *importFolderPlainTextAction = importExportNotesMenu->addAction(tr("Import &Folder"));
+    importFolderPlainTextAction->setToolTip(tr("Import a folder of .txt or .md files, including its sub folders"));
+    connect(importFolderPlainTextAction, &QAction::triggered, this, &MainWindow::importPlainTextFolder);
+
     QAction *exportNotesToPlainTextAction = importExportNotesMenu->addAction(tr("&Export to .txt"));
     exportNotesToPlainTextAction->setToolTip(tr("Export notes to .txt files\nNote: If you wish to backup your notes,\nuse the .nbk file format instead of .txt/.md"));
     connect(exportNotesToPlainTextAction, &QAction::triggered, this, [this](){
@@ -1872,6 +1895,12 @@ void MainWindow::setupGlobalSettingsMenu()
         exportToPlainTextFiles(".md");
     });
 
+    QAction *syncNotesToMarkdownAction = importExportNotesMenu->addAction(tr("&Sync to .md folder"));
+    syncNotesToMarkdownAction->setToolTip(tr("Keep a folder of .md files up to date\nOnly notes changed since the last sync are rewritten"));
+    connect(syncNotesToMarkdownAction, &QAction::triggered, this, [this](){
+        exportToPlainTextFiles(".md", true);
+    });
+
     importExportNotesMenu->addSeparator();
 
            // Export notes action
@@ -1888,6 +1917,41 @@ void MainWindow::setupGlobalSettingsMenu()
     QAction *restoreNotesFileAction = importExportNotesMenu->addAction(tr("&Restore from .nbk"));
     restoreNotesFileAction->setToolTip(tr("Replace all notes with notes from a .nbk file"));
     connect(restoreNotesFileAction, &QAction::triggered, this, &MainWindow::restoreNotesFile);
+
+           // Automatic backups, the interval is read back from the settings on every start
+    QMenu *autoBackupMenu = importExportNotesMenu->addMenu(tr("&Automatic Backups"));
+    autoBackupMenu->setFont(importExportNotesMenu->font());
+    QActionGroup *autoBackupGroup = new QActionGroup(autoBackupMenu);
+    const QList<QPair<QString, int>> autoBackupIntervals = { { tr("&Off"), 0 },
+                                                             { tr("Every &Hour"), 60 },
+                                                             { tr("Every &Day"), 24 * 60 } };
+    for (const auto &interval : autoBackupIntervals) {
+        QAction *autoBackupAction = autoBackupMenu->addAction(interval.first);
+        autoBackupAction->setCheckable(true);
+        autoBackupAction->setData(interval.second);
+        autoBackupGroup->addAction(autoBackupAction);
+        connect(autoBackupAction, &QAction::triggered, this, [this, interval]() {
+            m_settingsDatabase->setValue(QStringLiteral("autoBackupIntervalMinutes"),
+                                         interval.second);
+            int keepCount =
+                    m_settingsDatabase->value(QStringLiteral("autoBackupKeepCount"), 10).toInt();
+            QMetaObject::invokeMethod(
+                    m_dbManager,
+                    [this, interval, keepCount]() {
+                        m_dbManager->setAutoBackup(interval.second, keepCount);
+                    },
+                    Qt::QueuedConnection);
+        });
+    }
+    // the settings are only opened after the menu is built
+    connect(autoBackupMenu, &QMenu::aboutToShow, this, [this, autoBackupGroup]() {
+        int currentInterval =
+                m_settingsDatabase->value(QStringLiteral("autoBackupIntervalMinutes"), 0).toInt();
+        const auto actions = autoBackupGroup->actions();
+        for (auto *action : actions) {
+            action->setChecked(action->data().toInt() == currentInterval);
+        }
+    });
 }
 
 /*!
@@ -2064,8 +2128,17 @@ void MainWindow::onClearButtonClicked()
 void MainWindow::createNewNote(bool isCalledFromShortcut)
 {
     m_listView->scrollToTop();
-    QModelIndex newNoteIndex;
+    auto selectNewNote = [this](const QModelIndex &newNoteIndex) {
+        // update the current selected index
+        m_listView->setCurrentIndexC(newNoteIndex);
+        m_blockEditorWidget->setFocus();
+        emit focusOnEditor();
+    };
     if (!m_noteEditorLogic->isTempNote()) {
+        // a previous request is still waiting for its id
+        if (m_isCreatingNewNote) {
+            return;
+        }
         // clear the textEdit
         m_blockModel->blockSignals(true);
         m_noteEditorLogic->closeEditor();
@@ -2077,44 +2150,44 @@ void MainWindow::createNewNote(bool isCalledFromShortcut)
         tmpNote.setCreationDateTime(noteDate);
         tmpNote.setLastModificationDateTime(noteDate);
         tmpNote.setFullTitle(QStringLiteral("New Note"));
-        auto inf = m_listViewLogic->listViewInfo();
-        if ((!inf.isInTag) && (inf.parentFolderId > SpecialNodeID::RootFolder)) {
-            NodeData parent;
-            QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection,
-                                      Q_RETURN_ARG(NodeData, parent),
-                                      Q_ARG(int, inf.parentFolderId));
-            if (parent.nodeType() == NodeData::Folder) {
-                tmpNote.setParentId(parent.id());
-                tmpNote.setParentName(parent.fullTitle());
-            } else {
-                tmpNote.setParentId(SpecialNodeID::DefaultNotesFolder);
-                tmpNote.setParentName("Notes");
-            }
-        } else {
-            tmpNote.setParentId(SpecialNodeID::DefaultNotesFolder);
-            tmpNote.setParentName("Notes");
-        }
-        int noteId = SpecialNodeID::InvalidNodeId;
-        QMetaObject::invokeMethod(m_dbManager, "nextAvailableNodeId", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(int, noteId));
-        tmpNote.setId(noteId);
+        tmpNote.setPreview(QStringLiteral(""));
+        tmpNote.setParentId(SpecialNodeID::DefaultNotesFolder);
+        tmpNote.setParentName("Notes");
         tmpNote.setIsTempNote(true);
+        auto inf = m_listViewLogic->listViewInfo();
         if (inf.isInTag) {
             tmpNote.setTagIds(inf.currentTagList);
         }
-        // insert the new note to NoteListModel
-        newNoteIndex = m_listModel->insertNote(tmpNote, 0);
+        bool needParent = (!inf.isInTag) && (inf.parentFolderId > SpecialNodeID::RootFolder);
+        QFuture<NodeData> parentFuture;
+        if (needParent) {
+            parentFuture = m_dbManager->requestNode(inf.parentFolderId);
+        }
+        m_isCreatingNewNote = true;
+        m_dbManager->requestNextAvailableNodeId().then(this, [=](int noteId) {
+            m_isCreatingNewNote = false;
+            NodeData note = tmpNote;
+            // requests run in order on the database thread, so the parent is already resolved
+            if (needParent) {
+                auto parent = parentFuture.result();
+                if (parent.nodeType() == NodeData::Folder) {
+                    note.setParentId(parent.id());
+                    note.setParentName(parent.fullTitle());
+                }
+            }
+            note.setId(noteId);
+            // insert the new note to NoteListModel
+            auto newNoteIndex = m_listModel->insertNote(note, 0);
 
-        // update the editor
-        m_noteEditorLogic->showNotesInEditor({ tmpNote }, isCalledFromShortcut);
+            // update the editor
+            m_noteEditorLogic->showNotesInEditor({ note }, isCalledFromShortcut);
+            selectNewNote(newNoteIndex);
+        });
     } else {
-        newNoteIndex = m_listModel->getNoteIndex(m_noteEditorLogic->currentEditingNoteId());
+        auto newNoteIndex = m_listModel->getNoteIndex(m_noteEditorLogic->currentEditingNoteId());
         m_listView->animateAddedRow({ newNoteIndex });
+        selectNewNote(newNoteIndex);
     }
-    // update the current selected index
-    m_listView->setCurrentIndexC(newNoteIndex);
-    m_blockEditorWidget->setFocus();
-    emit focusOnEditor();
 }
 
 void MainWindow::selectNoteDown()
@@ -2285,7 +2358,6 @@ void MainWindow::checkForUpdates()
 
 void MainWindow::importPlainTextFiles()
 {
-    QList<QPair<QString, QDateTime>> fileDatas;
     QFileDialog dialog(this);
 
     // Set filters and options
@@ -2293,61 +2365,108 @@ void MainWindow::importPlainTextFiles()
     dialog.setFileMode(QFileDialog::ExistingFiles);
 
     // Open the dialog and check if user has selected files
-    if (dialog.exec()) {
-        // Get list of selected files
-        QStringList files = dialog.selectedFiles();
-
-        // Loop over the files and read their content
-        for (const QString &fileName : files) {
-            QFile file(fileName);
-
-            // Open the file and check for errors
-            if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                QMessageBox::warning(this, "File error", "Can't open file " + fileName);
-                continue;
-            }
-
-            // Read the file content
-            QTextStream in(&file);
-            QString fileContent = in.readAll();
-
-            QFileInfo fileInfo(file);
-            QDateTime lastModified = fileInfo.lastModified();
+    if (!dialog.exec() || dialog.selectedFiles().isEmpty()) {
+        QMessageBox msgBox;
+        msgBox.setText("No files selected. Please select one or more files to import.");
+        msgBox.exec();
+        return;
+    }
+    startPlainTextImport(dialog.selectedFiles(), QString());
+}
 
-            fileDatas.append(qMakePair(fileContent, lastModified));
+void MainWindow::importPlainTextFolder()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, tr("Select Folder to Import"),
+                                                    QDir::homePath(), QFileDialog::ShowDirsOnly);
+    if (dir.isEmpty()) {
+        return;
+    }
+    startPlainTextImport(QStringList(), dir);
+}
 
-            // Close the file
-            file.close();
-        }
+/*!
+ * \brief MainWindow::startPlainTextImport
+ * Files are read on the thread pool and committed in batches by the database thread,
+ * the dialog only reports progress and lets the user cancel
+ */
+void MainWindow::startPlainTextImport(const QStringList &files, const QString &directory)
+{
+    if (m_plainTextImporter->isRunning()) {
+        return;
     }
 
-    QMessageBox msgBox;
-    if (!fileDatas.isEmpty()) {
-        m_dbManager->addNotesToNewImportedFolder(fileDatas);
-        msgBox.setText("Notes imported successfully!");
-        msgBox.exec();
+    QProgressDialog *pd = new QProgressDialog(tr("Importing notes..."), tr("Cancel"), 0, 0, this);
+    pd->setWindowModality(Qt::WindowModal);
+    pd->setMinimumDuration(500);
+    pd->setAttribute(Qt::WA_DeleteOnClose);
+    connect(pd, &QProgressDialog::canceled, m_plainTextImporter, &PlainTextImporter::cancel);
+    connect(m_plainTextImporter, &PlainTextImporter::progressChanged, pd,
+            [pd](int importedCount, int totalCount) {
+                pd->setMaximum(totalCount);
+                pd->setValue(importedCount);
+            });
+    connect(m_plainTextImporter, &PlainTextImporter::finished, pd,
+            [this, pd](int importedCount, const QStringList &failedFiles) {
+                pd->close();
+                QMessageBox msgBox(this);
+                if (importedCount == 0 && failedFiles.isEmpty()) {
+                    msgBox.setText(tr("No .txt or .md files found to import."));
+                } else {
+                    msgBox.setText(tr("%n note(s) imported.", nullptr, importedCount));
+                    if (!failedFiles.isEmpty()) {
+                        msgBox.setInformativeText(tr("%n file(s) couldn't be imported.", nullptr,
+                                                     failedFiles.size()));
+                        msgBox.setDetailedText(failedFiles.join('\n'));
+                    }
+                }
+                msgBox.exec();
+            });
+
+    if (directory.isEmpty()) {
+        m_plainTextImporter->importFiles(files);
     } else {
-        msgBox.setText("No files selected. Please select one or more files to import.");
-        msgBox.exec();
+        m_plainTextImporter->importDirectory(directory);
     }
 }
 
-void MainWindow::exportToPlainTextFiles(const QString &extension)
+void MainWindow::exportToPlainTextFiles(const QString &extension, bool isIncremental)
 {
     QString dir = QFileDialog::getExistingDirectory(nullptr, tr("Select Export Directory"),
                                                     "/home",
                                                     QFileDialog::ShowDirsOnly
                                                     | QFileDialog::DontResolveSymlinks);
 
-    if (dir.isEmpty()) {
+    if (dir.isEmpty() || m_plainTextExporter->isRunning()) {
         return;
     }
 
-    m_dbManager->exportNotes(dir, extension);
-
-    QMessageBox msgBox;
-    msgBox.setText("Notes exported successfully!");
-    msgBox.exec();
+    QProgressDialog *pd = new QProgressDialog(tr("Exporting notes..."), tr("Cancel"), 0, 0, this);
+    pd->setWindowModality(Qt::WindowModal);
+    pd->setMinimumDuration(500);
+    pd->setAttribute(Qt::WA_DeleteOnClose);
+    connect(pd, &QProgressDialog::canceled, m_plainTextExporter, &PlainTextExporter::cancel);
+    connect(m_plainTextExporter, &PlainTextExporter::progressChanged, pd,
+            [pd](int exportedCount, int totalCount) {
+                pd->setMaximum(totalCount);
+                pd->setValue(exportedCount);
+            });
+    connect(m_plainTextExporter, &PlainTextExporter::finished, pd,
+            [this, pd](int exportedCount, const QString &exportPath,
+                       const QStringList &failedFiles) {
+                pd->close();
+                QMessageBox msgBox(this);
+                msgBox.setText(tr("%n note(s) exported to %1.", nullptr, exportedCount)
+                                       .arg(QDir::toNativeSeparators(exportPath)));
+                if (!failedFiles.isEmpty()) {
+                    msgBox.setInformativeText(tr("%n file(s) couldn't be written.", nullptr,
+                                                 failedFiles.size()));
+                    msgBox.setDetailedText(failedFiles.join('\n'));
+                }
+                msgBox.exec();
+            });
+    m_plainTextExporter->exportNotes(dir, extension,
+                                     isIncremental ? PlainTextExporter::Mode::Incremental
+                                                   : PlainTextExporter::Mode::Full);
 }
 
 /*!
@@ -2406,12 +2525,9 @@ void MainWindow::executeImport(const bool replace)
         file.close();
 
         setButtonsAndFieldsEnabled(false);
-        if (replace) {
-            emit requestRestoreNotes(fileName);
-        } else {
-            emit requestImportNotes(fileName);
-        }
-        setButtonsAndFieldsEnabled(true);
+        QFuture<bool> request = replace ? m_dbManager->requestRestoreNotes(fileName)
+                                        : m_dbManager->requestImportNotes(fileName);
+        request.then(this, [this](bool) { setButtonsAndFieldsEnabled(true); });
         //        emit requestNotesList(SpecialNodeID::RootFolder, true);
     }
 }
@@ -2437,6 +2553,37 @@ void MainWindow::exportNotesFile()
             return;
         }
         file.close();
+
+        QProgressDialog *pd =
+                new QProgressDialog(tr("Saving notes backup..."), QString(), 0, 0, this);
+        pd->setWindowModality(Qt::WindowModal);
+        pd->setMinimumDuration(500);
+        pd->setAttribute(Qt::WA_DeleteOnClose);
+        connect(m_dbManager, &DBManager::backupStarted, pd,
+                [pd, fileName](const QString &backupFileName, bool isBlockingWrites) {
+                    if (backupFileName == fileName && isBlockingWrites) {
+                        pd->setLabelText(tr("Saving notes backup...\n"
+                                            "Changes are saved once the backup is done."));
+                    }
+                });
+        connect(m_dbManager, &DBManager::backupProgress, pd,
+                [pd](qint64 bytesWritten, qint64 totalBytes) {
+                    // in KiB, so large databases fit the int range of the dialog
+                    pd->setMaximum(int(totalBytes / 1024));
+                    pd->setValue(int(bytesWritten / 1024));
+                });
+        connect(m_dbManager, &DBManager::backupFinished, pd,
+                [this, pd, fileName](const QString &backupFileName, bool isSuccess) {
+                    if (backupFileName != fileName) {
+                        return;
+                    }
+                    pd->close();
+                    if (!isSuccess) {
+                        QMessageBox::warning(this, tr("Backup failed"),
+                                             tr("Can't save notes to %1")
+                                                     .arg(QDir::toNativeSeparators(fileName)));
+                    }
+                });
         emit requestExportNotes(fileName);
     }
 }
@@ -2721,11 +2868,7 @@ void MainWindow::mousePressEvent(QMouseEvent *event)
     if (event->buttons() == Qt::LeftButton) {
         if (isTitleBar(m_mousePressX, m_mousePressY)) {
 
-#  if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
             m_canMoveWindow = !window()->windowHandle()->startSystemMove();
-#  else
-            m_canMoveWindow = true;
-#  endif
         }
 
         event->accept();
@@ -2789,11 +2932,7 @@ void MainWindow::mousePressEvent(QMouseEvent *event)
     if (event->button() == Qt::LeftButton) {
         if (isTitleBar(event->pos().x(), event->pos().y())) {
 
-#  if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
             m_canMoveWindow = !window()->windowHandle()->startSystemMove();
-#  else
-            m_canMoveWindow = true;
-#  endif
             m_mousePressX = event->pos().x();
             m_mousePressY = event->pos().y();
         }
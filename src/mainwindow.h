@@ -70,6 +70,8 @@ class ListViewLogic;
 class NoteEditorLogic;
 class TagPool;
 class SplitterStyle;
+class PlainTextImporter;
+class PlainTextExporter;
 
 #if defined(Q_OS_WINDOWS) || defined(Q_OS_WIN)
 // #if defined(__MINGW32__) || defined(__GNUC__)
@@ -197,6 +199,8 @@ private:
     QQuickView m_editorSettingsQuickView;
     QWidget *m_editorSettingsWidget;
     TagPool *m_tagPool;
+    PlainTextImporter *m_plainTextImporter;
+    PlainTextExporter *m_plainTextExporter;
     DBManager *m_dbManager;
     QThread *m_dbThread;
     SplitterStyle *m_splitterStyle;
@@ -275,6 +279,7 @@ private:
     QAction *m_buyOrManageSubscriptionAction;
     bool m_isLicensedCheckedAfterStartup;
     QString m_databaseFolderPath;
+    bool m_isCreatingNewNote;
 
     void setupMainWindow();
     void setupFonts();
@@ -335,7 +340,9 @@ private slots:
     void toggleNoteList();
     void toggleFolderTree();
     void importPlainTextFiles();
-    void exportToPlainTextFiles(const QString &extension);
+    void importPlainTextFolder();
+    void startPlainTextImport(const QStringList &files, const QString &directory);
+    void exportToPlainTextFiles(const QString &extension, bool isIncremental = false);
     void importNotesFile();
     void exportNotesFile();
     void restoreNotesFile();
@@ -357,13 +364,10 @@ signals:
     void mainWindowDeactivated();
     void requestNodesTree();
     void requestOpenDBManager(const QString &path, bool doCreate);
-    void requestRestoreNotes(const QString &filePath);
-    void requestImportNotes(const QString &filePath);
     void requestExportNotes(QString fileName);
     void requestMigrateNotesFromV0_9_0(QVector<NodeData> &noteList);
     void requestMigrateTrashFromV0_9_0(QVector<NodeData> &noteList);
     void requestMigrateNotesFromV1_5_0(const QString &path);
-    void requestChangeDatabasePath(const QString &newPath);
     void showPopupWithText(QVariant text);
     void themeChanged(QVariant theme);
     void platformSet(QVariant platform);
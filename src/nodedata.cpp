@@ -10,7 +10,8 @@ NodeData::NodeData()
       m_isPinnedNote{ false },
       m_tagListScrollBarPos{ 0 },
       m_relativePosAN{ 0 },
-      m_childNotesCount{ 0 }
+      m_childNotesCount{ 0 },
+      m_isContentLoaded{ true }
 {
 }
 
@@ -204,6 +205,26 @@ void NodeData::setChildNotesCount(int newChildCount)
     m_childNotesCount = newChildCount;
 }
 
+const QString &NodeData::preview() const
+{
+    return m_preview;
+}
+
+void NodeData::setPreview(const QString &newPreview)
+{
+    m_preview = newPreview;
+}
+
+bool NodeData::isContentLoaded() const
+{
+    return m_isContentLoaded;
+}
+
+void NodeData::setIsContentLoaded(bool newIsContentLoaded)
+{
+    m_isContentLoaded = newIsContentLoaded;
+}
+
 QDateTime NodeData::creationDateTime() const
 {
     return m_creationDateTime;
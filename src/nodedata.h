@@ -81,6 +81,12 @@ public:
     int childNotesCount() const;
     void setChildNotesCount(int newChildCount);
 
+    const QString &preview() const;
+    void setPreview(const QString &newPreview);
+
+    bool isContentLoaded() const;
+    void setIsContentLoaded(bool newIsContentLoaded);
+
 private:
     int m_id;
     QString m_fullTitle;
@@ -102,6 +108,8 @@ private:
     int m_tagListScrollBarPos;
     int m_relativePosAN;
     int m_childNotesCount;
+    QString m_preview;
+    bool m_isContentLoaded;
 };
 
 Q_DECLARE_METATYPE(NodeData)
@@ -5,11 +5,7 @@ NodePath::NodePath(const QString &path) : m_path(path) { }
 
 QStringList NodePath::separate() const
 {
-#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
-    return m_path.split(PATH_SEPARATOR, QString::SkipEmptyParts);
-#else
     return m_path.split(PATH_SEPARATOR, Qt::SkipEmptyParts);
-#endif
 }
 
 QString NodePath::path() const
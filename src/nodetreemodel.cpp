@@ -637,26 +637,24 @@ void NodeTreeModel::loadTagList(const QVector<TagData> &tagData, NodeTreeItem *r
 
 void NodeTreeModel::updateChildRelativePosition(NodeTreeItem *parent, const NodeItem::Type type)
 {
-    int relId = 0;
+    if (type != NodeItem::Type::FolderItem && type != NodeItem::Type::TagItem) {
+        qDebug() << __FUNCTION__ << "Wrong type";
+        return;
+    }
+    QVector<int> ids;
     for (int i = 0; i < parent->childCount(); ++i) {
         auto child = parent->child(i);
         auto childType =
                 static_cast<NodeItem::Type>(child->data(NodeItem::Roles::ItemType).toInt());
         if (childType == type) {
-            if (type == NodeItem::Type::FolderItem) {
-                emit requestUpdateNodeRelativePosition(child->data(NodeItem::Roles::NodeId).toInt(),
-                                                       relId);
-                ++relId;
-            } else if (type == NodeItem::Type::TagItem) {
-                emit requestUpdateTagRelativePosition(child->data(NodeItem::Roles::NodeId).toInt(),
-                                                      relId);
-                ++relId;
-            } else {
-                qDebug() << __FUNCTION__ << "Wrong type";
-                return;
-            }
+            ids.append(child->data(NodeItem::Roles::NodeId).toInt());
         }
     }
+    if (type == NodeItem::Type::FolderItem) {
+        emit requestUpdateNodeRelativePosition(ids);
+    } else {
+        emit requestUpdateTagRelativePosition(ids);
+    }
 }
 
 Qt::ItemFlags NodeTreeModel::flags(const QModelIndex &index) const
@@ -110,8 +110,8 @@ signals:
     void topLevelItemLayoutChanged();
     void requestExpand(const QString &indexPath);
     void requestMoveNode(int nodeId, int targetId);
-    void requestUpdateNodeRelativePosition(int nodeId, int relativePosition);
-    void requestUpdateTagRelativePosition(int nodeId, int relativePosition);
+    void requestUpdateNodeRelativePosition(const QVector<int> &nodeIds);
+    void requestUpdateTagRelativePosition(const QVector<int> &tagIds);
     void requestUpdateAbsPath(const QString &oldPath, const QString &newPath);
     void dropFolderSuccessful(const QString &paths);
     void dropTagsSuccessful(const QSet<int> &ids);
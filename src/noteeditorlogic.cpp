@@ -1,4 +1,5 @@
 #include "noteeditorlogic.h"
+#include "notepreview.h"
 #include "customMarkdownHighlighter.h"
 #include "dbmanager.h"
 #include "taglistview.h"
@@ -12,8 +13,6 @@
 #include <QDebug>
 #include <QCursor>
 
-#define FIRST_LINE_MAX 80
-
 NoteEditorLogic::NoteEditorLogic(QLineEdit *searchEdit, TagListView *tagListView, TagPool *tagPool,
                                  DBManager *dbManager, BlockModel *blockModel, QObject *parent)
     : QObject(parent),
@@ -87,12 +86,23 @@ void NoteEditorLogic::showNotesInEditor(const QVector<NodeData> &notes, bool isC
 
         m_currentNotes = notes;
         showTagListForCurrentNote();
-
-        QString content = notes[0].content();
-        int scrollbarPos = notes[0].scrollBarPosition();
-
-        m_blockModel->setVerticalScrollBarPosition(0, scrollbarPos);
-        m_blockModel->loadText(content, isCalledFromShortcut);
+        if (!m_currentNotes[0].isContentLoaded()) {
+            // the note list only carries a preview of each note, load the body on demand
+            m_blockModel->setNothingLoaded();
+            int noteId = m_currentNotes[0].id();
+            m_dbManager->requestNoteContent(noteId).then(
+                    this, [this, noteId, isCalledFromShortcut](const QString &noteContent) {
+                        // another note may have been selected in the meantime
+                        if (m_currentNotes.size() != 1 || m_currentNotes[0].id() != noteId) {
+                            return;
+                        }
+                        m_currentNotes[0].setContent(noteContent);
+                        m_currentNotes[0].setIsContentLoaded(true);
+                        loadCurrentNoteText(isCalledFromShortcut);
+                    });
+        } else {
+            loadCurrentNoteText(isCalledFromShortcut);
+        }
 
         // QDateTime dateTime = notes[0].lastModificationdateTime();
         // QString noteDate = dateTime.toString(Qt::ISODate);
@@ -111,9 +121,22 @@ void NoteEditorLogic::showNotesInEditor(const QVector<NodeData> &notes, bool isC
     }
 }
 
+void NoteEditorLogic::loadCurrentNoteText(bool isCalledFromShortcut)
+{
+    QString content = m_currentNotes[0].content();
+    int scrollbarPos = m_currentNotes[0].scrollBarPosition();
+
+    m_blockModel->setVerticalScrollBarPosition(0, scrollbarPos);
+    m_blockModel->loadText(content, isCalledFromShortcut);
+}
+
 void NoteEditorLogic::onBlockModelTextChanged()
 {
     if (currentEditingNoteId() != SpecialNodeID::InvalidNodeId) {
+        if (!m_currentNotes[0].isContentLoaded()) {
+            // the body is still loading, don't let the empty editor overwrite it
+            return;
+        }
         QString content = m_currentNotes[0].content();
         QString sourceDocumentPlainText = m_blockModel->sourceDocument()->toPlainText();
         if (sourceDocumentPlainText != content) {
@@ -126,6 +149,7 @@ void NoteEditorLogic::onBlockModelTextChanged()
             QString noteDate = dateTime.toString(Qt::ISODate);
             // update note data
             m_currentNotes[0].setContent(sourceDocumentPlainText);
+            m_currentNotes[0].setPreview(NotePreview::secondLine(sourceDocumentPlainText));
             m_currentNotes[0].setFullTitle(firstline);
             m_currentNotes[0].setLastModificationDateTime(dateTime);
             m_currentNotes[0].setIsTempNote(false);
@@ -258,35 +282,6 @@ QString NoteEditorLogic::getFirstLine(const QString &str)
     return ts.readLine(FIRST_LINE_MAX);
 }
 
-QString NoteEditorLogic::getSecondLine(const QString &str)
-{
-    int previousLineBreakIndex = 0;
-    int lineCount = 0;
-    for (int i = 0; i < str.length(); i++) {
-        if (str[i] == '\n' || i == str.length() - 1) {
-            lineCount++;
-            if (lineCount > 1 && (i - previousLineBreakIndex > 1 || (i == str.length() - 1 && str[i] != '\n'))) {
-                QString line = str.mid(previousLineBreakIndex + 1, i - previousLineBreakIndex);
-                line = line.trimmed();
-                if (!line.isEmpty() && !line.startsWith("{{") && !line.startsWith("---") && !line.startsWith("```")) {
-                    line.replace("<br />", "\n");
-                    QTextDocument doc;
-                    doc.setMarkdown(line);
-                    QString text = doc.toPlainText();
-                    if (text.length() > 1 && text.first(1) == "^") {
-                        text = text.mid(1);
-                    }
-                    QTextStream ts(&text);
-                    return ts.readLine(FIRST_LINE_MAX);
-                }
-            }
-            previousLineBreakIndex = i;
-        }
-    }
-
-    return tr("No additional text");
-}
-
 void NoteEditorLogic::setTheme(Theme::Value theme, QColor textColor, qreal fontSize)
 {
     m_tagListDelegate->setTheme(theme);
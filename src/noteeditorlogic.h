@@ -43,7 +43,6 @@ public:
     void deleteCurrentNote();
 
     static QString getFirstLine(const QString &str);
-    static QString getSecondLine(const QString &str);
     void setTheme(Theme::Value theme, QColor textColor, qreal fontSize);
 
     int currentAdaptableEditorPadding() const;
@@ -75,6 +74,7 @@ signals:
 private:
     static QDateTime getQDateTime(const QString &date);
     void showTagListForCurrentNote();
+    void loadCurrentNoteText(bool isCalledFromShortcut);
     bool isInEditMode() const;
     QString moveTextToNewLinePosition(const QString &inputText, int startLinePosition,
                                       int endLinePosition, int newLinePosition,
@@ -7,7 +7,6 @@
 #include <QtMath>
 #include <QPainterPath>
 #include "notelistmodel.h"
-#include "noteeditorlogic.h"
 #include "tagpool.h"
 #include "nodepath.h"
 #include "notelistdelegateeditor.h"
@@ -54,13 +53,20 @@ NoteListDelegate::NoteListDelegate(NoteListView *view, TagPool *tagPool, QObject
       m_state(NoteListState::Normal),
       m_isActive(false),
       m_isInAllNotes(false),
-      m_theme(Theme::Light)
+      m_theme(Theme::Light),
+      m_rowPixmapCache(ROW_PIXMAP_CACHE_BYTES)
 {
     m_timeLine = new QTimeLine(300, this);
     m_timeLine->setFrameRange(0, m_maxFrame);
     m_timeLine->setUpdateInterval(10);
     m_timeLine->setEasingCurve(QEasingCurve::InCurve);
     m_folderIcon = QImage(":/images/folder.png");
+    if (m_tagPool) {
+        // tag chips show the tag name and color
+        connect(m_tagPool, &TagPool::dataReset, this, &NoteListDelegate::clearRowPixmapCache);
+        connect(m_tagPool, &TagPool::dataUpdated, this, &NoteListDelegate::clearRowPixmapCache);
+        connect(m_tagPool, &TagPool::tagDeleted, this, &NoteListDelegate::clearRowPixmapCache);
+    }
     connect(m_timeLine, &QTimeLine::frameChanged, this, [this]() {
         for (const auto &index : qAsConst(m_animatedIndexes)) {
             emit sizeHintChanged(index);
@@ -120,7 +126,9 @@ void NoteListDelegate::paint(QPainter *painter, const QStyleOptionViewItem &opti
                              const QModelIndex &index) const
 {
     bool isHaveTags = index.data(NoteListModel::NoteTagsList).value<QSet<int>>().size() > 0;
-    if ((!m_animatedIndexes.contains(index)) && isHaveTags) {
+    bool isAnimated = m_animatedIndexes.contains(index);
+    // the hovered or selected row is covered by its editor widget
+    if (!isAnimated && isHaveTags && m_view->isPersistentEditorOpen(index)) {
         return;
     }
     if (m_view->isPinnedNotesCollapsed()) {
@@ -156,8 +164,123 @@ void NoteListDelegate::paint(QPainter *painter, const QStyleOptionViewItem &opti
         break;
     }
 
-    paintBackground(painter, opt, index);
+    if (isAnimated || m_view->isDragging() || option.rect.isEmpty()) {
+        paintRow(painter, opt, option, index);
+        return;
+    }
+
+    // everything drawn below only depends on what goes into the key
+    if (m_rowPixmapCacheDate != QDate::currentDate()) {
+        // "Yesterday" and weekday labels move on at midnight
+        m_rowPixmapCache.clear();
+        m_rowPixmapCacheDate = QDate::currentDate();
+    }
+    auto id = index.data(NoteListModel::NoteID).toInt();
+    QPair<quint64, quint64> key(
+            (quint64(quint32(id)) << 32) | m_noteRevisions.value(id),
+            (quint64(quint16(option.rect.width())) << 48)
+                    | (quint64(quint16(option.rect.height())) << 32)
+                    | rowPaintState(option, index));
+    auto cached = m_rowPixmapCache.object(key);
+    if (cached) {
+        ++m_rowPixmapCacheStats.hits;
+        painter->drawPixmap(option.rect.topLeft(), *cached);
+        return;
+    }
+    ++m_rowPixmapCacheStats.misses;
+
+    qreal dpr = m_view->viewport()->devicePixelRatioF();
+    QPixmap pixmap(option.rect.size() * dpr);
+    pixmap.setDevicePixelRatio(dpr);
+    pixmap.fill(Qt::transparent);
+    {
+        QPainter rowPainter(&pixmap);
+        rowPainter.setRenderHint(QPainter::Antialiasing);
+        QStyleOptionViewItem rowOpt = opt;
+        rowOpt.rect.moveTo(0, 0);
+        QStyleOptionViewItem rowOption = option;
+        rowOption.rect.moveTo(0, 0);
+        paintRow(&rowPainter, rowOpt, rowOption, index);
+    }
+    painter->drawPixmap(option.rect.topLeft(), pixmap);
+    int cost = pixmap.width() * pixmap.height() * pixmap.depth() / 8;
+    m_rowPixmapCache.insert(key, new QPixmap(pixmap), cost);
+}
+
+void NoteListDelegate::paintRow(QPainter *painter, const QStyleOptionViewItem &backgroundOption,
+                                const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    paintBackground(painter, backgroundOption, index);
     paintLabels(painter, option, index);
+    bool isHaveTags = index.data(NoteListModel::NoteTagsList).value<QSet<int>>().size() > 0;
+    if (!m_animatedIndexes.contains(index) && isHaveTags
+        && !(m_view->isPinnedNotesCollapsed()
+             && index.data(NoteListModel::NoteIsPinned).value<bool>())) {
+        paintTagList(option.rect.y() + tagListTop(index), painter, option, index);
+    }
+}
+
+/*!
+ * \brief NoteListDelegate::rowPaintState
+ * Everything besides the note itself and the row size that changes how a row is painted
+ */
+quint32 NoteListDelegate::rowPaintState(const QStyleOptionViewItem &option,
+                                        const QModelIndex &index) const
+{
+    auto model = dynamic_cast<NoteListModel *>(m_view->model());
+    quint32 state = 0;
+    auto setBit = [&state](int bit, bool value) {
+        if (value) {
+            state |= (1u << bit);
+        }
+    };
+    setBit(0, (option.state & QStyle::State_Selected) == QStyle::State_Selected);
+    setBit(1, (option.state & QStyle::State_MouseOver) == QStyle::State_MouseOver);
+    setBit(2, m_isActive);
+    setBit(3, qApp->applicationState() == Qt::ApplicationActive);
+    setBit(4, qApp->applicationState() == Qt::ApplicationInactive);
+    setBit(5, m_isInAllNotes);
+    setBit(6, m_view->isPinnedNotesCollapsed());
+    setBit(7, index.data(NoteListModel::NoteIsPinned).toBool());
+    if (model) {
+        setBit(8, model->hasPinnedNote());
+        setBit(9, model->isFirstPinnedNote(index));
+        setBit(10, model->isFirstUnpinnedNote(index));
+        setBit(11, index.row() == model->rowCount() - 1);
+        setBit(12, shouldPaintSeparator(index, *model));
+    }
+    state |= (quint32(m_theme) & 0xf) << 16;
+    state |= (quint32(m_rowRightOffset) & 0xff) << 20;
+    return state;
+}
+
+/*!
+ * \brief NoteListDelegate::invalidateRowPixmaps
+ * Bumps the content revision of the notes in the range so their rendered rows are not
+ * reused, the old ones age out of the cache
+ */
+void NoteListDelegate::invalidateRowPixmaps(const QModelIndex &topLeft,
+                                            const QModelIndex &bottomRight)
+{
+    auto model = m_view->model();
+    if (!model || !topLeft.isValid() || !bottomRight.isValid()) {
+        return;
+    }
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        auto id = model->index(row, 0).data(NoteListModel::NoteID).toInt();
+        ++m_noteRevisions[id];
+    }
+}
+
+void NoteListDelegate::clearRowPixmapCache()
+{
+    m_rowPixmapCache.clear();
+    m_noteRevisions.clear();
+}
+
+RowPixmapCacheStats NoteListDelegate::rowPixmapCacheStats() const
+{
+    return m_rowPixmapCacheStats;
 }
 
 QSize NoteListDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
@@ -166,22 +289,10 @@ QSize NoteListDelegate::sizeHint(const QStyleOptionViewItem &option, const QMode
     result.setWidth(option.rect.width());
     auto model = dynamic_cast<NoteListModel *>(m_view->model());
     const auto &note = model->getNote(index);
-    auto id = note.id();
     bool isHaveTags = note.tagIds().size() > 0;
-#if QT_VERSION < QT_VERSION_CHECK(5, 10, 0)
-    if ((!m_animatedIndexes.contains(index)) && isHaveTags) {
-#else
-    if (m_view->isPersistentEditorOpen(index) && (!m_animatedIndexes.contains(index))
-        && isHaveTags) {
-#endif
-        if (szMap.contains(id)) {
-            result.setHeight(szMap[id].height());
-            return result;
-        }
-    }
     int rowHeight = 80;
     if (isHaveTags) {
-        rowHeight = m_rowHeight;
+        rowHeight = 70 + tagListHeight(index, m_view->viewport()->width()) + 2;
     }
     if (m_animatedIndexes.contains(index)) {
         if (m_state == NoteListState::MoveIn) {
@@ -248,22 +359,10 @@ QSize NoteListDelegate::bufferSizeHint(const QStyleOptionViewItem &option,
 {
     QSize result = QStyledItemDelegate::sizeHint(option, index);
     result.setWidth(option.rect.width());
-    auto id = index.data(NoteListModel::NoteID).toInt();
     bool isHaveTags = index.data(NoteListModel::NoteTagsList).value<QSet<int>>().size() > 0;
-#if QT_VERSION < QT_VERSION_CHECK(5, 10, 0)
-    if (!m_animatedIndexes.contains(index) && isHaveTags) {
-#else
-    if (m_view->isPersistentEditorOpen(index) && (!m_animatedIndexes.contains(index))
-        && isHaveTags) {
-#endif
-        if (szMap.contains(id)) {
-            result.setHeight(szMap[id].height());
-            return result;
-        }
-    }
     int rowHeight = 80;
     if (isHaveTags) {
-        rowHeight = m_rowHeight;
+        rowHeight = 70 + tagListHeight(index, m_view->viewport()->width()) + 2;
     }
     result.setHeight(rowHeight);
     if (m_isInAllNotes) {
@@ -508,8 +607,7 @@ void NoteListDelegate::paintLabels(QPainter *painter, const QStyleOptionViewItem
         QFontMetrics fmParentName(titleFont);
         QRect fmRectParentName = fmParentName.boundingRect(parentName);
 
-        QString content{ index.data(NoteListModel::NoteContent).toString() };
-        content = NoteEditorLogic::getSecondLine(content);
+        QString content{ index.data(NoteListModel::NotePreview).toString() };
         QFontMetrics fmContent(m_contentFont);
         QRect fmRectContent = fmContent.boundingRect(content);
         double rowPosX = 0; // option.rect.x();
@@ -692,8 +790,7 @@ void NoteListDelegate::paintLabels(QPainter *painter, const QStyleOptionViewItem
         QFontMetrics fmParentName(titleFont);
         QRect fmRectParentName = fmParentName.boundingRect(parentName);
 
-        QString content{ index.data(NoteListModel::NoteContent).toString() };
-        content = NoteEditorLogic::getSecondLine(content);
+        QString content{ index.data(NoteListModel::NotePreview).toString() };
         QFontMetrics fmContent(m_contentFont);
         QRect fmRectContent = fmContent.boundingRect(content);
 
@@ -836,23 +933,24 @@ void NoteListDelegate::paintSeparator(QPainter *painter, QRect rect, const QMode
 void NoteListDelegate::paintTagList(int top, QPainter *painter, const QStyleOptionViewItem &option,
                                     const QModelIndex &index) const
 {
-    auto tagIds = index.data(NoteListModel::NoteTagsList).value<QSet<int>>();
-    int left = option.rect.x() + 10;
-
-    for (const auto &id : qAsConst(tagIds)) {
-        if (left >= option.rect.width()) {
+    // same area the editor puts its TagListView in, chips that don't fit are clipped
+    QRect area(option.rect.x() + NoteListConstant::leftOffsetX - 5, top, option.rect.width() - 26,
+               tagListHeight(index, option.rect.width()));
+    painter->save();
+    painter->setClipRect(area);
+#ifdef __APPLE__
+    int iconPointSizeOffset = 0;
+#else
+    int iconPointSizeOffset = -4;
+#endif
+    QFont iconFont("Font Awesome 6 Free Solid", 14 + iconPointSizeOffset);
+    const auto chips = tagChipRects(index, area.width());
+    for (const auto &chip : chips) {
+        auto tag = m_tagPool->getTag(chip.first);
+        auto rect = chip.second.translated(area.topLeft());
+        if (rect.top() > area.bottom()) {
             break;
         }
-        auto tag = m_tagPool->getTag(id);
-        QFontMetrics fmName(m_contentFont);
-        QRect fmRectName = fmName.boundingRect(tag.name());
-
-        auto rect = option.rect;
-        rect.setTop(top);
-        rect.setLeft(left);
-        rect.setHeight(20);
-        rect.setWidth(5 + 12 + 5 + fmRectName.width() + 7);
-        left += rect.width() + 5;
         QPainterPath path;
         path.addRoundedRect(rect, 10, 10);
         if (m_theme == Theme::Dark) {
@@ -864,12 +962,7 @@ void NoteListDelegate::paintTagList(int top, QPainter *painter, const QStyleOpti
         }
         auto iconRect = QRect(rect.x() + 5, rect.y() + (rect.height() - 12) / 2, 14, 14);
         painter->setPen(QColor(tag.color()));
-#ifdef __APPLE__
-        int iconPointSizeOffset = 0;
-#else
-        int iconPointSizeOffset = -4;
-#endif
-        painter->setFont(QFont("Font Awesome 6 Free Solid", 14 + iconPointSizeOffset));
+        painter->setFont(iconFont);
         painter->drawText(iconRect, u8"\uf111"); // fa-circle
         painter->setBrush(m_titleColor);
         painter->setPen(m_titleColor);
@@ -879,6 +972,71 @@ void NoteListDelegate::paintTagList(int top, QPainter *painter, const QStyleOpti
         painter->setFont(m_contentFont);
         painter->drawText(nameRect, Qt::AlignLeft | Qt::AlignVCenter, tag.name());
     }
+    painter->restore();
+}
+
+/*!
+ * \brief NoteListDelegate::tagChipRects
+ * Wraps the tag chips of a note the way TagListView lays them out
+ * \param width width of the tag list area
+ * \return tag id and chip rect relative to the top left corner of the tag list area
+ */
+QVector<QPair<int, QRect>> NoteListDelegate::tagChipRects(const QModelIndex &index,
+                                                         int width) const
+{
+    QVector<QPair<int, QRect>> chips;
+    auto tagIds = index.data(NoteListModel::NoteTagsList).value<QSet<int>>();
+    QFontMetrics fmName(m_contentFont);
+    const int spacing = 3;
+    int left = spacing;
+    int top = spacing;
+    for (const auto &id : qAsConst(tagIds)) {
+        auto tag = m_tagPool->getTag(id);
+        int chipWidth = 5 + 12 + 5 + fmName.boundingRect(tag.name()).width() + 7;
+        if (left > spacing && left + chipWidth > width) {
+            left = spacing;
+            top += 20 + spacing;
+        }
+        chips.append(qMakePair(id, QRect(left, top, chipWidth, 20)));
+        left += chipWidth + spacing;
+    }
+    return chips;
+}
+
+/*!
+ * \brief NoteListDelegate::tagListHeight
+ * Height of the tag list area of a row, capped like TagListView so that painted rows
+ * and rows with an open editor have the same size
+ * \param width width of the row
+ */
+int NoteListDelegate::tagListHeight(const QModelIndex &index, int width) const
+{
+    const auto chips = tagChipRects(index, width - 26);
+    if (chips.isEmpty()) {
+        return 0;
+    }
+    int height = chips.last().second.bottom() - chips.first().second.top() + 1;
+    return qMin(height + 10, 80);
+}
+
+int NoteListDelegate::tagListTop(const QModelIndex &index) const
+{
+    int y = m_isInAllNotes ? 100 : 71;
+    auto model = dynamic_cast<NoteListModel *>(m_view->model());
+    if (model) {
+        if (model->hasPinnedNote()
+            && (model->isFirstPinnedNote(index) || model->isFirstUnpinnedNote(index))) {
+            y += 25;
+        }
+        if (model->isFirstUnpinnedNote(index)) {
+            y += NoteListConstant::unpinnedHeaderToNoteSpace;
+        }
+        if (model->hasPinnedNote() && !m_view->isPinnedNotesCollapsed()
+            && model->isFirstUnpinnedNote(index)) {
+            y += NoteListConstant::lastPinnedToUnpinnedHeader;
+        }
+    }
+    return y;
 }
 
 bool NoteListDelegate::shouldPaintSeparator(const QModelIndex &index,
@@ -985,21 +1143,10 @@ void NoteListDelegate::setIsInAllNotes(bool newIsInAllNotes)
     m_isInAllNotes = newIsInAllNotes;
 }
 
-void NoteListDelegate::clearSizeMap()
-{
-    szMap.clear();
-}
-
-void NoteListDelegate::updateSizeMap(int id, QSize sz, const QModelIndex &index)
-{
-    szMap[id] = sz;
-    emit sizeHintChanged(index);
-}
-
-void NoteListDelegate::editorDestroyed(int id, const QModelIndex &index)
+void NoteListDelegate::clearEditorPool()
 {
-    szMap.remove(id);
-    emit sizeHintChanged(index);
+    qDeleteAll(m_editorPool);
+    m_editorPool.clear();
 }
 
 QWidget *NoteListDelegate::createEditor(QWidget *parent, const QStyleOptionViewItem &option,
@@ -1021,15 +1168,37 @@ QWidget *NoteListDelegate::createEditor(QWidget *parent, const QStyleOptionViewI
     if (!isHaveTags) {
         return nullptr;
     }
+    if (!m_editorPool.isEmpty()) {
+        auto w = m_editorPool.takeLast();
+        if (w->parentWidget() != parent) {
+            w->setParent(parent);
+        }
+        w->setIndex(option, index);
+        return w;
+    }
     auto w = new NoteListDelegateEditor(this, m_view, option, index, m_tagPool, parent);
     w->setTheme(m_theme);
     connect(this, &NoteListDelegate::themeChanged, w, &NoteListDelegateEditor::setTheme);
-    connect(w, &NoteListDelegateEditor::updateSizeHint, this, &NoteListDelegate::updateSizeMap);
-    connect(w, &NoteListDelegateEditor::nearDestroyed, this, &NoteListDelegate::editorDestroyed);
-    w->recalculateSize();
     return w;
 }
 
+/*!
+ * \brief NoteListDelegate::destroyEditor
+ * Editors only exist for the hovered and selected rows, and those change all the time,
+ * so a few closed editors are kept hidden and rebound to the next row instead of
+ * building a new widget tree each time
+ */
+void NoteListDelegate::destroyEditor(QWidget *editor, const QModelIndex &index) const
+{
+    auto w = qobject_cast<NoteListDelegateEditor *>(editor);
+    if (w && m_editorPool.size() < NOTE_EDITOR_POOL_SIZE) {
+        w->clearIndex();
+        m_editorPool.append(w);
+        return;
+    }
+    QStyledItemDelegate::destroyEditor(editor, index);
+}
+
 void NoteListDelegate::setActive(bool isActive)
 {
     m_isActive = isActive;
@@ -5,12 +5,27 @@
 #include <QStyledItemDelegate>
 #include <QTimeLine>
 #include <QQueue>
+#include <QCache>
+#include <QPixmap>
+#include <QDate>
 #include "editorsettingsoptions.h"
 
 class TagPool;
 class NoteListModel;
+class NoteListDelegateEditor;
 enum class NoteListState { Normal, Insert, Remove, MoveOut, MoveIn };
 
+// hidden editors kept around for the next hovered or selected tagged row
+#define NOTE_EDITOR_POOL_SIZE 4
+// memory budget of the rendered rows NoteListDelegate keeps for repainting
+#define ROW_PIXMAP_CACHE_BYTES (16 * 1024 * 1024)
+
+struct RowPixmapCacheStats
+{
+    quint64 hits = 0;
+    quint64 misses = 0;
+};
+
 class NoteListDelegate : public QStyledItemDelegate
 {
     Q_OBJECT
@@ -37,16 +52,19 @@ public:
     Theme::Value theme() const;
     void setIsInAllNotes(bool newIsInAllNotes);
     bool isInAllNotes() const;
-    void clearSizeMap();
+    int tagListHeight(const QModelIndex &index, int width) const;
+    void clearEditorPool();
+    void invalidateRowPixmaps(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    RowPixmapCacheStats rowPixmapCacheStats() const;
 
 public slots:
-    void updateSizeMap(int id, QSize sz, const QModelIndex &index);
-    void editorDestroyed(int id, const QModelIndex &index);
+    void clearRowPixmapCache();
 
     // QAbstractItemDelegate interface
 public:
     virtual QWidget *createEditor(QWidget *parent, const QStyleOptionViewItem &option,
                                   const QModelIndex &index) const override;
+    virtual void destroyEditor(QWidget *editor, const QModelIndex &index) const override;
     const QModelIndex &hoveredIndex() const;
     bool shouldPaintSeparator(const QModelIndex &index, const NoteListModel &model) const;
 
@@ -60,8 +78,13 @@ private:
     void paintLabels(QPainter *painter, const QStyleOptionViewItem &option,
                      const QModelIndex &index) const;
     void paintSeparator(QPainter *painter, QRect rect, const QModelIndex &index) const;
+    void paintRow(QPainter *painter, const QStyleOptionViewItem &backgroundOption,
+                  const QStyleOptionViewItem &option, const QModelIndex &index) const;
+    quint32 rowPaintState(const QStyleOptionViewItem &option, const QModelIndex &index) const;
     void paintTagList(int top, QPainter *painter, const QStyleOptionViewItem &option,
                       const QModelIndex &index) const;
+    QVector<QPair<int, QRect>> tagChipRects(const QModelIndex &index, int width) const;
+    int tagListTop(const QModelIndex &index) const;
     QString parseDateTime(const QDateTime &dateTime) const;
     void setStateI(NoteListState NewState, const QModelIndexList &indexes);
 
@@ -93,7 +116,12 @@ private:
     QTimeLine *m_timeLine;
     QModelIndexList m_animatedIndexes;
     QModelIndex m_hoveredIndex;
-    QMap<int, QSize> szMap;
+    mutable QVector<NoteListDelegateEditor *> m_editorPool;
+    // key: note id and content revision, row size and paint state
+    mutable QCache<QPair<quint64, quint64>, QPixmap> m_rowPixmapCache;
+    mutable RowPixmapCacheStats m_rowPixmapCacheStats;
+    mutable QDate m_rowPixmapCacheDate;
+    QHash<int, quint32> m_noteRevisions;
     QQueue<QPair<QSet<int>, NoteListState>> animationQueue;
 };
 
@@ -9,8 +9,8 @@
 #include <QScrollBar>
 #include <QDragEnterEvent>
 #include <QMimeData>
+#include <QSignalBlocker>
 #include "notelistmodel.h"
-#include "noteeditorlogic.h"
 #include "tagpool.h"
 #include "nodepath.h"
 #include "notelistdelegate.h"
@@ -75,71 +75,57 @@ NoteListDelegateEditor::NoteListDelegateEditor(const NoteListDelegate *delegate,
     m_tagListView->setModel(m_tagListModel);
     m_tagListView->setItemDelegate(m_tagListDelegate);
     m_tagListModel->setTagPool(tagPool);
-    m_tagListModel->setModelData(index.data(NoteListModel::NoteTagsList).value<QSet<int>>());
-    if (m_delegate->isInAllNotes()) {
-        int y = 90;
-        auto model = dynamic_cast<NoteListModel *>(m_view->model());
-        if (model) {
-            auto m_index = model->getNoteIndex(m_id);
-            if (model->hasPinnedNote()
-                && (model->isFirstPinnedNote(m_index) || model->isFirstUnpinnedNote(m_index))) {
-                y += 25;
-            }
-        }
-        int fourthYOffset = 0;
-        if (model && model->isFirstUnpinnedNote(index)) {
-            fourthYOffset = NoteListConstant::unpinnedHeaderToNoteSpace;
-        }
-        int fifthYOffset = 0;
-        if (model && model->hasPinnedNote() && !m_view->isPinnedNotesCollapsed()
-            && model->isFirstUnpinnedNote(index)) {
-            fifthYOffset = NoteListConstant::lastPinnedToUnpinnedHeader;
+    connect(m_tagListView->verticalScrollBar(), &QScrollBar::valueChanged, this, [this] {
+        auto idx = dynamic_cast<NoteListModel *>(m_view->model())->getNoteIndex(m_id);
+        if (idx.isValid()) {
+            dynamic_cast<NoteListModel *>(m_view->model())
+                    ->setData(idx, getScrollBarPos(), NoteListModel::NoteTagListScrollbarPos);
         }
-        int yOffsets = fourthYOffset + fifthYOffset;
+    });
+    setIndex(option, index);
+    setMouseTracking(true);
+    setAcceptDrops(true);
+}
 
-        y += yOffsets;
-        m_tagListView->setGeometry(10, y - 5, rect().width() - 24, m_tagListView->height());
-    } else {
-        int y = 70;
-        auto model = dynamic_cast<NoteListModel *>(m_view->model());
-        if (model) {
-            auto m_index = model->getNoteIndex(m_id);
-            if (model->hasPinnedNote()
-                && (model->isFirstPinnedNote(m_index) || model->isFirstUnpinnedNote(m_index))) {
-                y += 25;
-            }
-        }
-        int fourthYOffset = 0;
-        if (model && model->isFirstUnpinnedNote(index)) {
-            fourthYOffset = NoteListConstant::unpinnedHeaderToNoteSpace;
-        }
-        int fifthYOffset = 0;
-        if (model && model->hasPinnedNote() && !m_view->isPinnedNotesCollapsed()
-            && model->isFirstUnpinnedNote(index)) {
-            fifthYOffset = NoteListConstant::lastPinnedToUnpinnedHeader;
-        }
-        int yOffsets = fourthYOffset + fifthYOffset;
+NoteListDelegateEditor::~NoteListDelegateEditor()
+{
+    m_view->unsetEditorWidget(m_id, nullptr);
+}
 
-        y += yOffsets;
-        m_tagListView->setGeometry(10, y - 5, rect().width() - 24, m_tagListView->height());
+/*!
+ * \brief NoteListDelegateEditor::setIndex
+ * Binds the editor to a row, used for new editors and for the ones NoteListDelegate
+ * takes back out of its pool
+ */
+void NoteListDelegateEditor::setIndex(const QStyleOptionViewItem &option, const QModelIndex &index)
+{
+    m_option = option;
+    m_id = index.data(NoteListModel::NoteID).toInt();
+    m_containsMouse = false;
+    {
+        // resetting the tag list scrolls it to the top, that isn't the note's position
+        QSignalBlocker blocker(m_tagListView->verticalScrollBar());
+        m_tagListModel->setModelData(index.data(NoteListModel::NoteTagsList).value<QSet<int>>());
     }
-    connect(m_tagListView->verticalScrollBar(), &QScrollBar::valueChanged, this, [this] {
-        auto idx = dynamic_cast<NoteListModel *>(m_view->model())->getNoteIndex(m_id);
-        dynamic_cast<NoteListModel *>(m_view->model())
-                ->setData(idx, getScrollBarPos(), NoteListModel::NoteTagListScrollbarPos);
-    });
+    updateTagListGeometry();
     QTimer::singleShot(0, this, [this] {
         auto idx = dynamic_cast<NoteListModel *>(m_view->model())->getNoteIndex(m_id);
-        setScrollBarPos(idx.data(NoteListModel::NoteTagListScrollbarPos).toInt());
+        if (idx.isValid()) {
+            setScrollBarPos(idx.data(NoteListModel::NoteTagListScrollbarPos).toInt());
+        }
     });
     m_view->setEditorWidget(m_id, this);
-    setMouseTracking(true);
-    setAcceptDrops(true);
 }
 
-NoteListDelegateEditor::~NoteListDelegateEditor()
+/*!
+ * \brief NoteListDelegateEditor::clearIndex
+ * Detaches a closed editor from its row before it goes back into the pool
+ */
+void NoteListDelegateEditor::clearIndex()
 {
-    m_view->unsetEditorWidget(m_id, nullptr);
+    m_view->unsetEditorWidget(m_id, this);
+    m_id = SpecialNodeID::InvalidNodeId;
+    m_containsMouse = false;
 }
 
 void NoteListDelegateEditor::paintBackground(QPainter *painter, const QStyleOptionViewItem &option,
@@ -284,8 +270,7 @@ void NoteListDelegateEditor::paintLabels(QPainter *painter, const QStyleOptionVi
     QFontMetrics fmParentName(titleFont);
     QRect fmRectParentName = fmParentName.boundingRect(parentName);
 
-    QString content{ index.data(NoteListModel::NoteContent).toString() };
-    content = NoteEditorLogic::getSecondLine(content);
+    QString content{ index.data(NoteListModel::NotePreview).toString() };
     QFontMetrics fmContent(m_contentFont);
     QRect fmRectContent = fmContent.boundingRect(content);
 
@@ -475,6 +460,11 @@ void NoteListDelegateEditor::paintEvent(QPaintEvent *event)
 void NoteListDelegateEditor::resizeEvent(QResizeEvent *event)
 {
     QWidget::resizeEvent(event);
+    updateTagListGeometry();
+}
+
+void NoteListDelegateEditor::updateTagListGeometry()
+{
     if (m_delegate->isInAllNotes()) {
         int y = 90;
         auto model = dynamic_cast<NoteListModel *>(m_view->model());
@@ -524,7 +514,6 @@ void NoteListDelegateEditor::resizeEvent(QResizeEvent *event)
         m_tagListView->setGeometry(NoteListConstant::leftOffsetX - 5, y + 1, rect().width() - 26,
                                    m_tagListView->height());
     }
-    recalculateSize();
 }
 
 void NoteListDelegateEditor::dragEnterEvent(QDragEnterEvent *event)
@@ -539,11 +528,7 @@ void NoteListDelegateEditor::dragLeaveEvent(QDragLeaveEvent *event)
     Q_UNUSED(event);
 }
 
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 void NoteListDelegateEditor::enterEvent(QEnterEvent *event)
-#else
-void NoteListDelegateEditor::enterEvent(QEvent *event)
-#endif
 {
     m_containsMouse = true;
     QWidget::enterEvent(event);
@@ -572,64 +557,6 @@ void NoteListDelegateEditor::setActive(bool isActive)
     m_isActive = isActive;
 }
 
-void NoteListDelegateEditor::recalculateSize()
-{
-    QSize result;
-    int rowHeight = 70;
-    result.setHeight(rowHeight);
-    if (m_delegate->isInAllNotes()) {
-        result.setHeight(result.height() + 20);
-    }
-    result.setHeight(result.height() + m_tagListView->height() + 2);
-    result.setWidth(rect().width());
-    auto model = dynamic_cast<NoteListModel *>(m_view->model());
-    if (model) {
-        auto m_index = model->getNoteIndex(m_id);
-        if (model->hasPinnedNote()
-            && (model->isFirstPinnedNote(m_index) || model->isFirstUnpinnedNote(m_index))) {
-            result.setHeight(result.height() + 25);
-        }
-        if (model->hasPinnedNote() && m_view->isPinnedNotesCollapsed()) {
-            auto isPinned = m_index.data(NoteListModel::NoteIsPinned).value<bool>();
-            if (isPinned) {
-                if (model->isFirstPinnedNote(m_index)) {
-                    result.setHeight(25);
-                } else {
-                    result.setHeight(0);
-                }
-            } /*else if (model->hasPinnedNote() && model->isFirstUnpinnedNote(m_index)) {
-                result.setHeight(result.height() + 25);
-            }*/
-        }
-        int secondYOffset = 0;
-        if (m_index.row() > 0) {
-            secondYOffset = NoteListConstant::nextNoteOffset;
-        }
-        int thirdYOffset = 0;
-        if (model && model->isFirstPinnedNote(m_index)) {
-            thirdYOffset = NoteListConstant::pinnedHeaderToNoteSpace;
-        }
-        int fourthYOffset = 0;
-        if (model && model->isFirstUnpinnedNote(m_index)) {
-            fourthYOffset = NoteListConstant::unpinnedHeaderToNoteSpace;
-        }
-
-        int fifthYOffset = 0;
-        if (model && model->hasPinnedNote() && !m_view->isPinnedNotesCollapsed()
-            && model->isFirstUnpinnedNote(m_index)) {
-            fifthYOffset = NoteListConstant::lastPinnedToUnpinnedHeader;
-        }
-
-        int yOffsets = secondYOffset + thirdYOffset + fourthYOffset + fifthYOffset;
-        if (m_delegate->isInAllNotes()) {
-            result.setHeight(result.height() - 2 + NoteListConstant::lastElSepSpace + yOffsets);
-        } else {
-            result.setHeight(result.height() - 10 + NoteListConstant::lastElSepSpace + yOffsets);
-        }
-        emit updateSizeHint(m_id, result, m_index);
-    }
-}
-
 void NoteListDelegateEditor::setScrollBarPos(int pos)
 {
     m_tagListView->verticalScrollBar()->setValue(pos);
@@ -38,9 +38,10 @@ public:
                                     TagPool *tagPool, QWidget *parent = nullptr);
     ~NoteListDelegateEditor();
 
+    void setIndex(const QStyleOptionViewItem &option, const QModelIndex &index);
+    void clearIndex();
     void setRowRightOffset(int rowRightOffset);
     void setActive(bool isActive);
-    void recalculateSize();
     void setScrollBarPos(int pos);
     int getScrollBarPos();
     bool underMouseC() const;
@@ -48,11 +49,9 @@ public:
 
 public slots:
     void setTheme(Theme::Value theme);
-signals:
-    void updateSizeHint(int id, const QSize &sz, const QModelIndex &index);
-    void nearDestroyed(int id, const QModelIndex &index);
 
 private:
+    void updateTagListGeometry();
     void paintBackground(QPainter *painter, const QStyleOptionViewItem &option,
                          const QModelIndex &index) const;
     void paintLabels(QPainter *painter, const QStyleOptionViewItem &option,
@@ -99,11 +98,7 @@ protected:
     virtual void resizeEvent(QResizeEvent *event) override;
     virtual void dragEnterEvent(QDragEnterEvent *event) override;
     virtual void dragLeaveEvent(QDragLeaveEvent *event) override;
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
     virtual void enterEvent(QEnterEvent *event) override;
-#else
-    virtual void enterEvent(QEvent *event) override;
-#endif
 
     virtual void leaveEvent(QEvent *event) override;
     virtual void dropEvent(QDropEvent *event) override;
@@ -1,8 +1,26 @@
 #include "notelistmodel.h"
 #include <QDebug>
 #include "nodepath.h"
+#include "increasingrun.h"
 #include <QTimer>
 #include <QMimeData>
+#include <QCoreApplication>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+/*!
+ * Whether a note would be painted the same in the list
+ */
+bool isSameListEntry(const NodeData &lhs, const NodeData &rhs)
+{
+    return lhs.fullTitle() == rhs.fullTitle() && lhs.preview() == rhs.preview()
+            && lhs.lastModificationdateTime() == rhs.lastModificationdateTime()
+            && lhs.deletionDateTime() == rhs.deletionDateTime() && lhs.tagIds() == rhs.tagIds()
+            && lhs.isPinnedNote() == rhs.isPinnedNote() && lhs.parentId() == rhs.parentId()
+            && lhs.parentName() == rhs.parentName();
+}
+} // namespace
 
 NoteListModel::NoteListModel(QObject *parent) : QAbstractListModel(parent) { }
 
@@ -14,6 +32,9 @@ QModelIndex NoteListModel::addNote(const NodeData &note)
         const int rowCnt = rowCount();
         beginInsertRows(QModelIndex(), rowCnt, rowCnt);
         m_noteList << note;
+        if (!m_rowById.contains(note.id())) {
+            m_rowById.insert(note.id(), rowCnt);
+        }
         endInsertRows();
         emit rowsInsertedC({ createIndex(rowCnt, 0) });
         emit rowCountChanged();
@@ -22,6 +43,7 @@ QModelIndex NoteListModel::addNote(const NodeData &note)
         const int rowCnt = m_pinnedList.size();
         beginInsertRows(QModelIndex(), rowCnt, rowCnt);
         m_pinnedList << note;
+        updateRowIndex(rowCnt, rowCount() - 1);
         endInsertRows();
         emit rowsInsertedC({ createIndex(rowCnt, 0) });
         emit rowCountChanged();
@@ -39,6 +61,7 @@ QModelIndex NoteListModel::insertNote(const NodeData &note, int row)
         }
         beginInsertRows(QModelIndex(), row, row);
         m_pinnedList.insert(row, note);
+        updateRowIndex(row, rowCount() - 1);
         endInsertRows();
         emit rowsInsertedC({ createIndex(row, 0) });
         emit rowCountChanged();
@@ -51,6 +74,7 @@ QModelIndex NoteListModel::insertNote(const NodeData &note, int row)
         }
         beginInsertRows(QModelIndex(), row, row);
         m_noteList.insert(row - m_pinnedList.size(), note);
+        updateRowIndex(row, rowCount() - 1);
         endInsertRows();
         emit rowsInsertedC({ createIndex(row, 0) });
         emit rowCountChanged();
@@ -71,43 +95,240 @@ const NodeData &NoteListModel::getNote(const QModelIndex &index) const
 
 QModelIndex NoteListModel::getNoteIndex(int id) const
 {
-    for (int i = 0; i < m_pinnedList.size(); ++i) {
-        if (m_pinnedList[i].id() == id) {
-            return createIndex(i, 0);
-        }
+    auto it = m_rowById.constFind(id);
+    if (it == m_rowById.constEnd()) {
+        return QModelIndex{};
     }
+    return createIndex(it.value(), 0);
+}
 
-    for (int i = 0; i < m_noteList.size(); ++i) {
-        if (m_noteList[i].id() == id) {
-            return createIndex(i + m_pinnedList.size(), 0);
+/*!
+ * \brief NoteListModel::rebuildRowIndex
+ * Maps every note id to its row for getNoteIndex(). Called when most rows change, after
+ * a reset, a sort or a pin; inserts, removes and moves use updateRowIndex instead.
+ */
+void NoteListModel::rebuildRowIndex()
+{
+    m_rowById.clear();
+    m_rowById.reserve(rowCount());
+    // walk backwards so that a duplicate id keeps its first row, as the old scan did
+    for (int i = m_noteList.size() - 1; i >= 0; --i) {
+        m_rowById.insert(m_noteList[i].id(), i + m_pinnedList.size());
+    }
+    for (int i = m_pinnedList.size() - 1; i >= 0; --i) {
+        m_rowById.insert(m_pinnedList[i].id(), i);
+    }
+}
+
+/*!
+ * \brief NoteListModel::updateRowIndex
+ * Remaps the ids of rows \a firstRow to \a lastRow only, for changes that leave the rows
+ * outside that span where they were. Removed ids must have been erased already.
+ */
+void NoteListModel::updateRowIndex(int firstRow, int lastRow)
+{
+    for (int row = firstRow; row <= lastRow; ++row) {
+        int id = getRef(row).id();
+        auto it = m_rowById.find(id);
+        // a duplicate id keeps its first row, as in rebuildRowIndex
+        if (it != m_rowById.end() && it.value() < row && getRef(it.value()).id() == id) {
+            continue;
         }
+        m_rowById.insert(id, row);
     }
-    return QModelIndex{};
 }
 
 void NoteListModel::setListNote(const QVector<NodeData> &notes, const ListViewInfo &inf)
 {
-    beginResetModel();
-    m_pinnedList.clear();
-    m_noteList.clear();
+    // a refresh or a cleared search of the same folder or tags mostly lists the same notes
+    bool isSameList = rowCount() > 0 && m_listViewInfo.isInTag == inf.isInTag
+            && m_listViewInfo.parentFolderId == inf.parentFolderId
+            && m_listViewInfo.currentTagList == inf.currentTagList;
     m_listViewInfo = inf;
+    QVector<NodeData> pinnedList;
+    QVector<NodeData> noteList;
     if ((!m_listViewInfo.isInTag)
         && (m_listViewInfo.parentFolderId != SpecialNodeID::TrashFolder)) {
         for (const auto &note : qAsConst(notes)) {
             if (note.isPinnedNote()) {
-                m_pinnedList.append(note);
+                pinnedList.append(note);
             } else {
-                m_noteList.append(note);
+                noteList.append(note);
             }
         }
     } else {
-        m_noteList = notes;
+        noteList = notes;
+    }
+    sortNotes(pinnedList, noteList);
+    if (!isSameList || !applyListDiff(pinnedList, noteList)) {
+        beginResetModel();
+        m_pinnedList = pinnedList;
+        m_noteList = noteList;
+        rebuildRowIndex();
+        endResetModel();
     }
-    sort(0, Qt::AscendingOrder);
-    endResetModel();
     emit rowCountChanged();
 }
 
+/*!
+ * \brief NoteListModel::applyListDiff
+ * Turns the current rows into the new list with row removes, moves and inserts and
+ * dataChanged for the notes that look different, so that the view keeps its selection,
+ * scroll position and editors.
+ * While the steps run every row lives in m_noteList: data() and getNoteIndex() are right
+ * for the rows as they are at each signal, but hasPinnedNote() is false and the pinned
+ * and notes headers are only back with the dataChanged at the end. Each step remaps the
+ * rows it shifts, so the number of steps is capped to keep that linear in the list size.
+ * \return false without touching the model if the lists are too different, the caller
+ * resets the model then
+ */
+bool NoteListModel::applyListDiff(const QVector<NodeData> &pinnedList,
+                                  const QVector<NodeData> &noteList)
+{
+    QVector<NodeData> newRows = pinnedList + noteList;
+    QHash<int, int> newRowById;
+    newRowById.reserve(newRows.size());
+    for (int i = 0; i < newRows.size(); ++i) {
+        if (newRowById.contains(newRows[i].id())) {
+            return false;
+        }
+        newRowById.insert(newRows[i].id(), i);
+    }
+    if (m_rowById.size() != rowCount()) {
+        // duplicate ids in the current list
+        return false;
+    }
+
+    // new row of every note that stays, in current row order
+    QVector<int> keptRanks;
+    keptRanks.reserve(rowCount());
+    for (int row = 0; row < rowCount(); ++row) {
+        auto it = newRowById.constFind(getRef(row).id());
+        if (it != newRowById.constEnd()) {
+            keptRanks.append(it.value());
+        }
+    }
+    if (keptRanks.size() * 2 < qMax(rowCount(), newRows.size())) {
+        return false;
+    }
+    // notes on the longest run that is already in the new order stay where they are
+    auto isInOrder = IncreasingRun::longest(keptRanks);
+    QSet<int> stayingIds;
+    for (int i = 0; i < keptRanks.size(); ++i) {
+        if (isInOrder[i]) {
+            stayingIds.insert(newRows[keptRanks[i]].id());
+        }
+    }
+    // every remove, move or insert remaps the rows it shifts, many of them cost more than
+    // a reset
+    static const int maxDiffSteps = 64;
+    int stepCount = keptRanks.size() - stayingIds.size();
+    for (int row = 0; row < rowCount() && stepCount <= maxDiffSteps; ++row) {
+        if (!newRowById.contains(getRef(row).id())
+            && (row == 0 || newRowById.contains(getRef(row - 1).id()))) {
+            ++stepCount;
+        }
+    }
+    for (int row = 0; row < newRows.size() && stepCount <= maxDiffSteps; ++row) {
+        if (!m_rowById.contains(newRows[row].id())
+            && (row == 0 || m_rowById.contains(newRows[row - 1].id()))) {
+            ++stepCount;
+        }
+    }
+    if (stepCount > maxDiffSteps) {
+        return false;
+    }
+
+    // work on one vector, rows map to it the same way, it is split again at the end
+    m_noteList = m_pinnedList + m_noteList;
+    m_pinnedList.clear();
+
+    for (int row = m_noteList.size() - 1; row >= 0; --row) {
+        if (newRowById.contains(m_noteList[row].id())) {
+            continue;
+        }
+        int last = row;
+        while (row > 0 && !newRowById.contains(m_noteList[row - 1].id())) {
+            --row;
+        }
+        beginRemoveRows(QModelIndex(), row, last);
+        for (int i = row; i <= last; ++i) {
+            m_rowById.remove(m_noteList[i].id());
+        }
+        m_noteList.remove(row, last - row + 1);
+        updateRowIndex(row, rowCount() - 1);
+        endRemoveRows();
+    }
+
+    int previousRow = -1;
+    for (const auto &note : qAsConst(newRows)) {
+        auto it = m_rowById.constFind(note.id());
+        if (it == m_rowById.constEnd()) {
+            // inserted below
+            continue;
+        }
+        int from = it.value();
+        if (stayingIds.contains(note.id())) {
+            previousRow = from;
+            continue;
+        }
+        // place it right behind the note that comes before it in the new list
+        int to = from < previousRow ? previousRow : previousRow + 1;
+        if (from != to) {
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), to > from ? to + 1 : to);
+            m_noteList.move(from, to);
+            updateRowIndex(qMin(from, to), qMax(from, to));
+            endMoveRows();
+        }
+        previousRow = to;
+    }
+
+    for (int row = 0; row < newRows.size(); ++row) {
+        if (row < m_noteList.size() && m_noteList[row].id() == newRows[row].id()) {
+            continue;
+        }
+        int last = row;
+        while (last + 1 < newRows.size() && !m_rowById.contains(newRows[last + 1].id())) {
+            ++last;
+        }
+        beginInsertRows(QModelIndex(), row, last);
+        m_noteList.insert(row, last - row + 1, NodeData());
+        std::copy(newRows.begin() + row, newRows.begin() + last + 1, m_noteList.begin() + row);
+        updateRowIndex(row, rowCount() - 1);
+        endInsertRows();
+        row = last;
+    }
+
+    QVector<int> changedRows;
+    for (int row = 0; row < newRows.size(); ++row) {
+        if (!isSameListEntry(m_noteList[row], newRows[row])) {
+            changedRows.append(row);
+        }
+    }
+    // same rows in the same order, the row index is already right
+    m_pinnedList = pinnedList;
+    m_noteList = noteList;
+
+    // the pinned and notes headers may have moved to other rows
+    changedRows.append(0);
+    if (!m_pinnedList.isEmpty() && !m_noteList.isEmpty()) {
+        changedRows.append(m_pinnedList.size());
+    }
+    std::sort(changedRows.begin(), changedRows.end());
+    for (int i = 0; i < changedRows.size();) {
+        int first = changedRows[i];
+        int last = first;
+        while (i < changedRows.size() && changedRows[i] <= last + 1) {
+            last = qMax(last, changedRows[i]);
+            ++i;
+        }
+        if (first < rowCount()) {
+            emit dataChanged(index(first), index(qMin(last, rowCount() - 1)));
+        }
+    }
+    return true;
+}
+
 void NoteListModel::removeNotes(const QModelIndexList &noteIndexes)
 {
     emit requestRemoveNotes(noteIndexes);
@@ -124,6 +345,7 @@ bool NoteListModel::moveRow(const QModelIndex &sourceParent, int sourceRow,
         if (beginMoveRows(sourceParent, sourceRow, sourceRow, destinationParent,
                           destinationChild)) {
             m_pinnedList.move(sourceRow, destinationChild);
+            updateRowIndex(qMin(sourceRow, destinationChild), qMax(sourceRow, destinationChild));
             endMoveRows();
             emit rowsAboutToBeMovedC({ createIndex(sourceRow, 0) });
             emit rowsMovedC({ createIndex(destinationChild, 0) });
@@ -137,6 +359,8 @@ bool NoteListModel::moveRow(const QModelIndex &sourceParent, int sourceRow,
         if (beginMoveRows(sourceParent, sourceRow, sourceRow, destinationParent,
                           destinationChild)) {
             m_noteList.move(sourceRow, destinationChild);
+            updateRowIndex(m_pinnedList.size() + qMin(sourceRow, destinationChild),
+                           m_pinnedList.size() + qMax(sourceRow, destinationChild));
             endMoveRows();
             emit rowsAboutToBeMovedC({ createIndex(sourceRow, 0) });
             emit rowsMovedC({ createIndex(destinationChild + 1, 0) });
@@ -152,6 +376,7 @@ void NoteListModel::clearNotes()
     beginResetModel();
     m_pinnedList.clear();
     m_noteList.clear();
+    m_rowById.clear();
     endResetModel();
     emit rowCountChanged();
 }
@@ -161,7 +386,7 @@ QVariant NoteListModel::data(const QModelIndex &index, int role) const
     if (index.row() < 0 || index.row() >= (m_noteList.count() + m_pinnedList.count())) {
         return QVariant();
     }
-    if (role < NoteID || role > NoteIsPinned) {
+    if (role < NoteID || role > NotePreview) {
         return QVariant();
     }
     const NodeData &note = getRef(index.row());
@@ -194,6 +419,12 @@ QVariant NoteListModel::data(const QModelIndex &index, int role) const
         return note.tagListScrollBarPos();
     } else if (role == NoteIsPinned) {
         return note.isPinnedNote();
+    } else if (role == NotePreview) {
+        if (note.preview().isEmpty()) {
+            // keeps the translation the editor used to provide for it
+            return QCoreApplication::translate("NoteEditorLogic", "No additional text");
+        }
+        return note.preview();
     }
 
     return QVariant();
@@ -208,6 +439,7 @@ bool NoteListModel::setData(const QModelIndex &index, const QVariant &value, int
     NodeData &note = getRef(index.row());
     if (role == NoteID) {
         note.setId(value.toInt());
+        rebuildRowIndex();
     } else if (role == NoteFullTitle) {
         note.setFullTitle(value.toString());
     } else if (role == NoteCreationDateTime) {
@@ -218,6 +450,9 @@ bool NoteListModel::setData(const QModelIndex &index, const QVariant &value, int
         note.setDeletionDateTime(value.toDateTime());
     } else if (role == NoteContent) {
         note.setContent(value.toString());
+        note.setIsContentLoaded(true);
+    } else if (role == NotePreview) {
+        note.setPreview(value.toString());
     } else if (role == NoteScrollbarPos) {
         note.setScrollBarPosition(value.toInt());
     } else if (role == NoteTagsList) {
@@ -256,13 +491,21 @@ void NoteListModel::sort(int column, Qt::SortOrder order)
 {
     Q_UNUSED(column)
     Q_UNUSED(order)
+    sortNotes(m_pinnedList, m_noteList);
+    rebuildRowIndex();
+
+    emit dataChanged(index(0), index(rowCount() - 1));
+}
+
+void NoteListModel::sortNotes(QVector<NodeData> &pinnedList, QVector<NodeData> &noteList) const
+{
     if (m_listViewInfo.parentFolderId == SpecialNodeID::TrashFolder) {
-        std::stable_sort(m_noteList.begin(), m_noteList.end(),
+        std::stable_sort(noteList.begin(), noteList.end(),
                          [](const NodeData &lhs, const NodeData &rhs) {
                              return lhs.deletionDateTime() > rhs.deletionDateTime();
                          });
     } else {
-        std::stable_sort(m_pinnedList.begin(), m_pinnedList.end(),
+        std::stable_sort(pinnedList.begin(), pinnedList.end(),
                          [this](const NodeData &lhs, const NodeData &rhs) {
                              if (isInAllNote()) {
                                  return lhs.relativePosAN() < rhs.relativePosAN();
@@ -271,13 +514,11 @@ void NoteListModel::sort(int column, Qt::SortOrder order)
                              }
                          });
 
-        std::stable_sort(m_noteList.begin(), m_noteList.end(),
+        std::stable_sort(noteList.begin(), noteList.end(),
                          [](const NodeData &lhs, const NodeData &rhs) {
                              return lhs.lastModificationdateTime() > rhs.lastModificationdateTime();
                          });
     }
-
-    emit dataChanged(index(0), index(rowCount() - 1));
 }
 
 void NoteListModel::setNoteData(const QModelIndex &index, const NodeData &note)
@@ -286,23 +527,32 @@ void NoteListModel::setNoteData(const QModelIndex &index, const NodeData &note)
         return;
     }
     auto row = index.row();
-    if (row < m_pinnedList.size()) {
-        m_pinnedList[row] = note;
-    } else {
-        row = row - m_pinnedList.size();
-        m_noteList[row] = note;
+    NodeData &current = getRef(row);
+    bool isIdChanged = current.id() != note.id();
+    bool keepContent = !isIdChanged && !note.isContentLoaded() && current.isContentLoaded();
+    QString content = current.content();
+    current = note;
+    if (keepContent) {
+        current.setContent(content);
+        current.setIsContentLoaded(true);
+    }
+    if (isIdChanged) {
+        rebuildRowIndex();
     }
     emit dataChanged(this->index(index.row()), this->index(index.row()));
 }
 
 void NoteListModel::updatePinnedRelativePosition()
 {
-    for (int i = 0; i < m_pinnedList.size(); ++i) {
-        if (!isInAllNote()) {
-            emit requestUpdatePinnedRelPos(m_pinnedList[i].id(), i);
-        } else {
-            emit requestUpdatePinnedRelPosAN(m_pinnedList[i].id(), i);
-        }
+    QVector<int> noteIds;
+    noteIds.reserve(m_pinnedList.size());
+    for (const auto &note : qAsConst(m_pinnedList)) {
+        noteIds.append(note.id());
+    }
+    if (!isInAllNote()) {
+        emit requestUpdatePinnedRelPos(noteIds);
+    } else {
+        emit requestUpdatePinnedRelPosAN(noteIds);
     }
 }
 
@@ -331,15 +581,27 @@ bool NoteListModel::removeRows(int row, int count, const QModelIndex &parent)
     if (row < 0 || (row + count) > (m_pinnedList.size() + m_noteList.size())) {
         return false;
     }
+    if (count <= 0) {
+        return false;
+    }
     beginRemoveRows(parent, row, row + count - 1);
     for (int r = row; r < row + count; ++r) {
-        if (r < m_pinnedList.size()) {
-            m_pinnedList.takeAt(r);
-        } else {
-            auto rr = r - m_pinnedList.size();
-            m_noteList.takeAt(rr);
+        auto it = m_rowById.find(getRef(r).id());
+        if (it != m_rowById.end() && it.value() == r) {
+            m_rowById.erase(it);
         }
     }
+    // the span may cover the end of the pinned notes and the start of the others
+    int pinnedCount = m_pinnedList.size();
+    int unpinnedFirst = qMax(row, pinnedCount);
+    if (row + count > unpinnedFirst) {
+        m_noteList.remove(unpinnedFirst - pinnedCount, row + count - unpinnedFirst);
+    }
+    if (row < pinnedCount) {
+        m_pinnedList.remove(row, qMin(row + count, pinnedCount) - row);
+    }
+    // the rows behind the span move up by count
+    updateRowIndex(row, rowCount() - 1);
     endRemoveRows();
     emit rowCountChanged();
     return true;
@@ -459,6 +721,7 @@ bool NoteListModel::dropMimeData(const QMimeData *mime, Qt::DropAction action, i
             m_noteList.insert(destinationChild, m_pinnedList.takeAt(index.row()));
         }
     }
+    rebuildRowIndex();
 
     endResetModel();
     QModelIndexList destinations;
@@ -514,17 +777,21 @@ void NoteListModel::setNotesIsPinned(const QModelIndexList &indexes, bool isPinn
     if (isPinned) {
         emit rowsAboutToBeMovedC(needMovingIndexes);
         beginResetModel();
-        for (const auto &id : qAsConst(needMovingIds)) {
-            auto index = getNoteIndex(id);
-            if (!index.isValid()) {
-                continue;
-            }
-            int sourceRow = index.row();
-            if (sourceRow < 0 || sourceRow >= rowCount()) {
-                continue;
+        // one pass over the list instead of a lookup and a takeAt() per note
+        QVector<NodeData> pinnedList;
+        QVector<NodeData> noteList;
+        noteList.reserve(m_noteList.size());
+        for (const auto &note : qAsConst(m_noteList)) {
+            if (needMovingIds.contains(note.id())) {
+                pinnedList.append(note);
+            } else {
+                noteList.append(note);
             }
-            m_pinnedList.prepend(m_noteList.takeAt(sourceRow - m_pinnedList.size()));
         }
+        pinnedList.append(m_pinnedList);
+        m_pinnedList = pinnedList;
+        m_noteList = noteList;
+        rebuildRowIndex();
         endResetModel();
         QModelIndexList destinations;
         for (const auto &id : needMovingIds) {
@@ -541,33 +808,32 @@ void NoteListModel::setNotesIsPinned(const QModelIndexList &indexes, bool isPinn
     } else {
         emit rowsAboutToBeMovedC(needMovingIndexes);
         beginResetModel();
-        for (const auto &id : qAsConst(needMovingIds)) {
-            auto index = getNoteIndex(id);
-            if (!index.isValid()) {
-                continue;
-            }
-            int destinationChild = 0;
-            if (m_listViewInfo.parentFolderId == SpecialNodeID::TrashFolder) {
-                auto lastMod = index.data(NoteDeletionDateTime).toDateTime();
-                for (destinationChild = 0; destinationChild < m_noteList.size();
-                     ++destinationChild) {
-                    const auto &note = m_noteList[destinationChild];
-                    if (note.deletionDateTime() <= lastMod) {
-                        break;
-                    }
-                }
+        QVector<NodeData> pinnedList;
+        QVector<NodeData> unpinnedNotes;
+        for (const auto &note : qAsConst(m_pinnedList)) {
+            if (needMovingIds.contains(note.id())) {
+                unpinnedNotes.append(note);
             } else {
-                auto lastMod = index.data(NoteLastModificationDateTime).toDateTime();
-                for (destinationChild = 0; destinationChild < m_noteList.size();
-                     ++destinationChild) {
-                    const auto &note = m_noteList[destinationChild];
-                    if (note.lastModificationdateTime() <= lastMod) {
-                        break;
-                    }
-                }
+                pinnedList.append(note);
             }
-            m_noteList.insert(destinationChild, m_pinnedList.takeAt(index.row()));
         }
+        // m_noteList is sorted newest first, merge the unpinned notes in ahead of notes
+        // with the same date
+        bool isInTrash = m_listViewInfo.parentFolderId == SpecialNodeID::TrashFolder;
+        auto isNewer = [isInTrash](const NodeData &lhs, const NodeData &rhs) {
+            if (isInTrash) {
+                return lhs.deletionDateTime() > rhs.deletionDateTime();
+            }
+            return lhs.lastModificationdateTime() > rhs.lastModificationdateTime();
+        };
+        std::stable_sort(unpinnedNotes.begin(), unpinnedNotes.end(), isNewer);
+        QVector<NodeData> noteList;
+        noteList.reserve(m_noteList.size() + unpinnedNotes.size());
+        std::merge(unpinnedNotes.begin(), unpinnedNotes.end(), m_noteList.begin(),
+                   m_noteList.end(), std::back_inserter(noteList), isNewer);
+        m_pinnedList = pinnedList;
+        m_noteList = noteList;
+        rebuildRowIndex();
         endResetModel();
         QModelIndexList destinations;
         for (const auto &id : needMovingIds) {
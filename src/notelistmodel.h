@@ -22,6 +22,7 @@ public:
         NoteParentName,
         NoteTagListScrollbarPos,
         NoteIsPinned,
+        NotePreview,
     };
 
     explicit NoteListModel(QObject *parent = nullptr);
@@ -62,8 +63,13 @@ public:
 private:
     QVector<NodeData> m_noteList;
     QVector<NodeData> m_pinnedList;
+    QHash<int, int> m_rowById;
     ListViewInfo m_listViewInfo;
     void updatePinnedRelativePosition();
+    void rebuildRowIndex();
+    void updateRowIndex(int firstRow, int lastRow);
+    void sortNotes(QVector<NodeData> &pinnedList, QVector<NodeData> &noteList) const;
+    bool applyListDiff(const QVector<NodeData> &pinnedList, const QVector<NodeData> &noteList);
     bool isInAllNote() const;
     NodeData &getRef(int row);
     const NodeData &getRef(int row) const;
@@ -71,8 +77,8 @@ private:
 signals:
     void rowCountChanged();
     void requestUpdatePinned(int noteId, bool isPinned);
-    void requestUpdatePinnedRelPos(int noteId, int pos);
-    void requestUpdatePinnedRelPosAN(int noteId, int pos);
+    void requestUpdatePinnedRelPos(const QVector<int> &noteIds);
+    void requestUpdatePinnedRelPosAN(const QVector<int> &noteIds);
     void requestRemoveNotes(QModelIndexList index);
     void rowsInsertedC(const QModelIndexList &rows);
     void rowsAboutToBeMovedC(const QModelIndexList &source);
@@ -15,6 +15,9 @@
 #include <QMimeData>
 #include <QWindow>
 #include <QMetaObject>
+#include <QPointer>
+#include <algorithm>
+#include <functional>
 #include "tagpool.h"
 #include "notelistmodel.h"
 #include "nodepath.h"
@@ -39,6 +42,8 @@ NoteListView::NoteListView(QWidget *parent)
       m_isDraggingInsidePinned{ false }
 {
     setAttribute(Qt::WA_MacShowFocusRect, false);
+    // the height of tagged rows depends on how their tag chips wrap
+    setResizeMode(QListView::Adjust);
 
     setupStyleSheet();
 
@@ -88,6 +93,10 @@ NoteListView::~NoteListView()
 {
     // Make sure any editors are closed before the view is destroyed
     closeAllEditor();
+    NoteListDelegate *delegate = dynamic_cast<NoteListDelegate *>(itemDelegate());
+    if (delegate) {
+        delegate->clearEditorPool();
+    }
 }
 
 void NoteListView::animateAddedRow(const QModelIndexList &indexes)
@@ -164,9 +173,11 @@ void NoteListView::openPersistentEditorC(const QModelIndex &index)
 {
     if (index.isValid()) {
         auto isHaveTag = dynamic_cast<NoteListModel *>(model())->noteIsHaveTag(index);
-        if (isHaveTag) {
+        // every other tagged row is painted by the delegate
+        if (isHaveTag && isEditorRow(index)) {
             auto id = index.data(NoteListModel::NoteID).toInt();
             m_openedEditor[id] = {};
+            m_openedEditorIndexes[id] = index;
             openPersistentEditor(index);
         }
     }
@@ -178,6 +189,7 @@ void NoteListView::closePersistentEditorC(const QModelIndex &index)
         auto id = index.data(NoteListModel::NoteID).toInt();
         closePersistentEditor(index);
         m_openedEditor.remove(id);
+        m_openedEditorIndexes.remove(id);
     }
 }
 
@@ -199,11 +211,137 @@ void NoteListView::unsetEditorWidget(int noteId, QWidget *w)
 
 void NoteListView::closeAllEditor()
 {
-    for (const auto &id : m_openedEditor.keys()) {
-        auto index = dynamic_cast<NoteListModel *>(model())->getNoteIndex(id);
-        closePersistentEditor(index);
+    for (const auto &index : qAsConst(m_openedEditorIndexes)) {
+        if (index.isValid()) {
+            closePersistentEditor(index);
+        }
     }
     m_openedEditor.clear();
+    m_openedEditorIndexes.clear();
+}
+
+/*!
+ * \brief NoteListView::visibleRowRange
+ * First and last row at least partly inside the viewport, last is below first when
+ * the list is empty
+ */
+QPair<int, int> NoteListView::visibleRowRange() const
+{
+    if (!model() || model()->rowCount() == 0) {
+        return qMakePair(0, -1);
+    }
+    QModelIndex first = indexAt(QPoint(0, 0));
+    QModelIndex last = indexAt(QPoint(0, viewport()->height() - 1));
+    return qMakePair(first.isValid() ? first.row() : 0,
+                     last.isValid() ? last.row() : model()->rowCount() - 1);
+}
+
+/*!
+ * \brief NoteListView::isEditorRow
+ * Only the hovered row, the current row and selected rows on screen get an editor
+ * widget, a large selection doesn't keep widgets alive for rows nobody can see
+ */
+bool NoteListView::isEditorRow(const QModelIndex &index) const
+{
+    NoteListDelegate *delegate = dynamic_cast<NoteListDelegate *>(itemDelegate());
+    if (delegate && delegate->hoveredIndex().isValid()
+        && delegate->hoveredIndex().row() == index.row()) {
+        return true;
+    }
+    if (!selectionModel()) {
+        return false;
+    }
+    if (selectionModel()->currentIndex().row() == index.row()) {
+        return true;
+    }
+    auto visibleRows = visibleRowRange();
+    return index.row() >= visibleRows.first && index.row() <= visibleRows.second
+            && selectionModel()->isSelected(index);
+}
+
+/*!
+ * \brief NoteListView::updateEditors
+ * Closes the editors of rows that no longer qualify (see isEditorRow) and opens the
+ * ones that do. Only the few open editors and the rows on screen are looked at, never
+ * the whole selection.
+ */
+void NoteListView::updateEditors()
+{
+    auto m_listModel = dynamic_cast<NoteListModel *>(model());
+    if (!m_listModel) {
+        return;
+    }
+    for (auto it = m_openedEditorIndexes.begin(); it != m_openedEditorIndexes.end();) {
+        if (!it.value().isValid() || !isEditorRow(it.value())) {
+            if (it.value().isValid()) {
+                closePersistentEditor(it.value());
+            }
+            m_openedEditor.remove(it.key());
+            it = m_openedEditorIndexes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    QModelIndexList rows;
+    auto visibleRows = visibleRowRange();
+    for (int row = visibleRows.first; row <= visibleRows.second; ++row) {
+        QModelIndex index = m_listModel->index(row, 0);
+        if (selectionModel() && selectionModel()->isSelected(index)) {
+            rows.append(index);
+        }
+    }
+    if (selectionModel() && selectionModel()->currentIndex().isValid()) {
+        rows.append(selectionModel()->currentIndex());
+    }
+    NoteListDelegate *delegate = dynamic_cast<NoteListDelegate *>(itemDelegate());
+    if (delegate && delegate->hoveredIndex().isValid()
+        && delegate->hoveredIndex().row() < m_listModel->rowCount()) {
+        rows.append(m_listModel->index(delegate->hoveredIndex().row(), 0));
+    }
+    for (const auto &index : qAsConst(rows)) {
+        if (index.isValid()
+            && !m_openedEditor.contains(index.data(NoteListModel::NoteID).toInt())) {
+            openPersistentEditorC(index);
+        }
+    }
+}
+
+void NoteListView::setModel(QAbstractItemModel *model)
+{
+    if (this->model()) {
+        disconnect(this->model(), &QAbstractItemModel::dataChanged, this,
+                   &NoteListView::onModelDataChanged);
+        disconnect(this->model(), &QAbstractItemModel::modelReset, this,
+                   &NoteListView::onModelReset);
+    }
+    QListView::setModel(model);
+    onModelReset();
+    if (model) {
+        connect(model, &QAbstractItemModel::dataChanged, this, &NoteListView::onModelDataChanged);
+        connect(model, &QAbstractItemModel::modelReset, this, &NoteListView::onModelReset);
+    }
+}
+
+void NoteListView::onModelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                                      const QVector<int> &roles)
+{
+    NoteListDelegate *delegate = dynamic_cast<NoteListDelegate *>(itemDelegate());
+    if (delegate) {
+        delegate->invalidateRowPixmaps(topLeft, bottomRight);
+    }
+    // tag chips are painted in the row, so the row height follows its tag list
+    if (roles.isEmpty() || roles.contains(NoteListModel::NoteTagsList)) {
+        scheduleDelayedItemsLayout();
+    }
+}
+
+void NoteListView::onModelReset()
+{
+    // the same note ids may come back with different content
+    NoteListDelegate *delegate = dynamic_cast<NoteListDelegate *>(itemDelegate());
+    if (delegate) {
+        delegate->clearRowPixmapCache();
+    }
 }
 
 void NoteListView::setDbManager(DBManager *newDbManager)
@@ -369,6 +507,7 @@ bool NoteListView::viewportEvent(QEvent *e)
                     viewport()->update(visualRect(index));
                 }
             }
+            updateEditors();
             break;
         }
         default:
@@ -414,33 +553,12 @@ void NoteListView::dragMoveEvent(QDragMoveEvent *event)
 void NoteListView::scrollContentsBy(int dx, int dy)
 {
     QListView::scrollContentsBy(dx, dy);
-    auto m_listModel = dynamic_cast<NoteListModel *>(model());
-    if (!m_listModel) {
-        return;
-    }
-    for (int i = 0; i < m_listModel->rowCount(); ++i) {
-        auto index = m_listModel->index(i, 0);
-        if (index.isValid()) {
-            auto id = index.data(NoteListModel::NoteID).toInt();
-            if (m_openedEditor.contains(id)) {
-                auto y = visualRect(index).y();
-                auto range = abs(viewport()->height());
-                if ((y < -range) || (y > 2 * range)) {
-                    m_openedEditor.remove(id);
-                    closePersistentEditor(index);
-                }
-            } else {
-                auto y = visualRect(index).y();
-                auto range = abs(viewport()->height());
-                if (y < -range) {
-                    continue;
-                } else if (y > 2 * range) {
-                    break;
-                }
-                openPersistentEditorC(index);
-            }
-        }
+    // rows move under a still cursor, so the hovered row has to be looked up again
+    NoteListDelegate *delegate = dynamic_cast<NoteListDelegate *>(itemDelegate());
+    if (delegate && viewport()->underMouse()) {
+        delegate->setHoveredIndex(indexAt(viewport()->mapFromGlobal(QCursor::pos())));
     }
+    updateEditors();
 }
 
 void NoteListView::startDrag(Qt::DropActions supportedActions)
@@ -533,9 +651,7 @@ void NoteListView::startDrag(Qt::DropActions supportedActions)
         drag->deleteLater();
         mimeData->deleteLater();
     }
-#if QT_VERSION > QT_VERSION_CHECK(5, 15, 0)
     d->dropEventMoved = false;
-#endif
     m_isDragging = false;
     // Reset the drop indicator
     d->dropIndicatorRect = QRect();
@@ -602,6 +718,7 @@ void NoteListView::setupSignalsSlots()
             NoteListDelegate *delegate = dynamic_cast<NoteListDelegate *>(itemDelegate());
             if (delegate)
                 delegate->setHoveredIndex(index);
+            updateEditors();
         }
     });
 
@@ -611,6 +728,7 @@ void NoteListView::setupSignalsSlots()
             NoteListDelegate *delegate = dynamic_cast<NoteListDelegate *>(itemDelegate());
             if (delegate)
                 delegate->setHoveredIndex(QModelIndex());
+            updateEditors();
 
             QModelIndex lastIndex = model()->index(model()->rowCount() - 2, 0);
             viewport()->update(visualRect(lastIndex));
@@ -677,6 +795,7 @@ void NoteListView::selectionChanged(const QItemSelection &selected,
     for (const auto &index : selectedIndexes()) {
         ids.insert(index.data(NoteListModel::NoteID).toInt());
     }
+    updateEditors();
     emit saveSelectedNote(ids);
 }
 
@@ -829,27 +948,33 @@ void NoteListView::onCustomContextMenu(QPoint point)
                 delete action;
             }
             m_folderActions.clear();
-            auto m = contextMenu->addMenu("Move to");
-            FolderListType folders;
-            QMetaObject::invokeMethod(m_dbManager, "getFolderList", Qt::BlockingQueuedConnection,
-                                      Q_RETURN_ARG(FolderListType, folders));
-            for (const auto &id : folders.keys()) {
-                if (id == m_currentFolderId) {
-                    continue;
-                }
-                auto action = new QAction(folders[id], this);
-                connect(action, &QAction::triggered, this, [this, id] {
-                    auto indexes = selectedIndexes();
-                    for (const auto &selectedIndex : qAsConst(indexes)) {
-                        if (selectedIndex.isValid()) {
-                            emit moveNoteRequested(
-                                    selectedIndex.data(NoteListModel::NoteID).toInt(), id);
+            // the folder list arrives while the menu is already open
+            QPointer<QMenu> m = contextMenu->addMenu("Move to");
+            int currentFolderId = m_currentFolderId;
+            m_dbManager->requestFolderList().then(
+                    this, [this, m, currentFolderId](const FolderListType &folders) {
+                        if (!m) {
+                            return;
                         }
-                    }
-                });
-                m->addAction(action);
-                m_folderActions.append(action);
-            }
+                        for (const auto &id : folders.keys()) {
+                            if (id == currentFolderId) {
+                                continue;
+                            }
+                            auto action = new QAction(folders[id], this);
+                            connect(action, &QAction::triggered, this, [this, id] {
+                                auto indexes = selectedIndexes();
+                                for (const auto &selectedIndex : qAsConst(indexes)) {
+                                    if (selectedIndex.isValid()) {
+                                        emit moveNoteRequested(
+                                                selectedIndex.data(NoteListModel::NoteID).toInt(),
+                                                id);
+                                    }
+                                }
+                            });
+                            m->addAction(action);
+                            m_folderActions.append(action);
+                        }
+                    });
             contextMenu->addSeparator();
         }
         contextMenu->addAction(newNoteAction);
@@ -862,11 +987,26 @@ void NoteListView::onAnimationFinished(NoteListState state)
     if (state == NoteListState::Remove) {
         auto model = dynamic_cast<NoteListModel *>(this->model());
         if (model) {
+            QVector<int> rows;
+            rows.reserve(m_needRemovedNotes.size());
             for (const auto id : qAsConst(m_needRemovedNotes)) {
                 auto index = model->getNoteIndex(id);
-                model->removeRow(index.row());
+                if (index.isValid()) {
+                    rows.append(index.row());
+                }
             }
             m_needRemovedNotes.clear();
+            // one removeRows per run of adjacent rows, bottom up so the rows above stay put
+            std::sort(rows.begin(), rows.end(), std::greater<int>());
+            rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+            for (int i = 0; i < rows.size();) {
+                int last = rows[i];
+                int first = last;
+                while (++i < rows.size() && rows[i] == first - 1) {
+                    first = rows[i];
+                }
+                model->removeRows(first, last - first + 1, QModelIndex());
+            }
         }
     }
 }
@@ -877,19 +1017,8 @@ QPixmap NoteListViewPrivate::renderToPixmap(const QModelIndexList &indexes, QRec
     QItemViewPaintPairs paintPairs = draggablePaintPairs(indexes, r);
     if (paintPairs.isEmpty())
         return QPixmap();
-#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
-    qreal scale = 1.0f;
-    Q_Q(const QAbstractItemView);
-    QWidget *window = q->window();
-    if (window) {
-        QWindow *windowHandle = window->windowHandle();
-        if (windowHandle)
-            scale = windowHandle->devicePixelRatio();
-    }
-#else
     QWindow *window = windowHandle(WindowHandleMode::Closest);
     const qreal scale = window ? window->devicePixelRatio() : qreal(1);
-#endif
 
     QPixmap pixmap(r->size() * scale);
     pixmap.setDevicePixelRatio(scale);
@@ -901,13 +1030,9 @@ QPixmap NoteListViewPrivate::renderToPixmap(const QModelIndexList &indexes, QRec
     for (int j = 0; j < paintPairs.count(); ++j) {
         option.rect = paintPairs.at(j).rect.translated(-r->topLeft());
         const QModelIndex &current = paintPairs.at(j).index;
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
         Q_Q(const QAbstractItemView);
         adjustViewOptionsForIndex(&option, current);
         q->itemDelegateForIndex(current)->paint(&painter, option, current);
-#else
-        delegateForIndex(current)->paint(&painter, option, current);
-#endif
     }
     return pixmap;
 }
@@ -915,11 +1040,7 @@ QPixmap NoteListViewPrivate::renderToPixmap(const QModelIndexList &indexes, QRec
 QStyleOptionViewItem NoteListViewPrivate::viewOptionsV1() const
 {
     Q_Q(const NoteListView);
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
     QStyleOptionViewItem option;
     q->initViewItemOption(&option);
     return option;
-#else
-    return q->viewOptions();
-#endif
 }
@@ -32,6 +32,7 @@ public:
     void setEditorWidget(int noteId, QWidget *w);
     void unsetEditorWidget(int noteId, QWidget *w);
     void closeAllEditor();
+    void updateEditors();
     void setListViewInfo(const ListViewInfo &newListViewInfo);
     bool isDragging() const;
 
@@ -40,6 +41,7 @@ public:
     void setCurrentIndexC(const QModelIndex &index);
     QModelIndexList selectedIndex() const;
     bool isDraggingInsidePinned() const;
+    void setModel(QAbstractItemModel *model) override;
 
 public slots:
     void onCustomContextMenu(QPoint point);
@@ -66,6 +68,9 @@ public slots:
 
 private slots:
     void init();
+    void onModelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+                            const QVector<int> &roles);
+    void onModelReset();
 
 signals:
     void addTagRequested(const QModelIndex &index, int tadId);
@@ -102,6 +107,7 @@ private:
     QPoint m_dragStartPosition;
     QPixmap m_dragPixmap;
     QMap<int, QVector<QWidget *>> m_openedEditor;
+    QHash<int, QPersistentModelIndex> m_openedEditorIndexes;
     QVector<int> m_needRemovedNotes;
     ListViewInfo m_listViewInfo;
     bool m_isDragging;
@@ -110,6 +116,8 @@ private:
     bool m_isDraggingInsidePinned;
     void setupSignalsSlots();
     void setupStyleSheet();
+    QPair<int, int> visibleRowRange() const;
+    bool isEditorRow(const QModelIndex &index) const;
 
     void addNotesToTag(QSet<int> notesId, int tagId);
     void removeNotesFromTag(QSet<int> notesId, int tagId);
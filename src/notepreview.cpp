@@ -0,0 +1,45 @@
+#include "notepreview.h"
+#include <QTextDocument>
+#include <QTextStream>
+
+/*!
+ * \brief NotePreview::secondLine
+ * The preview line shown under the title in the note list: the first line after the title
+ * that isn't front matter or a code fence, as plain text.
+ * Safe to call from any thread, the database thread and the reader pool compute previews too
+ * \param content
+ * \return an empty, non-null string if there is no such line, the note list shows its
+ * placeholder in the current language instead. Non-null so the column isn't taken for a
+ * preview still to be backfilled
+ */
+QString NotePreview::secondLine(const QString &content)
+{
+    int previousLineBreakIndex = 0;
+    int lineCount = 0;
+    for (int i = 0; i < content.length(); i++) {
+        if (content[i] == '\n' || i == content.length() - 1) {
+            lineCount++;
+            if (lineCount > 1
+                && (i - previousLineBreakIndex > 1
+                    || (i == content.length() - 1 && content[i] != '\n'))) {
+                QString line = content.mid(previousLineBreakIndex + 1, i - previousLineBreakIndex);
+                line = line.trimmed();
+                if (!line.isEmpty() && !line.startsWith("{{") && !line.startsWith("---")
+                    && !line.startsWith("```")) {
+                    line.replace("<br />", "\n");
+                    QTextDocument doc;
+                    doc.setMarkdown(line);
+                    QString text = doc.toPlainText();
+                    if (text.length() > 1 && text.first(1) == "^") {
+                        text = text.mid(1);
+                    }
+                    QTextStream ts(&text);
+                    return ts.readLine(FIRST_LINE_MAX);
+                }
+            }
+            previousLineBreakIndex = i;
+        }
+    }
+
+    return QStringLiteral("");
+}
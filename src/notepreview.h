@@ -0,0 +1,15 @@
+#ifndef NOTEPREVIEW_H
+#define NOTEPREVIEW_H
+
+#include <QString>
+
+// longest title or preview line kept from a note
+#define FIRST_LINE_MAX 80
+
+class NotePreview
+{
+public:
+    static QString secondLine(const QString &content);
+};
+
+#endif // NOTEPREVIEW_H
@@ -0,0 +1,420 @@
+#include "plaintextexporter.h"
+#include "dbmanager.h"
+#include <QtConcurrent>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QRegularExpression>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+#include <algorithm>
+
+// Notes written per round on the thread pool, progress and cancellation are checked in between
+static const int exportBatchSize = 256;
+static const int maxFileNameLength = 120;
+static const char manifestFileName[] = ".plume-export.json";
+static const int manifestVersion = 1;
+
+PlainTextExporter::PlainTextExporter(DBManager *dbManager, QObject *parent)
+    : QObject(parent), m_dbManager{ dbManager }, m_isCanceled{ false }
+{
+}
+
+PlainTextExporter::~PlainTextExporter()
+{
+    cancel();
+    m_task.waitForFinished();
+}
+
+/*!
+ * \brief PlainTextExporter::exportNotes
+ * Export every note as a file with \a extension into a "Plume Notes" directory inside
+ * \a baseExportPath, mirroring the folder tree. In incremental mode the directory is
+ * reused and a manifest in it records what was written, so later runs only write new and
+ * modified notes, rename the files of moved ones and remove those of deleted and trashed ones.
+ */
+void PlainTextExporter::exportNotes(const QString &baseExportPath, const QString &extension,
+                                    Mode mode)
+{
+    if (isRunning()) {
+        qDebug() << __FUNCTION__ << __LINE__ << "an export is already running";
+        return;
+    }
+    m_isCanceled = false;
+    m_task = QtConcurrent::run([this, baseExportPath, extension, mode]() {
+        run(baseExportPath, extension, mode);
+    });
+}
+
+void PlainTextExporter::cancel()
+{
+    m_isCanceled = true;
+}
+
+bool PlainTextExporter::isRunning() const
+{
+    return m_task.isRunning();
+}
+
+/*!
+ * \brief PlainTextExporter::safeFileName
+ * Turn a note or folder title into a file name: first line only, common markdown
+ * markup dropped and characters that aren't allowed on Windows, macOS or Linux replaced
+ */
+QString PlainTextExporter::safeFileName(const QString &title)
+{
+    static const QRegularExpression heading(QStringLiteral(R"(^#{1,6}\s+)"));
+    static const QRegularExpression link(QStringLiteral(R"(\[([^\]]*)\]\([^)]*\))"));
+    static const QRegularExpression markup(QStringLiteral(R"(\*+|`+|~~)"));
+    static const QRegularExpression forbidden(QStringLiteral(R"([\/\\:*?"<>|\x00-\x1f])"));
+
+    QString name = title;
+    if (name.contains(QStringLiteral("<br />"))) {
+        name = name.section(QStringLiteral("<br />"), 0, 0, QString::SectionSkipEmpty);
+    }
+    name = name.section('\n', 0, 0, QString::SectionSkipEmpty).simplified();
+    name.remove(heading);
+    name.replace(link, QStringLiteral("\\1"));
+    name.remove(markup);
+    name.replace(forbidden, QStringLiteral("_"));
+    name.truncate(maxFileNameLength);
+    // trailing dots and spaces are stripped by Windows
+    while (name.endsWith('.') || name.endsWith(' ')) {
+        name.chop(1);
+    }
+    if (name.isEmpty()) {
+        name = QStringLiteral("Untitled Note");
+    }
+    return name;
+}
+
+/*!
+ * \brief PlainTextExporter::writeFile
+ * Runs on the thread pool. Content that hashes to what is already on disk isn't rewritten.
+ */
+PlainTextExporter::WriteResult PlainTextExporter::writeFile(const ExportFile &file)
+{
+    QByteArray data = file.content.toUtf8();
+    QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+    if (!file.existingHash.isEmpty() && file.existingHash == hash) {
+        return { true, hash };
+    }
+    QFile f(file.path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return { false, QByteArray() };
+    }
+    return { f.write(data) != -1, hash };
+}
+
+/*!
+ * \brief PlainTextExporter::isNumberedVariant
+ * Whether \a fileName is "name suffix" or one of its clash resolved forms "name N suffix"
+ */
+bool PlainTextExporter::isNumberedVariant(const QString &fileName, const QString &name,
+                                          const QString &suffix)
+{
+    if (fileName.compare(name + suffix, Qt::CaseInsensitive) == 0) {
+        return true;
+    }
+    if (!fileName.startsWith(name + ' ', Qt::CaseInsensitive)
+        || !fileName.endsWith(suffix, Qt::CaseInsensitive)) {
+        return false;
+    }
+    QStringView number = QStringView(fileName).mid(name.size() + 1,
+                                                   fileName.size() - name.size() - 1 - suffix.size());
+    bool isNumber = false;
+    number.toInt(&isNumber);
+    return isNumber;
+}
+
+PlainTextExporter::Manifest PlainTextExporter::readManifest(const QString &exportPath)
+{
+    Manifest manifest;
+    QFile file(exportPath + '/' + manifestFileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return manifest;
+    }
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.value(QStringLiteral("version")).toInt() != manifestVersion) {
+        qDebug() << __FUNCTION__ << __LINE__ << "ignoring manifest with unknown version";
+        return manifest;
+    }
+    const QJsonObject notes = root.value(QStringLiteral("notes")).toObject();
+    for (auto it = notes.constBegin(); it != notes.constEnd(); ++it) {
+        QJsonObject entry = it.value().toObject();
+        manifest.insert(it.key().toInt(),
+                        { entry.value(QStringLiteral("path")).toString(),
+                          entry.value(QStringLiteral("hash")).toString().toLatin1(),
+                          qint64(entry.value(QStringLiteral("modification_date")).toDouble()) });
+    }
+    return manifest;
+}
+
+bool PlainTextExporter::writeManifest(const QString &exportPath, const Manifest &manifest)
+{
+    QJsonObject notes;
+    for (auto it = manifest.constBegin(); it != manifest.constEnd(); ++it) {
+        QJsonObject entry;
+        entry.insert(QStringLiteral("path"), it.value().path);
+        entry.insert(QStringLiteral("hash"), QString::fromLatin1(it.value().hash));
+        entry.insert(QStringLiteral("modification_date"), double(it.value().modificationDate));
+        notes.insert(QString::number(it.key()), entry);
+    }
+    QJsonObject root;
+    root.insert(QStringLiteral("version"), manifestVersion);
+    root.insert(QStringLiteral("notes"), notes);
+
+    QSaveFile file(exportPath + '/' + manifestFileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+void PlainTextExporter::run(const QString &baseExportPath, const QString &extension, Mode mode)
+{
+    bool isIncremental = mode == Mode::Incremental;
+    QStringList failedFiles;
+    QString rootFolderName = QStringLiteral("Plume Notes");
+    QString exportPath = baseExportPath + '/' + rootFolderName;
+    int counter = 1;
+    while (!isIncremental && QDir(exportPath).exists()) {
+        exportPath = baseExportPath + '/' + rootFolderName + " " + QString::number(counter++);
+    }
+    exportPath = QDir::cleanPath(exportPath);
+    if (!QDir().mkpath(exportPath)) {
+        qDebug() << __FUNCTION__ << __LINE__ << "Failed to create" << exportPath;
+        emit finished(0, exportPath, { exportPath });
+        return;
+    }
+    QDir exportDir(exportPath);
+    Manifest previous = isIncremental ? readManifest(exportPath) : Manifest();
+
+    NoteExportSnapshot snapshot = m_dbManager->requestExportSnapshot().result();
+    if (isIncremental) {
+        // notes in the trash count as deleted. deletion_date isn't reset when a note is
+        // restored, so trash membership is what tells them apart.
+        snapshot.notes.erase(std::remove_if(snapshot.notes.begin(), snapshot.notes.end(),
+                                            [](const NodeData &note) {
+                                                return note.parentId()
+                                                        == SpecialNodeID::TrashFolder;
+                                            }),
+                             snapshot.notes.end());
+    }
+
+    // Name clashes between notes are resolved in memory. Keys are lower case for case
+    // insensitive file systems. A file on disk that the last run didn't write belongs to
+    // the user and is never overwritten, files from the manifest are ours to reuse.
+    QSet<QString> usedPaths;
+    QSet<QString> ownedPaths;
+    for (const auto &entry : qAsConst(previous)) {
+        ownedPaths.insert(QString(exportPath + '/' + entry.path).toLower());
+    }
+    auto isTaken = [&usedPaths, &ownedPaths](const QString &path, bool isDir) {
+        if (usedPaths.contains(path.toLower())) {
+            return true;
+        }
+        QFileInfo info(path);
+        if (!info.exists()) {
+            return false;
+        }
+        return isDir ? !info.isDir() : !ownedPaths.contains(path.toLower());
+    };
+    auto uniquePath = [&usedPaths, &isTaken](const QString &dir, const QString &name,
+                                             const QString &suffix) {
+        bool isDir = suffix.isEmpty();
+        QString path = dir + '/' + name + suffix;
+        int counter = 1;
+        while (isTaken(path, isDir)) {
+            path = dir + '/' + name + " " + QString::number(counter++) + suffix;
+        }
+        usedPaths.insert(path.toLower());
+        return path;
+    };
+
+    // Folders are ordered by absolute path, so a parent always comes before its children
+    QHash<int, QString> folderPaths;
+    folderPaths[SpecialNodeID::RootFolder] = exportPath;
+    for (const auto &folder : qAsConst(snapshot.folders)) {
+        if (folder.id() == SpecialNodeID::RootFolder) {
+            continue;
+        }
+        QStringList parts = folder.absolutePath().split(PATH_SEPARATOR, Qt::SkipEmptyParts);
+        if (isIncremental && parts.size() >= 2
+            && parts[1].toInt() == SpecialNodeID::TrashFolder) {
+            continue;
+        }
+        int parentId = parts.size() >= 2 ? parts[parts.size() - 2].toInt()
+                                         : int(SpecialNodeID::RootFolder);
+        folderPaths[folder.id()] = uniquePath(folderPaths.value(parentId, exportPath),
+                                              safeFileName(folder.fullTitle()), QString());
+    }
+
+    // Notes keep the file they had last time as long as it still fits their folder and
+    // title, so clash numbering doesn't shift around between runs
+    QVector<QString> notePaths(snapshot.notes.size());
+    for (int i = 0; i < snapshot.notes.size(); ++i) {
+        const NodeData &note = snapshot.notes[i];
+        auto entry = previous.constFind(note.id());
+        if (entry == previous.constEnd()) {
+            continue;
+        }
+        QString path = exportPath + '/' + entry->path;
+        QFileInfo info(path);
+        if (info.path() == folderPaths.value(note.parentId(), exportPath)
+            && isNumberedVariant(info.fileName(), safeFileName(note.fullTitle()), extension)
+            && !usedPaths.contains(path.toLower())) {
+            usedPaths.insert(path.toLower());
+            notePaths[i] = path;
+        }
+    }
+
+    Manifest manifest;
+    QStringList removedFiles;
+    QVector<ExportFile> changedFiles;
+    QVector<MovedFile> movedFiles;
+    QSet<int> exportedIds;
+    for (int i = 0; i < snapshot.notes.size(); ++i) {
+        const NodeData &note = snapshot.notes[i];
+        exportedIds.insert(note.id());
+        if (notePaths[i].isEmpty()) {
+            notePaths[i] = uniquePath(folderPaths.value(note.parentId(), exportPath),
+                                      safeFileName(note.fullTitle()), extension);
+        }
+        qint64 modificationDate = note.lastModificationDateTime().toMSecsSinceEpoch();
+        QString relativePath = exportDir.relativeFilePath(notePaths[i]);
+        auto entry = previous.constFind(note.id());
+        // a file removed or replaced by hand since the last run is written again
+        bool isOnDisk = entry != previous.constEnd() && entry->path == relativePath
+                && QFileInfo(notePaths[i]).isFile();
+        if (isOnDisk && entry->modificationDate == modificationDate) {
+            manifest.insert(note.id(), entry.value());
+            continue;
+        }
+        QByteArray existingHash;
+        if (isOnDisk) {
+            existingHash = entry->hash;
+        } else if (entry != previous.constEnd() && entry->path != relativePath) {
+            QString oldPath = exportPath + '/' + entry->path;
+            if (QFileInfo(oldPath).isFile()) {
+                movedFiles.append({ note.id(), oldPath, notePaths[i], QString(), entry->hash,
+                                    modificationDate,
+                                    entry->modificationDate == modificationDate });
+                continue;
+            }
+            removedFiles.append(oldPath);
+        }
+        // the body is loaded batch by batch when the file is written
+        changedFiles.append({ note.id(), notePaths[i], QString(), existingHash, modificationDate });
+    }
+    for (auto it = previous.constBegin(); it != previous.constEnd(); ++it) {
+        if (!exportedIds.contains(it.key())) {
+            removedFiles.append(exportPath + '/' + it.value().path);
+        }
+    }
+
+    // Moved files are parked under a temporary name first, so a note moving onto the old
+    // path of another one never finds it still taken. A file that can't be parked is
+    // removed and written again.
+    for (int i = movedFiles.size() - 1; i >= 0; --i) {
+        MovedFile &file = movedFiles[i];
+        file.tempPath = exportPath + QStringLiteral("/.plume-move-") + QString::number(file.noteId);
+        if (QFile::exists(file.tempPath) || !QFile::rename(file.fromPath, file.tempPath)) {
+            changedFiles.append(
+                    { file.noteId, file.toPath, QString(), QByteArray(), file.modificationDate });
+            movedFiles.remove(i);
+        }
+        // either way nothing is left at the old path, its directory may be empty now
+        removedFiles.append(file.fromPath);
+    }
+
+    // Remove stale files first, their paths may be taken over by other notes below, and
+    // drop directories that became empty on the way up
+    for (const auto &path : qAsConst(removedFiles)) {
+        if (QFile::exists(path) && !QFile::remove(path)) {
+            failedFiles.append(path);
+        }
+        QString dir = QFileInfo(path).path();
+        while (dir.size() > exportPath.size() && QDir().rmdir(dir)) {
+            dir = QFileInfo(dir).path();
+        }
+    }
+    for (const auto &path : qAsConst(folderPaths)) {
+        if (!QDir().mkpath(path)) {
+            failedFiles.append(path);
+        }
+    }
+
+    int exportedCount = 0;
+    for (const auto &file : qAsConst(movedFiles)) {
+        if (!QFile::rename(file.tempPath, file.toPath)) {
+            if (!QFile::remove(file.tempPath)) {
+                failedFiles.append(file.tempPath);
+            }
+            changedFiles.append(
+                    { file.noteId, file.toPath, QString(), QByteArray(), file.modificationDate });
+            continue;
+        }
+        if (file.isUnchanged) {
+            ++exportedCount;
+            manifest.insert(file.noteId, { exportDir.relativeFilePath(file.toPath), file.hash,
+                                           file.modificationDate });
+        } else {
+            // writeFile leaves the renamed file alone if the body still hashes the same
+            changedFiles.append(
+                    { file.noteId, file.toPath, QString(), file.hash, file.modificationDate });
+        }
+    }
+
+    const int changedCount = changedFiles.size();
+    int totalCount = exportedCount + changedCount;
+    emit progressChanged(exportedCount, totalCount);
+    for (int first = 0; first < changedCount && !m_isCanceled; first += exportBatchSize) {
+        QVector<ExportFile> batch = changedFiles.mid(first, exportBatchSize);
+        QVector<int> batchIds;
+        batchIds.reserve(batch.size());
+        for (const auto &file : qAsConst(batch)) {
+            batchIds.append(file.noteId);
+        }
+        QHash<int, QString> contents = m_dbManager->requestNoteContents(batchIds).result();
+        for (int i = batch.size() - 1; i >= 0; --i) {
+            auto content = contents.constFind(batch[i].noteId);
+            if (content != contents.constEnd()) {
+                batch[i].content = content.value();
+                continue;
+            }
+            // deleted after the snapshot, the next run removes whatever was written for it
+            if (previous.contains(batch[i].noteId)) {
+                manifest.insert(batch[i].noteId, previous.value(batch[i].noteId));
+            }
+            batch.remove(i);
+            --totalCount;
+        }
+        QVector<WriteResult> results =
+                QtConcurrent::blockingMapped<QVector<WriteResult>>(batch, &writeFile);
+        for (int i = 0; i < results.size(); ++i) {
+            if (!results[i].isOk) {
+                failedFiles.append(batch[i].path);
+                continue;
+            }
+            ++exportedCount;
+            manifest.insert(batch[i].noteId,
+                            { exportDir.relativeFilePath(batch[i].path), results[i].hash,
+                              batch[i].modificationDate });
+        }
+        emit progressChanged(exportedCount, totalCount);
+    }
+
+    // notes skipped by a cancel have no entry and are written on the next run
+    if (isIncremental && !writeManifest(exportPath, manifest)) {
+        failedFiles.append(exportPath + '/' + manifestFileName);
+    }
+
+    qDebug() << "Export completed to:" << exportPath;
+    emit finished(exportedCount, exportPath, failedFiles);
+}
@@ -0,0 +1,86 @@
+#ifndef PLAINTEXTEXPORTER_H
+#define PLAINTEXTEXPORTER_H
+
+#include <QObject>
+#include <QFuture>
+#include <QHash>
+#include <QStringList>
+#include <atomic>
+
+class DBManager;
+
+class PlainTextExporter : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Mode {
+        // write everything into a new "Plume Notes N" directory
+        Full,
+        // keep "Plume Notes" in sync, rewriting only what changed since the last run
+        Incremental
+    };
+
+    explicit PlainTextExporter(DBManager *dbManager, QObject *parent = nullptr);
+    ~PlainTextExporter();
+    void exportNotes(const QString &baseExportPath, const QString &extension,
+                     Mode mode = Mode::Full);
+    void cancel();
+    bool isRunning() const;
+    static QString safeFileName(const QString &title);
+
+signals:
+    void progressChanged(int exportedCount, int totalCount);
+    void finished(int exportedCount, const QString &exportPath, const QStringList &failedFiles);
+
+private:
+    struct ManifestEntry
+    {
+        // relative to the export directory, '/' separated
+        QString path;
+        QByteArray hash;
+        qint64 modificationDate;
+    };
+    using Manifest = QHash<int, ManifestEntry>;
+
+    struct ExportFile
+    {
+        int noteId;
+        QString path;
+        QString content;
+        // hash of what is already on disk at path, the write is skipped when it matches
+        QByteArray existingHash;
+        qint64 modificationDate;
+    };
+
+    // a note whose file from the last run is renamed to its new path instead of rewritten
+    struct MovedFile
+    {
+        int noteId;
+        QString fromPath;
+        QString toPath;
+        QString tempPath;
+        // of the file at fromPath, as recorded in the manifest
+        QByteArray hash;
+        qint64 modificationDate;
+        bool isUnchanged;
+    };
+
+    struct WriteResult
+    {
+        bool isOk;
+        QByteArray hash;
+    };
+
+    DBManager *m_dbManager;
+    QFuture<void> m_task;
+    std::atomic<bool> m_isCanceled;
+
+    void run(const QString &baseExportPath, const QString &extension, Mode mode);
+    static WriteResult writeFile(const ExportFile &file);
+    static bool isNumberedVariant(const QString &fileName, const QString &name,
+                                  const QString &suffix);
+    static Manifest readManifest(const QString &exportPath);
+    static bool writeManifest(const QString &exportPath, const Manifest &manifest);
+};
+
+#endif // PLAINTEXTEXPORTER_H
@@ -0,0 +1,182 @@
+#include "plaintextimporter.h"
+#include "dbmanager.h"
+#include <QtConcurrent>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QDebug>
+
+// Files read and committed together. One batch is being inserted on the database thread
+// while the next one is read, so at most two batches of note content are held at once.
+static const int importBatchSize = 256;
+
+PlainTextImporter::PlainTextImporter(DBManager *dbManager, QObject *parent)
+    : QObject(parent), m_dbManager{ dbManager }, m_isCanceled{ false }
+{
+}
+
+PlainTextImporter::~PlainTextImporter()
+{
+    cancel();
+    m_task.waitForFinished();
+}
+
+void PlainTextImporter::importFiles(const QStringList &files)
+{
+    start(files, QString());
+}
+
+/*!
+ * \brief PlainTextImporter::importDirectory
+ * Import every .txt/.md file below \a directory, recreating its sub directories as folders
+ */
+void PlainTextImporter::importDirectory(const QString &directory)
+{
+    start(QStringList(), directory);
+}
+
+void PlainTextImporter::cancel()
+{
+    m_isCanceled = true;
+}
+
+bool PlainTextImporter::isRunning() const
+{
+    return m_task.isRunning();
+}
+
+void PlainTextImporter::start(const QStringList &files, const QString &directory)
+{
+    if (isRunning()) {
+        qDebug() << __FUNCTION__ << __LINE__ << "an import is already running";
+        return;
+    }
+    m_isCanceled = false;
+    m_task = QtConcurrent::run([this, files, directory]() { run(files, directory); });
+}
+
+QVector<PlainTextImporter::ImportFile> PlainTextImporter::scanDirectory(const QString &directory)
+{
+    QVector<ImportFile> importFiles;
+    QDir root(directory);
+    QDirIterator it(directory, { QStringLiteral("*.txt"), QStringLiteral("*.md") }, QDir::Files,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString path = it.next();
+        QString folder = root.relativeFilePath(it.fileInfo().path());
+        if (folder == QStringLiteral(".")) {
+            folder.clear();
+        }
+        importFiles.append({ path, folder });
+    }
+    return importFiles;
+}
+
+/*!
+ * \brief PlainTextImporter::readNote
+ * Read and decode one file, runs on the global thread pool. The parent id is left unset.
+ * \return nothing if the file can't be opened
+ */
+std::optional<NodeData> PlainTextImporter::readNote(const ImportFile &file)
+{
+    QFile f(file.path);
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return std::nullopt;
+    }
+    NodeData note;
+    QString content = QString::fromUtf8(f.readAll());
+    QDateTime lastModified = QFileInfo(f).lastModified();
+    note.setNodeType(NodeData::Note);
+    note.setFullTitle(content.section('\n', 0, 0, QString::SectionSkipEmpty));
+    note.setContent(content);
+    note.setCreationDateTime(lastModified);
+    note.setLastModificationDateTime(lastModified);
+    return note;
+}
+
+void PlainTextImporter::run(const QStringList &files, const QString &directory)
+{
+    QVector<ImportFile> importFiles;
+    if (directory.isEmpty()) {
+        importFiles.reserve(files.size());
+        for (const auto &file : files) {
+            importFiles.append({ file, QString() });
+        }
+    } else {
+        importFiles = scanDirectory(directory);
+    }
+
+    QStringList failedFiles;
+    int totalCount = importFiles.size();
+    int importedCount = 0;
+    emit progressChanged(importedCount, totalCount);
+    if (totalCount == 0 || m_isCanceled) {
+        emit finished(importedCount, failedFiles);
+        return;
+    }
+
+    QSet<QString> folders;
+    for (const auto &file : qAsConst(importFiles)) {
+        if (!file.folder.isEmpty()) {
+            folders.insert(file.folder);
+        }
+    }
+    QString rootTitle = directory.isEmpty() ? QStringLiteral("Imported Notes")
+                                            : QDir(directory).dirName();
+    QHash<QString, int> folderIds =
+            m_dbManager->requestAddFolderTree(rootTitle, folders.values()).result();
+    if (!folderIds.contains(QString())) {
+        // the folders are added all or nothing, without them no file can be imported
+        for (const auto &file : qAsConst(importFiles)) {
+            failedFiles.append(file.path);
+        }
+        emit finished(importedCount, failedFiles);
+        return;
+    }
+
+    QFuture<QVector<int>> pendingBatch;
+    QStringList pendingPaths;
+    // a batch is inserted all or nothing, an empty result means every file in it failed
+    auto finishPendingBatch = [&]() {
+        if (pendingBatch.result().isEmpty()) {
+            failedFiles.append(pendingPaths);
+        } else {
+            importedCount += pendingPaths.size();
+        }
+        emit progressChanged(importedCount, totalCount);
+    };
+    for (int first = 0; first < totalCount && !m_isCanceled; first += importBatchSize) {
+        QVector<ImportFile> batchFiles = importFiles.mid(first, importBatchSize);
+        QVector<std::optional<NodeData>> batch =
+                QtConcurrent::blockingMapped<QVector<std::optional<NodeData>>>(batchFiles,
+                                                                               &readNote);
+
+        QVector<NodeData> notes;
+        QStringList notePaths;
+        notes.reserve(batch.size());
+        for (int i = 0; i < batch.size(); ++i) {
+            if (!batch[i]) {
+                failedFiles.append(batchFiles[i].path);
+                continue;
+            }
+            batch[i]->setParentId(
+                    folderIds.value(batchFiles[i].folder, folderIds.value(QString())));
+            notes.append(std::move(*batch[i]));
+            notePaths.append(batchFiles[i].path);
+        }
+
+        if (pendingBatch.isValid()) {
+            finishPendingBatch();
+        }
+        pendingPaths = notePaths;
+        pendingBatch = m_dbManager->requestAddNodesBulk(notes);
+    }
+    if (pendingBatch.isValid()) {
+        finishPendingBatch();
+    }
+
+    QMetaObject::invokeMethod(m_dbManager, "onNodeTagTreeRequested", Qt::QueuedConnection);
+    emit finished(importedCount, failedFiles);
+}
@@ -0,0 +1,45 @@
+#ifndef PLAINTEXTIMPORTER_H
+#define PLAINTEXTIMPORTER_H
+
+#include <QObject>
+#include <QFuture>
+#include <QStringList>
+#include <atomic>
+#include <optional>
+#include "nodedata.h"
+
+class DBManager;
+
+class PlainTextImporter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PlainTextImporter(DBManager *dbManager, QObject *parent = nullptr);
+    ~PlainTextImporter();
+    void importFiles(const QStringList &files);
+    void importDirectory(const QString &directory);
+    void cancel();
+    bool isRunning() const;
+
+signals:
+    void progressChanged(int importedCount, int totalCount);
+    void finished(int importedCount, const QStringList &failedFiles);
+
+private:
+    struct ImportFile
+    {
+        QString path;
+        QString folder;
+    };
+
+    DBManager *m_dbManager;
+    QFuture<void> m_task;
+    std::atomic<bool> m_isCanceled;
+
+    void start(const QStringList &files, const QString &directory);
+    void run(const QStringList &files, const QString &directory);
+    static QVector<ImportFile> scanDirectory(const QString &directory);
+    static std::optional<NodeData> readNote(const ImportFile &file);
+};
+
+#endif // PLAINTEXTIMPORTER_H
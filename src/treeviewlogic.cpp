@@ -65,9 +65,9 @@ TreeViewLogic::TreeViewLogic(NodeTreeView *treeView, NodeTreeModel *treeModel, D
     connect(m_treeModel, &NodeTreeModel::requestMoveNode, this,
             &TreeViewLogic::onMoveNodeRequested);
     connect(m_treeModel, &NodeTreeModel::requestUpdateNodeRelativePosition, m_dbManager,
-            &DBManager::updateRelPosNode, Qt::QueuedConnection);
+            &DBManager::updateRelPosNodes, Qt::QueuedConnection);
     connect(m_treeModel, &NodeTreeModel::requestUpdateTagRelativePosition, m_dbManager,
-            &DBManager::updateRelPosTag, Qt::QueuedConnection);
+            &DBManager::updateRelPosTags, Qt::QueuedConnection);
     connect(m_treeModel, &NodeTreeModel::dropFolderSuccessful, m_treeView,
             &NodeTreeView::onFolderDropSuccessful);
     connect(m_treeModel, &NodeTreeModel::dropTagsSuccessful, m_treeView,
@@ -91,25 +91,10 @@ void TreeViewLogic::updateTreeViewSeparator()
 void TreeViewLogic::loadTreeModel(const NodeTagTreeData &treeData)
 {
     m_treeModel->setTreeData(treeData);
-    {
-        NodeData node;
-        QMetaObject::invokeMethod(m_dbManager, "getChildNotesCountFolder",
-                                  Qt::BlockingQueuedConnection, Q_RETURN_ARG(NodeData, node),
-                                  Q_ARG(int, SpecialNodeID::RootFolder));
-        auto index = m_treeModel->getAllNotesButtonIndex();
-        if (index.isValid()) {
-            m_treeModel->setData(index, node.childNotesCount(), NodeItem::Roles::ChildCount);
-        }
-    }
-    {
-        NodeData node;
-        QMetaObject::invokeMethod(m_dbManager, "getChildNotesCountFolder",
-                                  Qt::BlockingQueuedConnection, Q_RETURN_ARG(NodeData, node),
-                                  Q_ARG(int, SpecialNodeID::TrashFolder));
-        auto index = m_treeModel->getTrashButtonIndex();
-        if (index.isValid()) {
-            m_treeModel->setData(index, node.childNotesCount(), NodeItem::Roles::ChildCount);
-        }
+    for (int folderId : { SpecialNodeID::RootFolder, SpecialNodeID::TrashFolder }) {
+        m_dbManager->requestChildNotesCountFolder(folderId).then(this, [this](const NodeData &node) {
+            onChildNoteCountChangedFolder(node.id(), node.absolutePath(), node.childNotesCount());
+        });
     }
     if (m_needLoadSavedState) {
         m_needLoadSavedState = false;
@@ -182,7 +167,6 @@ void TreeViewLogic::onAddFolderRequested(bool fromPlusButton)
         }
         currentIndex = m_treeModel->rootIndex();
     }
-    int newlyCreatedNodeId;
     NodeData newFolder;
     newFolder.setNodeType(NodeData::Folder);
     QDateTime noteDate = QDateTime::currentDateTime();
@@ -195,49 +179,59 @@ void TreeViewLogic::onAddFolderRequested(bool fromPlusButton)
     }
     newFolder.setParentId(parentId);
 
-    QMetaObject::invokeMethod(m_dbManager, "addNode", Qt::BlockingQueuedConnection,
-                              Q_RETURN_ARG(int, newlyCreatedNodeId), Q_ARG(NodeData, newFolder));
-
-    QHash<NodeItem::Roles, QVariant> hs;
-    hs[NodeItem::Roles::ItemType] = NodeItem::Type::FolderItem;
-    hs[NodeItem::Roles::DisplayText] = newFolder.fullTitle();
-    hs[NodeItem::Roles::NodeId] = newlyCreatedNodeId;
-
-    if (parentId != SpecialNodeID::RootFolder) {
-        hs[NodeItem::Roles::AbsPath] = currentIndex.data(NodeItem::Roles::AbsPath).toString()
-                + PATH_SEPARATOR + QString::number(newlyCreatedNodeId);
-        m_treeModel->appendChildNodeToParent(currentIndex, hs);
-        if (!m_treeView->isExpanded(currentIndex)) {
-            m_treeView->expand(currentIndex);
+    // the tree may change while the folder is being added, so keep a persistent index
+    QPersistentModelIndex parentIndex{ currentIndex };
+    m_dbManager->requestAddNode(newFolder).then(this, [=](int newlyCreatedNodeId) {
+        if (newlyCreatedNodeId == SpecialNodeID::InvalidNodeId) {
+            qDebug() << __FUNCTION__ << "Failed to add folder" << newFolder.fullTitle();
+            return;
         }
-    } else {
-        hs[NodeItem::Roles::AbsPath] = PATH_SEPARATOR + QString::number(SpecialNodeID::RootFolder)
-                + PATH_SEPARATOR + QString::number(newlyCreatedNodeId);
-        m_treeModel->appendChildNodeToParent(m_treeModel->rootIndex(), hs);
-    }
-    if (fromPlusButton) {
-        if (currentType == NodeItem::FolderItem) {
-            currentIndex = m_treeModel->folderIndexFromIdPath(currentAbsPath);
-        } else if (currentType == NodeItem::TagItem) {
-            currentIndex = m_treeModel->tagIndexFromId(currentTagId);
-        } else if (currentType == NodeItem::AllNoteButton) {
-            currentIndex = m_treeModel->getAllNotesButtonIndex();
-        } else if (currentType == NodeItem::TrashButton) {
-            currentIndex = m_treeModel->getTrashButtonIndex();
+        QHash<NodeItem::Roles, QVariant> hs;
+        hs[NodeItem::Roles::ItemType] = NodeItem::Type::FolderItem;
+        hs[NodeItem::Roles::DisplayText] = newFolder.fullTitle();
+        hs[NodeItem::Roles::NodeId] = newlyCreatedNodeId;
+
+        if (parentId != SpecialNodeID::RootFolder) {
+            if (!parentIndex.isValid()) {
+                qDebug() << __FUNCTION__ << "Parent folder" << parentId << "is no longer in the tree";
+                return;
+            }
+            hs[NodeItem::Roles::AbsPath] = parentIndex.data(NodeItem::Roles::AbsPath).toString()
+                    + PATH_SEPARATOR + QString::number(newlyCreatedNodeId);
+            m_treeModel->appendChildNodeToParent(parentIndex, hs);
+            if (!m_treeView->isExpanded(parentIndex)) {
+                m_treeView->expand(parentIndex);
+            }
         } else {
-            currentIndex = m_treeModel->getAllNotesButtonIndex();
+            hs[NodeItem::Roles::AbsPath] = PATH_SEPARATOR
+                    + QString::number(SpecialNodeID::RootFolder) + PATH_SEPARATOR
+                    + QString::number(newlyCreatedNodeId);
+            m_treeModel->appendChildNodeToParent(m_treeModel->rootIndex(), hs);
         }
-        m_treeView->setIgnoreThisCurrentLoad(true);
-        m_treeView->reExpandC();
-        m_treeView->setCurrentIndexC(currentIndex);
-        updateTreeViewSeparator();
-        m_treeView->setIgnoreThisCurrentLoad(false);
-    }
+        if (fromPlusButton) {
+            QModelIndex selectIndex;
+            if (currentType == NodeItem::FolderItem) {
+                selectIndex = m_treeModel->folderIndexFromIdPath(currentAbsPath);
+            } else if (currentType == NodeItem::TagItem) {
+                selectIndex = m_treeModel->tagIndexFromId(currentTagId);
+            } else if (currentType == NodeItem::AllNoteButton) {
+                selectIndex = m_treeModel->getAllNotesButtonIndex();
+            } else if (currentType == NodeItem::TrashButton) {
+                selectIndex = m_treeModel->getTrashButtonIndex();
+            } else {
+                selectIndex = m_treeModel->getAllNotesButtonIndex();
+            }
+            m_treeView->setIgnoreThisCurrentLoad(true);
+            m_treeView->reExpandC();
+            m_treeView->setCurrentIndexC(selectIndex);
+            updateTreeViewSeparator();
+            m_treeView->setIgnoreThisCurrentLoad(false);
+        }
+    });
 }
 
 void TreeViewLogic::onAddTagRequested()
 {
-    int newlyCreatedTagId;
     TagData newTag;
     newTag.setName(m_treeModel->getNewTagPlaceholderName());
     // random color generator
@@ -253,15 +247,14 @@ void TreeViewLogic::onAddTagRequested()
     auto color = QColor::fromHsv(h, s, v);
 
     newTag.setColor(color.name());
-    QMetaObject::invokeMethod(m_dbManager, "addTag", Qt::BlockingQueuedConnection,
-                              Q_RETURN_ARG(int, newlyCreatedTagId), Q_ARG(TagData, newTag));
-
-    QHash<NodeItem::Roles, QVariant> hs;
-    hs[NodeItem::Roles::ItemType] = NodeItem::Type::TagItem;
-    hs[NodeItem::Roles::DisplayText] = newTag.name();
-    hs[NodeItem::Roles::TagColor] = newTag.color();
-    hs[NodeItem::Roles::NodeId] = newlyCreatedTagId;
-    m_treeModel->appendChildNodeToParent(m_treeModel->rootIndex(), hs);
+    m_dbManager->requestAddTag(newTag).then(this, [this, newTag](int newlyCreatedTagId) {
+        QHash<NodeItem::Roles, QVariant> hs;
+        hs[NodeItem::Roles::ItemType] = NodeItem::Type::TagItem;
+        hs[NodeItem::Roles::DisplayText] = newTag.name();
+        hs[NodeItem::Roles::TagColor] = newTag.color();
+        hs[NodeItem::Roles::NodeId] = newlyCreatedTagId;
+        m_treeModel->appendChildNodeToParent(m_treeModel->rootIndex(), hs);
+    });
 }
 
 void TreeViewLogic::onRenameNodeRequestedFromTreeView(const QModelIndex &index,
@@ -283,20 +276,20 @@ void TreeViewLogic::onDeleteFolderRequested(const QModelIndex &index)
             qDebug() << __FUNCTION__ << "Failed while trying to delete folder with id" << id;
             return;
         }
-        NodeData node;
-        QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(NodeData, node), Q_ARG(int, id));
-        auto parentPath = NodePath{ node.absolutePath() }.parentPath();
-        auto parentIndex = m_treeModel->folderIndexFromIdPath(parentPath);
-        if (parentIndex.isValid()) {
-            m_treeModel->deleteRow(index, parentIndex);
-            QMetaObject::invokeMethod(m_dbManager, "moveFolderToTrash", Qt::QueuedConnection,
-                                      Q_ARG(NodeData, node));
-            m_treeView->setCurrentIndexC(m_treeModel->getAllNotesButtonIndex());
-        } else {
-            qDebug() << __FUNCTION__ << "Parent index with path" << parentPath.path()
-                     << "is not valid";
-        }
+        QPersistentModelIndex folderIndex{ index };
+        m_dbManager->requestNode(id).then(this, [this, folderIndex](const NodeData &node) {
+            auto parentPath = NodePath{ node.absolutePath() }.parentPath();
+            auto parentIndex = m_treeModel->folderIndexFromIdPath(parentPath);
+            if (parentIndex.isValid() && folderIndex.isValid()) {
+                m_treeModel->deleteRow(folderIndex, parentIndex);
+                QMetaObject::invokeMethod(m_dbManager, "moveFolderToTrash", Qt::QueuedConnection,
+                                          Q_ARG(NodeData, node));
+                m_treeView->setCurrentIndexC(m_treeModel->getAllNotesButtonIndex());
+            } else {
+                qDebug() << __FUNCTION__ << "Parent index with path" << parentPath.path()
+                         << "is not valid";
+            }
+        });
     } else {
         m_treeView->closePersistentEditor(m_treeModel->getTrashButtonIndex());
         m_treeView->update(m_treeModel->getTrashButtonIndex());
@@ -358,37 +351,35 @@ void TreeViewLogic::onChildNoteCountChangedFolder(int folderId, const QString &a
 
 void TreeViewLogic::openFolder(int id)
 {
-    NodeData target;
-    QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection,
-                              Q_RETURN_ARG(NodeData, target), Q_ARG(int, id));
-    if (target.nodeType() != NodeData::Folder) {
-        qDebug() << __FUNCTION__ << "Target is not folder!";
-        return;
-    }
-    if (target.id() == SpecialNodeID::TrashFolder) {
-        m_treeView->setCurrentIndexC(m_treeModel->getTrashButtonIndex());
-    } else if (target.id() == SpecialNodeID::RootFolder) {
-        m_treeView->setCurrentIndexC(m_treeModel->getAllNotesButtonIndex());
-    } else {
-        auto index = m_treeModel->folderIndexFromIdPath(target.absolutePath());
-        if (index.isValid()) {
-            m_treeView->setCurrentIndexC(index);
-        } else {
+    m_dbManager->requestNode(id).then(this, [this](const NodeData &target) {
+        if (target.nodeType() != NodeData::Folder) {
+            qDebug() << __FUNCTION__ << "Target is not folder!";
+            return;
+        }
+        if (target.id() == SpecialNodeID::TrashFolder) {
+            m_treeView->setCurrentIndexC(m_treeModel->getTrashButtonIndex());
+        } else if (target.id() == SpecialNodeID::RootFolder) {
             m_treeView->setCurrentIndexC(m_treeModel->getAllNotesButtonIndex());
+        } else {
+            auto index = m_treeModel->folderIndexFromIdPath(target.absolutePath());
+            if (index.isValid()) {
+                m_treeView->setCurrentIndexC(index);
+            } else {
+                m_treeView->setCurrentIndexC(m_treeModel->getAllNotesButtonIndex());
+            }
         }
-    }
+    });
 }
 
 void TreeViewLogic::onMoveNodeRequested(int nodeId, int targetId)
 {
-    NodeData target;
-    QMetaObject::invokeMethod(m_dbManager, "getNode", Qt::BlockingQueuedConnection,
-                              Q_RETURN_ARG(NodeData, target), Q_ARG(int, targetId));
-    if (target.nodeType() != NodeData::Folder) {
-        qDebug() << __FUNCTION__ << "Target is not folder!";
-        return;
-    }
-    emit requestMoveNodeInDB(nodeId, target);
+    m_dbManager->requestNode(targetId).then(this, [this, nodeId](const NodeData &target) {
+        if (target.nodeType() != NodeData::Folder) {
+            qDebug() << __FUNCTION__ << "Target is not folder!";
+            return;
+        }
+        emit requestMoveNodeInDB(nodeId, target);
+    });
 }
 
 void TreeViewLogic::setTheme(Theme::Value theme)
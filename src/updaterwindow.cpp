@@ -62,9 +62,6 @@ UpdaterWindow::UpdaterWindow(QWidget *parent)
 
     /* Initialize the UI */
     m_ui->setupUi(this);
-#if QT_VERSION < QT_VERSION_CHECK(5, 10, 0)
-    setWindowFlag(Qt::WindowContextHelpButtonHint, false);
-#endif
     setWindowTitle(qApp->applicationName() + " " + tr("Updater"));
 
     /* Change fonts */
@@ -556,11 +553,7 @@ void UpdaterWindow::mousePressEvent(QMouseEvent *event)
     if (event->button() == Qt::LeftButton) {
         if (event->x() < width() - 5 && event->x() > 5 && event->pos().y() < height() - 5
             && event->pos().y() > 5) {
-#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
             m_canMoveWindow = !window()->windowHandle()->startSystemMove();
-#else
-            m_canMoveWindow = true;
-#endif
             m_mousePressX = event->pos().x();
             m_mousePressY = event->pos().y();
         }
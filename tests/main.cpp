@@ -4,6 +4,7 @@
 #include "tst_notemodel.h"
 #include "tst_noteview.h"
 #include "tst_mainwindow.h"
+#include "tst_dbmanager.h"
 
 int main(int argc, char *argv[])
 {
@@ -12,5 +13,6 @@ int main(int argc, char *argv[])
     QTest::qExec(new tst_NoteModel, argc, argv);
     QTest::qExec(new tst_NoteView, argc, argv);
     QTest::qExec(new tst_MainWindow, argc, argv);
+    QTest::qExec(new tst_DBManager, argc, argv);
     return 0;
 }
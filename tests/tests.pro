@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += widgets testlib network
+QT       += widgets widgets-private testlib network sql concurrent qml
 
 TARGET    = test
 CONFIG   += testcase
@@ -17,18 +17,57 @@ LIBS += -lX11
 }
 
 DEPENDPATH += ../src/OBJ
+INCLUDEPATH += ../src
 
 HEADERS += \
     tst_mainwindow.h \
     tst_notedata.h \
     tst_notemodel.h \
-    tst_noteview.h
+    tst_noteview.h \
+    tst_dbmanager.h \
+    ../src/dbmanager.h \
+    ../src/nodedata.h \
+    ../src/tagdata.h \
+    ../src/nodepath.h \
+    ../src/notepreview.h \
+    ../src/increasingrun.h \
+    ../src/plaintextexporter.h \
+    ../src/plaintextimporter.h \
+    ../src/editorsettingsoptions.h \
+    ../src/lqtutils_enum.h \
+    ../src/notelistmodel.h \
+    ../src/notelistview.h \
+    ../src/notelistview_p.h \
+    ../src/notelistdelegate.h \
+    ../src/notelistdelegateeditor.h \
+    ../src/tagpool.h \
+    ../src/taglistmodel.h \
+    ../src/taglistview.h \
+    ../src/taglistdelegate.h
 
 SOURCES += \
     main.cpp \
     tst_notedata.cpp \
     tst_mainwindow.cpp \
     tst_notemodel.cpp \
-    tst_noteview.cpp
+    tst_noteview.cpp \
+    tst_dbmanager.cpp \
+    ../src/dbmanager.cpp \
+    ../src/nodedata.cpp \
+    ../src/tagdata.cpp \
+    ../src/nodepath.cpp \
+    ../src/notepreview.cpp \
+    ../src/increasingrun.cpp \
+    ../src/plaintextexporter.cpp \
+    ../src/plaintextimporter.cpp \
+    ../src/editorsettingsoptions.cpp \
+    ../src/notelistmodel.cpp \
+    ../src/notelistview.cpp \
+    ../src/notelistdelegate.cpp \
+    ../src/notelistdelegateeditor.cpp \
+    ../src/tagpool.cpp \
+    ../src/taglistmodel.cpp \
+    ../src/taglistview.cpp \
+    ../src/taglistdelegate.cpp
 
 DEFINES += SRCDIR=\\\"$$PWD\\\"
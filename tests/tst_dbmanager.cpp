@@ -0,0 +1,765 @@
+#include "tst_dbmanager.h"
+#include "../src/plaintextexporter.h"
+#include "../src/plaintextimporter.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+
+namespace {
+NodeData makeNode(NodeData::Type type, const QString &title, int parentId)
+{
+    NodeData node;
+    node.setNodeType(type);
+    node.setFullTitle(title);
+    if (type == NodeData::Note) {
+        node.setContent(title);
+    }
+    QDateTime now = QDateTime::currentDateTime();
+    node.setCreationDateTime(now);
+    node.setLastModificationDateTime(now);
+    node.setParentId(parentId);
+    return node;
+}
+} // namespace
+
+tst_DBManager::tst_DBManager()
+    : m_dbManager(nullptr), m_scratchCount(0), m_isOnScratchDatabase(false)
+{
+}
+
+void tst_DBManager::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_dbManager = new DBManager;
+    m_dbManager->onOpenDBManagerRequested(m_dir.filePath(QStringLiteral("notes.db")), true);
+}
+
+void tst_DBManager::cleanupTestCase()
+{
+    delete m_dbManager;
+    m_dbManager = nullptr;
+}
+
+void tst_DBManager::cleanup()
+{
+    if (!m_isOnScratchDatabase) {
+        return;
+    }
+    m_dbManager->setStorageSettings(StorageSettings::fromProfile(QStringLiteral("balanced")));
+    m_dbManager->onOpenDBManagerRequested(m_dir.filePath(QStringLiteral("notes.db")), false);
+    m_isOnScratchDatabase = false;
+}
+
+// Benchmarks write thousands of rows, they get a fresh database of their own so that the
+// shared one stays as the other tests expect it. cleanup() switches back.
+void tst_DBManager::openScratchDatabase()
+{
+    m_dbManager->onOpenDBManagerRequested(
+            m_dir.filePath(QStringLiteral("scratch_%1.db").arg(++m_scratchCount)), true);
+    m_isOnScratchDatabase = true;
+}
+
+// a folder with noteCount notes, every fourth one tagged
+int tst_DBManager::addListedFolder(int noteCount)
+{
+    int folderId = m_dbManager->addNode(
+            makeNode(NodeData::Folder, QStringLiteral("Listed"), SpecialNodeID::RootFolder));
+    QVector<NodeData> notes;
+    notes.reserve(noteCount);
+    for (int i = 0; i < noteCount; ++i) {
+        notes.append(makeNode(NodeData::Note, QStringLiteral("Listed %1").arg(i), folderId));
+    }
+    QVector<int> ids = m_dbManager->addNodesBulk(notes);
+    TagData tag;
+    tag.setName(QStringLiteral("Listed"));
+    tag.setColor(QStringLiteral("#0000ff"));
+    int tagId = m_dbManager->addTag(tag);
+    for (int i = 0; i < ids.size(); i += 4) {
+        m_dbManager->addNoteToTag(ids[i], tagId);
+    }
+    return folderId;
+}
+
+void tst_DBManager::queryPlanUsesIndex_data()
+{
+    // The statements DBManager runs per note, per folder or per tag, taken from DBManager
+    // itself. A full scan of any of these tables shows up as UI lag on large databases.
+    QTest::addColumn<QString>("statement");
+
+    // run the per-row paths once so that their statements are prepared and cached
+    int folderId = m_dbManager->addNode(
+            makeNode(NodeData::Folder, QStringLiteral("Planned"), SpecialNodeID::RootFolder));
+    NodeData note = makeNode(NodeData::Note, QStringLiteral("Planned"), folderId);
+    note.setId(m_dbManager->addNode(note));
+    TagData tag;
+    tag.setName(QStringLiteral("Planned"));
+    tag.setColor(QStringLiteral("#00ff00"));
+    int tagId = m_dbManager->addTag(tag);
+    m_dbManager->addNoteToTag(note.id(), tagId);
+    m_dbManager->removeNoteFromTag(note.id(), tagId);
+    m_dbManager->getNode(note.id());
+    m_dbManager->getNoteContent(note.id());
+    m_dbManager->getNodeAbsolutePath(note.id());
+    m_dbManager->onCreateUpdateRequestedNoteContent(note);
+    m_dbManager->renameNode(note.id(), QStringLiteral("Planned again"));
+    m_dbManager->setNoteIsPinned(note.id(), true);
+    m_dbManager->updateRelPosNodes({ folderId });
+    m_dbManager->updateRelPosTags({ tagId });
+    m_dbManager->moveNode(folderId, m_dbManager->getNode(SpecialNodeID::TrashFolder));
+    m_dbManager->removeTag(tagId);
+    m_dbManager->getChildNotesCountFolder(SpecialNodeID::DefaultNotesFolder);
+
+    const auto statements = m_dbManager->cachedStatements();
+    for (const auto &statement : statements) {
+        QTest::newRow(qPrintable(statement)) << statement;
+    }
+
+    QMap<QString, QVariant> bindValues;
+    const QMap<QString, QString> conditions = {
+        { QStringLiteral("all notes"),
+          DBManager::folderListCondition(SpecialNodeID::RootFolder, true, QString(),
+                                         bindValues) },
+        { QStringLiteral("folder"),
+          DBManager::folderListCondition(SpecialNodeID::DefaultNotesFolder, false, QString(),
+                                         bindValues) },
+        { QStringLiteral("folder recursive"),
+          DBManager::folderListCondition(SpecialNodeID::DefaultNotesFolder, true,
+                                         QStringLiteral("/0/2"), bindValues) },
+        { QStringLiteral("tags"), DBManager::tagListCondition({ 1, 2 }, bindValues) },
+    };
+    for (auto it = conditions.constBegin(); it != conditions.constEnd(); ++it) {
+        NoteListStatements list = DBManager::noteListStatements(it.value());
+        QTest::newRow(qPrintable(it.key() + QStringLiteral(" folders"))) << list.folders;
+        QTest::newRow(qPrintable(it.key() + QStringLiteral(" tags"))) << list.tags;
+        QTest::newRow(qPrintable(it.key() + QStringLiteral(" notes"))) << list.notes;
+    }
+}
+
+void tst_DBManager::queryPlanUsesIndex()
+{
+    QFETCH(QString, statement);
+
+    QSqlQuery query(QSqlDatabase::database(QStringLiteral("default_database")));
+    QVERIFY2(query.prepare(QStringLiteral("EXPLAIN QUERY PLAN ") + statement),
+             qPrintable(query.lastError().text()));
+    QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+    QStringList plan;
+    while (query.next()) {
+        plan.append(query.value(3).toString());
+    }
+    QVERIFY(!plan.isEmpty());
+    // "SCAN TABLE x" before SQLite 3.36, "SCAN x" since
+    static const QRegularExpression fullScan(
+            QStringLiteral("^SCAN (TABLE )?(node_table|tag_table|tag_relationship)\\b"));
+    for (const auto &step : qAsConst(plan)) {
+        QVERIFY2(!fullScan.match(step).hasMatch(), qPrintable(plan.join(QStringLiteral(" | "))));
+    }
+}
+
+void tst_DBManager::staleListRequestIsDropped()
+{
+    QSignalSpy spy(m_dbManager, &DBManager::notesListReceived);
+    quint64 first = m_dbManager->beginListRequest();
+    quint64 second = m_dbManager->beginListRequest();
+    QVERIFY(m_dbManager->isListRequestStale(first));
+    QVERIFY(!m_dbManager->isListRequestStale(second));
+
+    m_dbManager->onNotesListInFolderRequested(SpecialNodeID::RootFolder, true, false,
+                                              SpecialNodeID::InvalidNodeId, first);
+    QCOMPARE(spy.count(), 0);
+    m_dbManager->onNotesListInFolderRequested(SpecialNodeID::RootFolder, true, false,
+                                              SpecialNodeID::InvalidNodeId, second);
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(1).value<ListViewInfo>().requestId, second);
+}
+
+void tst_DBManager::listReadDoesNotWaitForWriter()
+{
+    QSignalSpy spy(m_dbManager, &DBManager::notesListReceived);
+    m_dbManager->onNotesListInFolderRequested(SpecialNodeID::DefaultNotesFolder, false);
+    QTRY_COMPARE(spy.count(), 1);
+    int notesBefore = spy.at(0).at(0).value<QVector<NodeData>>().size();
+
+    // an unfinished write on the writer connection, as during a long import
+    QSqlDatabase writer = QSqlDatabase::database(QStringLiteral("default_database"));
+    QVERIFY(writer.transaction());
+    QSqlQuery query(writer);
+    QVERIFY(query.exec(QStringLiteral("UPDATE node_table SET title = title WHERE id = %1;")
+                               .arg(SpecialNodeID::DefaultNotesFolder)));
+    m_dbManager->onNotesListInFolderRequested(SpecialNodeID::DefaultNotesFolder, false);
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(spy.at(1).at(0).value<QVector<NodeData>>().size(), notesBefore);
+    QVERIFY(writer.commit());
+}
+
+void tst_DBManager::childNotesCountFollowsNotes()
+{
+    auto countOf = [this](int folderId) {
+        return m_dbManager->getChildNotesCountFolder(folderId).childNotesCount();
+    };
+    int notesBefore = countOf(SpecialNodeID::DefaultNotesFolder);
+    int allBefore = countOf(SpecialNodeID::RootFolder);
+    int trashBefore = countOf(SpecialNodeID::TrashFolder);
+
+    NodeData note = makeNode(NodeData::Note, QStringLiteral("Counted"),
+                             SpecialNodeID::DefaultNotesFolder);
+    int noteId = m_dbManager->addNode(note);
+    QCOMPARE(countOf(SpecialNodeID::DefaultNotesFolder), notesBefore + 1);
+    QCOMPARE(countOf(SpecialNodeID::RootFolder), allBefore + 1);
+
+    QSignalSpy spy(m_dbManager, &DBManager::childNotesCountUpdatedFolder);
+    m_dbManager->moveNode(noteId, m_dbManager->getNode(SpecialNodeID::TrashFolder));
+    QCOMPARE(countOf(SpecialNodeID::DefaultNotesFolder), notesBefore);
+    QCOMPARE(countOf(SpecialNodeID::RootFolder), allBefore);
+    QCOMPARE(countOf(SpecialNodeID::TrashFolder), trashBefore + 1);
+    QCOMPARE(spy.count(), 3);
+
+    note.setId(noteId);
+    note.setParentId(SpecialNodeID::TrashFolder);
+    m_dbManager->removeNote(note);
+    QCOMPARE(countOf(SpecialNodeID::TrashFolder), trashBefore);
+}
+
+void tst_DBManager::moveFolderRewritesSubtree()
+{
+    auto addChild = [this](NodeData::Type type, int parentId) {
+        return m_dbManager->addNode(makeNode(type, QStringLiteral("Child"), parentId));
+    };
+    int outer = addChild(NodeData::Folder, SpecialNodeID::RootFolder);
+    int inner = addChild(NodeData::Folder, outer);
+    int note = addChild(NodeData::Note, inner);
+    int target = addChild(NodeData::Folder, SpecialNodeID::RootFolder);
+
+    m_dbManager->moveNode(outer, m_dbManager->getNode(target));
+    QString outerPath = m_dbManager->getNode(target).absolutePath() + PATH_SEPARATOR
+            + QString::number(outer);
+    QCOMPARE(m_dbManager->getNode(outer).absolutePath(), outerPath);
+    QCOMPARE(m_dbManager->getNode(inner).absolutePath(),
+             outerPath + PATH_SEPARATOR + QString::number(inner));
+    QCOMPARE(m_dbManager->getNode(note).absolutePath(),
+             outerPath + PATH_SEPARATOR + QString::number(inner) + PATH_SEPARATOR
+                     + QString::number(note));
+    QCOMPARE(m_dbManager->getNode(note).parentId(), inner);
+}
+
+void tst_DBManager::folderToTrashMovesNotesAndDropsFolders()
+{
+    auto addChild = [this](NodeData::Type type, int parentId) {
+        return m_dbManager->addNode(makeNode(type, QStringLiteral("Child"), parentId));
+    };
+    int outer = addChild(NodeData::Folder, SpecialNodeID::RootFolder);
+    int inner = addChild(NodeData::Folder, outer);
+    int outerNote = addChild(NodeData::Note, outer);
+    int innerNote = addChild(NodeData::Note, inner);
+
+    QSignalSpy spy(m_dbManager, &DBManager::childNotesCountUpdatedFolder);
+    m_dbManager->moveFolderToTrash(m_dbManager->getNode(outer));
+    auto folders = m_dbManager->getFolderList();
+    QVERIFY(!folders.contains(outer));
+    QVERIFY(!folders.contains(inner));
+    for (int noteId : { outerNote, innerNote }) {
+        auto note = m_dbManager->getNode(noteId);
+        QCOMPARE(note.parentId(), static_cast<int>(SpecialNodeID::TrashFolder));
+        QCOMPARE(note.absolutePath(),
+                 m_dbManager->getNode(SpecialNodeID::TrashFolder).absolutePath()
+                         + PATH_SEPARATOR + QString::number(noteId));
+    }
+    QCOMPARE(spy.count(), 2);
+}
+
+void tst_DBManager::reorderRewritesMovedRowsOnly()
+{
+    QHash<QString, int> folderIds = m_dbManager->addFolderTree(
+            QStringLiteral("Ordered"),
+            { QStringLiteral("a"), QStringLiteral("b"), QStringLiteral("c"), QStringLiteral("d") });
+    QVector<int> order;
+    for (const auto &dir : { "a", "b", "c", "d" }) {
+        order.append(folderIds.value(QString::fromLatin1(dir)));
+    }
+    auto positionsOf = [this](const QVector<int> &ids) {
+        QVector<int> positions;
+        for (const auto &id : ids) {
+            positions.append(m_dbManager->getNode(id).relativePosition());
+        }
+        return positions;
+    };
+    auto isIncreasing = [](const QVector<int> &positions) {
+        return std::is_sorted(positions.begin(), positions.end())
+                && std::adjacent_find(positions.begin(), positions.end()) == positions.end();
+    };
+
+    m_dbManager->updateRelPosNodes(order);
+    QVector<int> before = positionsOf(order);
+    QVERIFY(isIncreasing(before));
+
+    // move the last folder to the front
+    order.prepend(order.takeLast());
+    m_dbManager->updateRelPosNodes(order);
+    QVector<int> after = positionsOf(order);
+    QVERIFY(isIncreasing(after));
+    QCOMPARE(after.mid(1), before.mid(0, 3));
+}
+
+void tst_DBManager::idCounterIsPersistedWithInsert()
+{
+    auto storedNextNodeId = []() {
+        QSqlQuery query(QSqlDatabase::database(QStringLiteral("default_database")));
+        if (!query.exec(R"(SELECT "value" FROM metadata WHERE "key"='next_node_id';)")
+            || !query.next()) {
+            return -1;
+        }
+        return query.value(0).toInt();
+    };
+    int expectedId = m_dbManager->nextAvailableNodeId();
+    QCOMPARE(storedNextNodeId(), expectedId);
+
+    QCOMPARE(m_dbManager->addNode(makeNode(NodeData::Folder, QStringLiteral("Allocated"),
+                                           SpecialNodeID::RootFolder)),
+             expectedId);
+    QCOMPARE(m_dbManager->nextAvailableNodeId(), expectedId + 1);
+    QCOMPARE(storedNextNodeId(), expectedId + 1);
+}
+
+void tst_DBManager::apostropheRoundTripsOnEveryInsert()
+{
+    NodeData note = makeNode(NodeData::Note, QStringLiteral("It's here"),
+                             SpecialNodeID::DefaultNotesFolder);
+    note.setContent(QStringLiteral("It's here\nDon't 'quote' me"));
+    int savedId = m_dbManager->addNode(note);
+    QVector<int> importedIds = m_dbManager->addNodesBulk({ note });
+    QCOMPARE(importedIds.size(), 1);
+
+    // values are bound, both paths store the text as it was typed
+    for (int id : { savedId, importedIds.first() }) {
+        auto stored = m_dbManager->getNode(id);
+        QCOMPARE(stored.fullTitle(), note.fullTitle());
+        QCOMPARE(stored.content(), note.content());
+    }
+}
+
+void tst_DBManager::notePreviewFollowsContent()
+{
+    NodeData note = makeNode(NodeData::Note, QStringLiteral("Title"), 0);
+    note.setContent(QStringLiteral("Title\nSecond line"));
+    note.setPreview(QStringLiteral("Old line"));
+    // a loaded body wins over the preview it was edited from
+    QCOMPARE(DBManager::notePreview(note), QStringLiteral("Second line"));
+
+    // no second line is stored empty, the placeholder is only shown by the list
+    note.setContent(QStringLiteral("Title"));
+    QString preview = DBManager::notePreview(note);
+    QVERIFY(preview.isEmpty());
+    QVERIFY(!preview.isNull());
+
+    // notes read without their body keep the stored preview
+    note.setIsContentLoaded(false);
+    note.setPreview(QStringLiteral("Stored line"));
+    QCOMPARE(DBManager::notePreview(note), QStringLiteral("Stored line"));
+}
+
+void tst_DBManager::addFolderTreeCreatesParents()
+{
+    QHash<QString, int> folderIds = m_dbManager->addFolderTree(
+            QStringLiteral("Vault"), { QStringLiteral("a/b/c"), QStringLiteral("a/d") });
+    QCOMPARE(folderIds.size(), 5);
+    QVERIFY(folderIds.contains(QString()));
+    QCOMPARE(m_dbManager->getNode(folderIds.value(QString())).parentId(),
+             int(SpecialNodeID::RootFolder));
+    QCOMPARE(m_dbManager->getNode(folderIds.value(QStringLiteral("a"))).parentId(),
+             folderIds.value(QString()));
+    NodeData c = m_dbManager->getNode(folderIds.value(QStringLiteral("a/b/c")));
+    QCOMPARE(c.fullTitle(), QStringLiteral("c"));
+    QCOMPARE(c.parentId(), folderIds.value(QStringLiteral("a/b")));
+    QCOMPARE(m_dbManager->getNode(folderIds.value(QStringLiteral("a/d"))).parentId(),
+             folderIds.value(QStringLiteral("a")));
+}
+
+void tst_DBManager::importDirectoryRecreatesFolders()
+{
+    openScratchDatabase();
+    QDir importDir(m_dir.filePath(QStringLiteral("Vault")));
+    QVERIFY(importDir.mkpath(QStringLiteral("Inner/Deepest")));
+    auto writeFile = [&importDir](const QString &fileName, const QByteArray &content) {
+        QFile file(importDir.filePath(fileName));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(content);
+    };
+    writeFile(QStringLiteral("top.txt"), "Top\nbody");
+    writeFile(QStringLiteral("Inner/inner.md"), "Inner note");
+    writeFile(QStringLiteral("Inner/Deepest/deep.txt"), "Deep note");
+    writeFile(QStringLiteral("Inner/skipped.png"), "not a note");
+    int allBefore = m_dbManager->getChildNotesCountFolder(SpecialNodeID::RootFolder)
+                            .childNotesCount();
+
+    PlainTextImporter importer(m_dbManager);
+    QSignalSpy finishedSpy(&importer, &PlainTextImporter::finished);
+    // the importer writes through requests queued on this thread, QTRY keeps them running
+    importer.importDirectory(importDir.path());
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.at(0).at(0).toInt(), 3);
+    QVERIFY(finishedSpy.at(0).at(1).toStringList().isEmpty());
+
+    auto folders = m_dbManager->getFolderList();
+    auto folderNamed = [&folders](const QString &title) {
+        QList<int> ids = folders.keys(title);
+        return ids.size() == 1 ? ids.first() : int(SpecialNodeID::InvalidNodeId);
+    };
+    int vaultId = folderNamed(QStringLiteral("Vault"));
+    int innerId = folderNamed(QStringLiteral("Inner"));
+    int deepestId = folderNamed(QStringLiteral("Deepest"));
+    QVERIFY(vaultId > 0 && innerId > 0 && deepestId > 0);
+    QString vaultPath = m_dbManager->getNode(vaultId).absolutePath();
+    QCOMPARE(vaultPath,
+             m_dbManager->getNode(SpecialNodeID::RootFolder).absolutePath() + PATH_SEPARATOR
+                     + QString::number(vaultId));
+    QString innerPath = vaultPath + PATH_SEPARATOR + QString::number(innerId);
+    QCOMPARE(m_dbManager->getNode(innerId).absolutePath(), innerPath);
+    QCOMPARE(m_dbManager->getNode(deepestId).absolutePath(),
+             innerPath + PATH_SEPARATOR + QString::number(deepestId));
+
+    for (int folderId : { vaultId, innerId, deepestId }) {
+        QCOMPARE(m_dbManager->getChildNotesCountFolder(folderId).childNotesCount(), 1);
+    }
+    QCOMPARE(m_dbManager->getChildNotesCountFolder(SpecialNodeID::RootFolder).childNotesCount(),
+             allBefore + 3);
+}
+
+void tst_DBManager::backupWritesConsistentCopy()
+{
+    int noteId = m_dbManager->addNode(makeNode(NodeData::Note, QStringLiteral("Backed up"),
+                                               SpecialNodeID::DefaultNotesFolder));
+
+    QString fileName = m_dir.filePath(QStringLiteral("backup.nbk"));
+    QSignalSpy finishedSpy(m_dbManager, &DBManager::backupFinished);
+    m_dbManager->onExportNotesRequested(fileName);
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.at(0).at(1).toBool(), true);
+    QVERIFY(!QFile::exists(fileName + QStringLiteral(".part")));
+
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", QStringLiteral("tst_backup"));
+        db.setDatabaseName(fileName);
+        QVERIFY(db.open());
+        QSqlQuery query(db);
+        query.prepare(R"(SELECT "title" FROM node_table WHERE id = :id;)");
+        query.bindValue(QStringLiteral(":id"), noteId);
+        QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+        QVERIFY(query.next());
+        QCOMPARE(query.value(0).toString(), QStringLiteral("Backed up"));
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(QStringLiteral("tst_backup"));
+}
+
+void tst_DBManager::importDatabaseMergesIntoExisting()
+{
+    TagData tag;
+    tag.setName(QStringLiteral("Imported"));
+    tag.setColor(QStringLiteral("#ff0000"));
+    int tagId = m_dbManager->addTag(tag);
+    int noteId = m_dbManager->addNode(
+            makeNode(NodeData::Note, QStringLiteral("Tagged"), SpecialNodeID::DefaultNotesFolder));
+    m_dbManager->addNoteToTag(noteId, tagId);
+
+    auto count = [](const QString &statement) {
+        QSqlQuery query(QSqlDatabase::database(QStringLiteral("default_database")));
+        if (!query.exec(statement) || !query.next()) {
+            return -1;
+        }
+        return query.value(0).toInt();
+    };
+    int folders = count(QStringLiteral("SELECT count(*) FROM node_table WHERE node_type = 1;"));
+    int notes = count(QStringLiteral("SELECT count(*) FROM node_table WHERE node_type = 0;"));
+    int tags = count(QStringLiteral("SELECT count(*) FROM tag_table;"));
+
+    // importing a copy of the database into itself matches every folder and tag
+    QString fileName = m_dir.filePath(QStringLiteral("merge.nbk"));
+    QSignalSpy finishedSpy(m_dbManager, &DBManager::backupFinished);
+    m_dbManager->onExportNotesRequested(fileName);
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    m_dbManager->onImportNotesRequested(fileName);
+
+    QCOMPARE(count(QStringLiteral("SELECT count(*) FROM node_table WHERE node_type = 1;")),
+             folders);
+    QCOMPARE(count(QStringLiteral("SELECT count(*) FROM node_table WHERE node_type = 0;")),
+             notes * 2);
+    QCOMPARE(count(QStringLiteral("SELECT count(*) FROM tag_table;")), tags);
+    QCOMPARE(m_dbManager->getChildNotesCountFolder(SpecialNodeID::RootFolder).childNotesCount(),
+             count(QStringLiteral("SELECT count(*) FROM node_table "
+                                  "WHERE node_type = 0 AND parent_id != 1;")));
+    QCOMPARE(count(QStringLiteral("SELECT count(*) FROM tag_relationship WHERE tag_id = %1;")
+                           .arg(tagId)),
+             2);
+    QCOMPARE(count(QStringLiteral("SELECT value FROM metadata WHERE key = 'next_node_id';")),
+             count(QStringLiteral("SELECT max(id) + 1 FROM node_table;")));
+}
+
+void tst_DBManager::changeDatabasePathKeepsDatabaseOnFailure()
+{
+    openScratchDatabase();
+    QString oldPath = m_dir.filePath(QStringLiteral("scratch_%1.db").arg(m_scratchCount));
+    int noteId = m_dbManager->addNode(
+            makeNode(NodeData::Note, QStringLiteral("Moved"), SpecialNodeID::DefaultNotesFolder));
+
+    // an existing file is never replaced, the database stays open where it was
+    QString takenPath = m_dir.filePath(QStringLiteral("taken.db"));
+    {
+        QFile taken(takenPath);
+        QVERIFY(taken.open(QIODevice::WriteOnly));
+        taken.write("not a database");
+    }
+    QSignalSpy errorSpy(m_dbManager, &DBManager::showErrorMessage);
+    QVERIFY(!m_dbManager->onChangeDatabasePathRequested(takenPath));
+    QCOMPARE(errorSpy.count(), 1);
+    QVERIFY(QFile::exists(oldPath));
+    QCOMPARE(m_dbManager->getNode(noteId).fullTitle(), QStringLiteral("Moved"));
+
+    QString newPath = m_dir.filePath(QStringLiteral("moved.db"));
+    QVERIFY(m_dbManager->onChangeDatabasePathRequested(newPath));
+    QVERIFY(!QFile::exists(oldPath));
+    QVERIFY(!QFile::exists(oldPath + QStringLiteral("-wal")));
+    QCOMPARE(m_dbManager->getNode(noteId).fullTitle(), QStringLiteral("Moved"));
+}
+
+void tst_DBManager::incrementalExportWritesChangesOnly()
+{
+    openScratchDatabase();
+    int folderId = m_dbManager->addNode(
+            makeNode(NodeData::Folder, QStringLiteral("Exported"), SpecialNodeID::RootFolder));
+    m_dbManager->addNode(makeNode(NodeData::Note, QStringLiteral("Kept"), folderId));
+    int changedId =
+            m_dbManager->addNode(makeNode(NodeData::Note, QStringLiteral("Changed"), folderId));
+    int deletedId =
+            m_dbManager->addNode(makeNode(NodeData::Note, QStringLiteral("Deleted"), folderId));
+    m_dbManager->addNode(makeNode(NodeData::Note, QStringLiteral("Same"), folderId));
+    m_dbManager->addNode(makeNode(NodeData::Note, QStringLiteral("Same"), folderId));
+    m_dbManager->addNode(makeNode(NodeData::Note, QStringLiteral("Foreign"), folderId));
+    int movedId = m_dbManager->addNode(makeNode(NodeData::Note, QStringLiteral("Moved"), folderId));
+    int otherId = m_dbManager->addNode(
+            makeNode(NodeData::Folder, QStringLiteral("Other"), SpecialNodeID::RootFolder));
+
+    // a file the export didn't write must survive, the note of the same name goes next to it
+    QString exportBase = m_dir.filePath(QStringLiteral("export"));
+    QDir folderDir(exportBase + QStringLiteral("/Plume Notes/Exported"));
+    QVERIFY(QDir().mkpath(folderDir.path()));
+    {
+        QFile foreign(folderDir.filePath(QStringLiteral("Foreign.txt")));
+        QVERIFY(foreign.open(QIODevice::WriteOnly));
+        foreign.write("mine");
+    }
+    auto readFile = [&folderDir](const QString &fileName) {
+        QFile file(folderDir.filePath(fileName));
+        return file.open(QIODevice::ReadOnly) ? QString::fromUtf8(file.readAll()) : QString();
+    };
+
+    PlainTextExporter exporter(m_dbManager);
+    QSignalSpy finishedSpy(&exporter, &PlainTextExporter::finished);
+    // the exporter reads through requests queued on this thread, QTRY keeps them running
+    exporter.exportNotes(exportBase, QStringLiteral(".txt"), PlainTextExporter::Mode::Incremental);
+    QTRY_VERIFY(!exporter.isRunning());
+    QCOMPARE(finishedSpy.count(), 1);
+    QVERIFY(finishedSpy.at(0).at(2).toStringList().isEmpty());
+    QCOMPARE(readFile(QStringLiteral("Kept.txt")), QStringLiteral("Kept"));
+    QCOMPARE(readFile(QStringLiteral("Deleted.txt")), QStringLiteral("Deleted"));
+    QCOMPARE(readFile(QStringLiteral("Same.txt")), QStringLiteral("Same"));
+    QCOMPARE(readFile(QStringLiteral("Same 1.txt")), QStringLiteral("Same"));
+    QCOMPARE(readFile(QStringLiteral("Foreign.txt")), QStringLiteral("mine"));
+    QCOMPARE(readFile(QStringLiteral("Foreign 1.txt")), QStringLiteral("Foreign"));
+    QCOMPARE(readFile(QStringLiteral("Moved.txt")), QStringLiteral("Moved"));
+
+    NodeData changed = m_dbManager->getNode(changedId);
+    changed.setContent(QStringLiteral("Changed\nagain"));
+    changed.setLastModificationDateTime(changed.lastModificationdateTime().addSecs(1));
+    m_dbManager->onCreateUpdateRequestedNoteContent(changed);
+    m_dbManager->removeNote(m_dbManager->getNode(deletedId));
+    // removed by hand, unchanged in the database: still written again
+    QVERIFY(QFile::remove(folderDir.filePath(QStringLiteral("Kept.txt"))));
+    // moved, unchanged in the database: renamed, a rewrite would drop the text added by hand
+    m_dbManager->moveNode(movedId, m_dbManager->getNode(otherId));
+    {
+        QFile moved(folderDir.filePath(QStringLiteral("Moved.txt")));
+        QVERIFY(moved.open(QIODevice::Append));
+        moved.write(" by hand");
+    }
+
+    finishedSpy.clear();
+    exporter.exportNotes(exportBase, QStringLiteral(".txt"), PlainTextExporter::Mode::Incremental);
+    QTRY_VERIFY(!exporter.isRunning());
+    QCOMPARE(finishedSpy.count(), 1);
+    // only the changed note, the one missing on disk and the moved one
+    QCOMPARE(finishedSpy.at(0).at(0).toInt(), 3);
+    QVERIFY(finishedSpy.at(0).at(2).toStringList().isEmpty());
+    QCOMPARE(readFile(QStringLiteral("Kept.txt")), QStringLiteral("Kept"));
+    QCOMPARE(readFile(QStringLiteral("Changed.txt")), QStringLiteral("Changed\nagain"));
+    QVERIFY(!QFile::exists(folderDir.filePath(QStringLiteral("Deleted.txt"))));
+    QCOMPARE(readFile(QStringLiteral("Same.txt")), QStringLiteral("Same"));
+    QCOMPARE(readFile(QStringLiteral("Same 1.txt")), QStringLiteral("Same"));
+    QCOMPARE(readFile(QStringLiteral("Foreign.txt")), QStringLiteral("mine"));
+    QCOMPARE(readFile(QStringLiteral("Foreign 1.txt")), QStringLiteral("Foreign"));
+    QVERIFY(!QFile::exists(folderDir.filePath(QStringLiteral("Moved.txt"))));
+    QFile moved(exportBase + QStringLiteral("/Plume Notes/Other/Moved.txt"));
+    QVERIFY(moved.open(QIODevice::ReadOnly));
+    QCOMPARE(QString::fromUtf8(moved.readAll()), QStringLiteral("Moved by hand"));
+}
+
+void tst_DBManager::statementCacheReusesPreparedQueries()
+{
+    int noteId = m_dbManager->addNode(
+            makeNode(NodeData::Note, QStringLiteral("Cached"), SpecialNodeID::DefaultNotesFolder));
+
+    // warm up, then every further lookup must reuse the already prepared statements
+    QCOMPARE(m_dbManager->getNode(noteId).fullTitle(), QStringLiteral("Cached"));
+    StatementCacheStats before = m_dbManager->statementCacheStats();
+    for (int i = 0; i < 100; ++i) {
+        QCOMPARE(m_dbManager->getNode(noteId).parentName(), QStringLiteral("Notes"));
+    }
+    StatementCacheStats after = m_dbManager->statementCacheStats();
+    QCOMPARE(after.prepares, before.prepares);
+    QVERIFY(after.lookups >= before.lookups + 300);
+}
+
+void tst_DBManager::noteListLoad_data()
+{
+    QTest::addColumn<bool>("isBatched");
+
+    QTest::newRow("per note") << false;
+    QTest::newRow("batched") << true;
+}
+
+void tst_DBManager::noteListLoad()
+{
+    QFETCH(bool, isBatched);
+    const int noteCount = 2000;
+    openScratchDatabase();
+    // without WAL there are no reader threads and the list is read and emitted right here
+    m_dbManager->setStorageSettings(StorageSettings::fromProfile(QStringLiteral("compatible")));
+    int folderId = addListedFolder(noteCount);
+
+    QSignalSpy spy(m_dbManager, &DBManager::notesListReceived);
+    m_dbManager->onNotesListInFolderRequested(folderId, false);
+    QCOMPARE(spy.count(), 1);
+    const auto listed = spy.takeFirst().at(0).value<QVector<NodeData>>();
+    QCOMPARE(listed.size(), noteCount);
+
+    if (isBatched) {
+        QBENCHMARK {
+            m_dbManager->onNotesListInFolderRequested(folderId, false);
+        }
+    } else {
+        // how lists used to be loaded: the note, its tags and its folder title, note by note
+        QBENCHMARK {
+            for (const auto &note : listed) {
+                m_dbManager->getNode(note.id());
+            }
+        }
+    }
+}
+
+void tst_DBManager::listLatencyAfterClicks_data()
+{
+    QTest::addColumn<int>("clicks");
+
+    QTest::newRow("1") << 1;
+    QTest::newRow("10") << 10;
+    QTest::newRow("100") << 100;
+}
+
+void tst_DBManager::listLatencyAfterClicks()
+{
+    QFETCH(int, clicks);
+    openScratchDatabase();
+    m_dbManager->setStorageSettings(StorageSettings::fromProfile(QStringLiteral("compatible")));
+    int folderId = addListedFolder(2000);
+
+    QSignalSpy spy(m_dbManager, &DBManager::notesListReceived);
+    QVector<quint64> shownIds;
+    // clicking through folders queues one list request per click, only the last one is shown
+    QBENCHMARK {
+        quint64 requestId = 0;
+        for (int i = 0; i < clicks; ++i) {
+            requestId = m_dbManager->beginListRequest();
+            QMetaObject::invokeMethod(
+                    m_dbManager,
+                    [this, folderId, requestId]() {
+                        m_dbManager->onNotesListInFolderRequested(
+                                folderId, false, false, SpecialNodeID::InvalidNodeId, requestId);
+                    },
+                    Qt::QueuedConnection);
+        }
+        QCoreApplication::processEvents();
+        shownIds.append(requestId);
+    }
+    QCOMPARE(spy.count(), shownIds.size());
+    for (int i = 0; i < spy.count(); ++i) {
+        QCOMPARE(spy.at(i).at(0).value<QVector<NodeData>>().size(), 2000);
+        QCOMPARE(spy.at(i).at(1).value<ListViewInfo>().requestId, shownIds.at(i));
+    }
+}
+
+void tst_DBManager::bulkInsertThroughput_data()
+{
+    QTest::addColumn<int>("noteCount");
+
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("100k") << 100000;
+}
+
+void tst_DBManager::bulkInsertThroughput()
+{
+    QFETCH(int, noteCount);
+    openScratchDatabase();
+
+    QVector<NodeData> notes;
+    notes.reserve(noteCount);
+    for (int i = 0; i < noteCount; ++i) {
+        NodeData note = makeNode(NodeData::Note, QStringLiteral("Imported %1").arg(i),
+                                 SpecialNodeID::DefaultNotesFolder);
+        note.setContent(QStringLiteral("Imported %1\nSome imported text").arg(i));
+        notes.append(note);
+    }
+    int countBefore =
+            m_dbManager->getChildNotesCountFolder(SpecialNodeID::DefaultNotesFolder).childNotesCount();
+
+    QVector<int> ids;
+    QBENCHMARK_ONCE {
+        ids = m_dbManager->addNodesBulk(notes);
+    }
+
+    QCOMPARE(ids.size(), noteCount);
+    QCOMPARE(m_dbManager->getNode(ids.last()).fullTitle(),
+             QStringLiteral("Imported %1").arg(noteCount - 1));
+    QCOMPARE(m_dbManager->getChildNotesCountFolder(SpecialNodeID::DefaultNotesFolder)
+                     .childNotesCount(),
+             countBefore + noteCount);
+    QCOMPARE(m_dbManager->nextAvailableNodeId(), ids.last() + 1);
+}
+
+void tst_DBManager::saveLatency_data()
+{
+    QTest::addColumn<QString>("profile");
+
+    QTest::newRow("compatible") << QStringLiteral("compatible");
+    QTest::newRow("balanced") << QStringLiteral("balanced");
+    QTest::newRow("durable") << QStringLiteral("durable");
+}
+
+void tst_DBManager::saveLatency()
+{
+    QFETCH(QString, profile);
+    m_dbManager->setStorageSettings(StorageSettings::fromProfile(profile));
+
+    NodeData note = makeNode(NodeData::Note, QStringLiteral("Autosaved"),
+                             SpecialNodeID::DefaultNotesFolder);
+    note.setId(m_dbManager->addNode(note));
+
+    // one autosave per iteration, as NoteEditorLogic issues them while typing
+    int saves = 0;
+    QBENCHMARK {
+        note.setContent(QStringLiteral("Autosaved\nrevision %1").arg(saves++));
+        note.setLastModificationDateTime(QDateTime::currentDateTime());
+        m_dbManager->onCreateUpdateRequestedNoteContent(note);
+    }
+    QCOMPARE(m_dbManager->getNoteContent(note.id()), note.content());
+    m_dbManager->setStorageSettings(StorageSettings::fromProfile(QStringLiteral("balanced")));
+}
@@ -0,0 +1,56 @@
+#ifndef TST_DBMANAGER_H
+#define TST_DBMANAGER_H
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include "../src/dbmanager.h"
+
+class tst_DBManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_DBManager();
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void cleanup();
+    void queryPlanUsesIndex_data();
+    void queryPlanUsesIndex();
+    void staleListRequestIsDropped();
+    void listReadDoesNotWaitForWriter();
+    void childNotesCountFollowsNotes();
+    void moveFolderRewritesSubtree();
+    void folderToTrashMovesNotesAndDropsFolders();
+    void reorderRewritesMovedRowsOnly();
+    void idCounterIsPersistedWithInsert();
+    void apostropheRoundTripsOnEveryInsert();
+    void notePreviewFollowsContent();
+    void addFolderTreeCreatesParents();
+    void importDirectoryRecreatesFolders();
+    void backupWritesConsistentCopy();
+    void importDatabaseMergesIntoExisting();
+    void changeDatabasePathKeepsDatabaseOnFailure();
+    void incrementalExportWritesChangesOnly();
+    void statementCacheReusesPreparedQueries();
+    void noteListLoad_data();
+    void noteListLoad();
+    void listLatencyAfterClicks_data();
+    void listLatencyAfterClicks();
+    void bulkInsertThroughput_data();
+    void bulkInsertThroughput();
+    void saveLatency_data();
+    void saveLatency();
+
+private:
+    void openScratchDatabase();
+    int addListedFolder(int noteCount);
+
+    QTemporaryDir m_dir;
+    DBManager *m_dbManager;
+    int m_scratchCount;
+    bool m_isOnScratchDatabase;
+};
+
+#endif // TST_DBMANAGER_H
@@ -3,7 +3,6 @@
 
 #include <QString>
 #include <QtTest>
-#include "../src/mainwindow.h"
 
 class tst_MainWindow : public QObject
 {
@@ -2,7 +2,7 @@
 #define TST_NOTEDATA_H
 
 #include <QtTest>
-#include "../src/notedata.h"
+#include "../src/nodedata.h"
 
 class tst_NoteData : public QObject
 {
@@ -1,4 +1,45 @@
 #include "tst_notemodel.h"
+#include "notelistmodel.h"
+
+namespace {
+QVector<NodeData> makeNotes(int count)
+{
+    QVector<NodeData> notes;
+    notes.reserve(count);
+    QDateTime now = QDateTime::currentDateTime();
+    for (int i = 0; i < count; ++i) {
+        NodeData note;
+        note.setId(i + 10);
+        note.setNodeType(NodeData::Note);
+        note.setFullTitle(QStringLiteral("Note %1").arg(i));
+        note.setParentId(SpecialNodeID::DefaultNotesFolder);
+        note.setCreationDateTime(now);
+        note.setLastModificationDateTime(now.addSecs(-i));
+        notes.append(note);
+    }
+    return notes;
+}
+
+// the default notes folder, neither a tag nor the trash
+ListViewInfo folderInfo()
+{
+    ListViewInfo inf;
+    inf.isInTag = false;
+    inf.parentFolderId = SpecialNodeID::DefaultNotesFolder;
+    return inf;
+}
+
+bool isRowIndexConsistent(const NoteListModel &model)
+{
+    for (int row = 0; row < model.rowCount(); ++row) {
+        auto id = model.index(row).data(NoteListModel::NoteID).toInt();
+        if (model.getNoteIndex(id).row() != row) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
 
 tst_NoteModel::tst_NoteModel()
 {
@@ -14,3 +55,189 @@ void tst_NoteModel::cleanupTestCase()
 {
 
 }
+
+void tst_NoteModel::noteIndexFollowsRowChanges()
+{
+    ListViewInfo inf = folderInfo();
+    NoteListModel model;
+    model.setListNote(makeNotes(10), inf);
+    QVERIFY(isRowIndexConsistent(model));
+
+    NodeData note = makeNotes(1).first();
+    note.setId(100);
+    model.insertNote(note, 3);
+    QCOMPARE(model.getNoteIndex(100).row(), 3);
+    QVERIFY(isRowIndexConsistent(model));
+
+    model.moveRow(QModelIndex(), 0, QModelIndex(), 5);
+    QVERIFY(isRowIndexConsistent(model));
+
+    model.removeRows(model.getNoteIndex(100).row(), 1, QModelIndex());
+    QVERIFY(!model.getNoteIndex(100).isValid());
+    QVERIFY(isRowIndexConsistent(model));
+
+    model.setNotesIsPinned({ model.getNoteIndex(15), model.getNoteIndex(18) }, true);
+    QVERIFY(model.getNoteIndex(15).data(NoteListModel::NoteIsPinned).toBool());
+    QVERIFY(model.getNoteIndex(18).row() < 2);
+    QVERIFY(isRowIndexConsistent(model));
+
+    model.setNotesIsPinned({ model.getNoteIndex(15) }, false);
+    QCOMPARE(model.getNoteIndex(18).row(), 0);
+    QVERIFY(isRowIndexConsistent(model));
+
+    // one span over the last pinned and the first unpinned row
+    int unpinnedId = model.index(1).data(NoteListModel::NoteID).toInt();
+    QVERIFY(model.removeRows(0, 2, QModelIndex()));
+    QCOMPARE(model.rowCount(), 8);
+    QVERIFY(!model.hasPinnedNote());
+    QVERIFY(!model.getNoteIndex(18).isValid());
+    QVERIFY(!model.getNoteIndex(unpinnedId).isValid());
+    QVERIFY(isRowIndexConsistent(model));
+
+    model.clearNotes();
+    QVERIFY(!model.getNoteIndex(10).isValid());
+}
+
+void tst_NoteModel::unloadedUpdateKeepsContent()
+{
+    ListViewInfo inf = folderInfo();
+    auto notes = makeNotes(3);
+    notes[1].setContent(QStringLiteral("Note 1\nBody"));
+    NoteListModel model;
+    model.setListNote(notes, inf);
+
+    // what a scroll position update sends for a note whose body was never loaded
+    NodeData update = notes[1];
+    update.setContent(QString());
+    update.setIsContentLoaded(false);
+    update.setScrollBarPosition(5);
+    QModelIndex index = model.getNoteIndex(update.id());
+    model.setNoteData(index, update);
+    QCOMPARE(index.data(NoteListModel::NoteContent).toString(), QStringLiteral("Note 1\nBody"));
+    QCOMPARE(index.data(NoteListModel::NoteScrollbarPos).toInt(), 5);
+}
+
+void tst_NoteModel::selectAndPinThroughput()
+{
+    const int noteCount = 10000;
+    ListViewInfo inf = folderInfo();
+    NoteListModel model;
+    model.setListNote(makeNotes(noteCount), inf);
+
+    QBENCHMARK_ONCE {
+        // what restoring a selection and pinning it does: one lookup per id, one move
+        QModelIndexList selected;
+        selected.reserve(noteCount);
+        for (int i = 0; i < noteCount; ++i) {
+            selected.append(model.getNoteIndex(i + 10));
+        }
+        model.setNotesIsPinned(selected, true);
+        selected.clear();
+        for (int i = 0; i < noteCount; ++i) {
+            selected.append(model.getNoteIndex(i + 10));
+        }
+        model.setNotesIsPinned(selected, false);
+    }
+
+    QVERIFY(!model.hasPinnedNote());
+    QVERIFY(isRowIndexConsistent(model));
+    QCOMPARE(model.index(0).data(NoteListModel::NoteID).toInt(), 10);
+}
+
+void tst_NoteModel::refreshDiffsRows()
+{
+    ListViewInfo inf = folderInfo();
+    auto notes = makeNotes(100);
+    NoteListModel model;
+    model.setListNote(notes, inf);
+    QPersistentModelIndex kept(model.getNoteIndex(50));
+
+    // one note edited, one deleted and one created since the last load
+    notes[40].setLastModificationDateTime(QDateTime::currentDateTime().addSecs(60));
+    notes[40].setFullTitle(QStringLiteral("Edited"));
+    notes.removeAt(70);
+    NodeData created = makeNotes(1).first();
+    created.setId(500);
+    created.setLastModificationDateTime(QDateTime::currentDateTime().addSecs(-30));
+    notes.append(created);
+
+    QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+    QSignalSpy insertSpy(&model, &QAbstractItemModel::rowsInserted);
+    QSignalSpy removeSpy(&model, &QAbstractItemModel::rowsRemoved);
+    QSignalSpy moveSpy(&model, &QAbstractItemModel::rowsMoved);
+    // views look notes up while they handle each step
+    int inconsistentSteps = 0;
+    auto checkRowIndex = [&model, &inconsistentSteps]() {
+        if (!isRowIndexConsistent(model)) {
+            ++inconsistentSteps;
+        }
+    };
+    connect(&model, &QAbstractItemModel::rowsRemoved, this, checkRowIndex);
+    connect(&model, &QAbstractItemModel::rowsMoved, this, checkRowIndex);
+    connect(&model, &QAbstractItemModel::rowsInserted, this, checkRowIndex);
+    model.setListNote(notes, inf);
+    QCOMPARE(inconsistentSteps, 0);
+    QCOMPARE(resetSpy.count(), 0);
+    QCOMPARE(insertSpy.count(), 1);
+    QCOMPARE(removeSpy.count(), 1);
+    QCOMPARE(moveSpy.count(), 1);
+
+    QVERIFY(kept.isValid());
+    QCOMPARE(kept.data(NoteListModel::NoteID).toInt(), 50);
+    QCOMPARE(model.index(0).data(NoteListModel::NoteFullTitle).toString(),
+             QStringLiteral("Edited"));
+    QVERIFY(!model.getNoteIndex(80).isValid());
+    QVERIFY(isRowIndexConsistent(model));
+
+    // same rows as a freshly loaded model
+    NoteListModel loaded;
+    loaded.setListNote(notes, inf);
+    QCOMPARE(model.rowCount(), loaded.rowCount());
+    for (int row = 0; row < loaded.rowCount(); ++row) {
+        QCOMPARE(model.index(row).data(NoteListModel::NoteID).toInt(),
+                 loaded.index(row).data(NoteListModel::NoteID).toInt());
+    }
+
+    // another folder is a new list
+    inf.parentFolderId = SpecialNodeID::RootFolder;
+    model.setListNote(notes, inf);
+    QCOMPARE(resetSpy.count(), 1);
+}
+
+void tst_NoteModel::scatteredRefreshResets()
+{
+    ListViewInfo inf = folderInfo();
+    auto notes = makeNotes(300);
+    NoteListModel model;
+    model.setListNote(notes, inf);
+
+    // every other note deleted: a hundred and fifty removes cost more than one reset
+    QVector<NodeData> kept;
+    for (int i = 0; i < notes.size(); i += 2) {
+        kept.append(notes[i]);
+    }
+    QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+    QSignalSpy removeSpy(&model, &QAbstractItemModel::rowsRemoved);
+    model.setListNote(kept, inf);
+    QCOMPARE(resetSpy.count(), 1);
+    QCOMPARE(removeSpy.count(), 0);
+    QCOMPARE(model.rowCount(), kept.size());
+    QVERIFY(isRowIndexConsistent(model));
+}
+
+void tst_NoteModel::refreshThroughput()
+{
+    const int noteCount = 10000;
+    ListViewInfo inf = folderInfo();
+    auto notes = makeNotes(noteCount);
+    NoteListModel model;
+    model.setListNote(notes, inf);
+    notes[noteCount / 2].setLastModificationDateTime(QDateTime::currentDateTime().addSecs(60));
+
+    QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+    QBENCHMARK_ONCE {
+        model.setListNote(notes, inf);
+    }
+    QCOMPARE(resetSpy.count(), 0);
+    QCOMPARE(model.index(0).data(NoteListModel::NoteID).toInt(), noteCount / 2 + 10);
+}
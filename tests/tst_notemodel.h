@@ -13,6 +13,12 @@ public:
 private Q_SLOTS:
     void initTestCase();
     void cleanupTestCase();
+    void noteIndexFollowsRowChanges();
+    void unloadedUpdateKeepsContent();
+    void selectAndPinThroughput();
+    void refreshDiffsRows();
+    void scatteredRefreshResets();
+    void refreshThroughput();
 };
 
 #endif // TST_NOTEMODEL_H
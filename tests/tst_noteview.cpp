@@ -1,4 +1,70 @@
 #include "tst_noteview.h"
+#include <QtTest>
+#include <QScrollBar>
+#include <QApplication>
+#include "dbmanager.h"
+#include "tagpool.h"
+#include "notelistmodel.h"
+#include "notelistview.h"
+#include "notelistdelegate.h"
+
+namespace {
+const int tagId = 1;
+
+// every tagEvery-th note carries the tag, none if tagEvery is 0
+QVector<NodeData> makeNotes(int count, int tagEvery)
+{
+    QVector<NodeData> notes;
+    notes.reserve(count);
+    QDateTime now = QDateTime::currentDateTime();
+    for (int i = 0; i < count; ++i) {
+        NodeData note;
+        note.setId(i + 10);
+        note.setNodeType(NodeData::Note);
+        note.setFullTitle(QStringLiteral("Note %1").arg(i));
+        note.setPreview(QStringLiteral("Preview %1").arg(i));
+        note.setParentId(SpecialNodeID::DefaultNotesFolder);
+        note.setParentName(QStringLiteral("Notes"));
+        note.setCreationDateTime(now);
+        note.setLastModificationDateTime(now.addSecs(-i));
+        if (tagEvery > 0 && i % tagEvery == 0) {
+            note.setTagIds({ tagId });
+        }
+        notes.append(note);
+    }
+    return notes;
+}
+
+// a shown list view over notes, with the tag of makeNotes in its pool
+struct ListViewFixture
+{
+    DBManager dbManager;
+    TagPool tagPool;
+    NoteListModel model;
+    NoteListView view;
+    NoteListDelegate *delegate;
+
+    explicit ListViewFixture(const QVector<NodeData> &notes)
+        : tagPool(&dbManager), delegate(new NoteListDelegate(&view, &tagPool, &view))
+    {
+        TagData tag;
+        tag.setId(tagId);
+        tag.setName(QStringLiteral("Tagged"));
+        tag.setColor(QStringLiteral("#ff0000"));
+        tagPool.setTagPool({ { tag.id(), tag } });
+
+        ListViewInfo inf;
+        inf.parentFolderId = SpecialNodeID::DefaultNotesFolder;
+        view.setTagPool(&tagPool);
+        view.setItemDelegate(delegate);
+        view.setModel(&model);
+        model.setListNote(notes, inf);
+        view.resize(300, 800);
+        view.show();
+    }
+    ~ListViewFixture() { view.closeAllEditor(); }
+};
+} // namespace
 
 tst_NoteView::tst_NoteView()
 {
@@ -14,3 +80,107 @@ void tst_NoteView::cleanupTestCase()
 {
 
 }
+
+void tst_NoteView::scrollThroughput()
+{
+    // synthetic list, every tenth note is tagged and has its tag chips painted
+    ListViewFixture fixture(makeNotes(50000, 10));
+    QVERIFY(QTest::qWaitForWindowExposed(&fixture.view));
+
+    // one wheel notch per frame, painted before the next one; the benchmark result is the
+    // frame time
+    QScrollBar *scrollBar = fixture.view.verticalScrollBar();
+    QVERIFY(scrollBar->maximum() > 0);
+    int step = scrollBar->singleStep() * QApplication::wheelScrollLines();
+    QBENCHMARK {
+        scrollBar->setValue((scrollBar->value() + step) % scrollBar->maximum());
+        QCoreApplication::processEvents();
+    }
+
+    // twenty notches stay well inside the cache budget, so a second pass over the rows the
+    // first one painted has to come from the cache
+    const int passEnd = qMin(scrollBar->maximum(), step * 20);
+    auto scrollPass = [scrollBar, step, passEnd]() {
+        for (int value = 0; value <= passEnd; value += step) {
+            scrollBar->setValue(value);
+            QCoreApplication::processEvents();
+        }
+    };
+    fixture.delegate->clearRowPixmapCache();
+    scrollPass();
+    RowPixmapCacheStats firstPass = fixture.delegate->rowPixmapCacheStats();
+    scrollPass();
+    RowPixmapCacheStats secondPass = fixture.delegate->rowPixmapCacheStats();
+    quint64 hits = secondPass.hits - firstPass.hits;
+    quint64 misses = secondPass.misses - firstPass.misses;
+    QVERIFY(hits + misses > 0);
+    // QtTest has no metric for a ratio, it is printed next to the frame time
+    double hitRate = double(hits) / double(hits + misses);
+    qInfo("row pixmap cache on the second pass: %llu hits, %llu misses, hit rate %.1f%%",
+          hits, misses, hitRate * 100);
+    QVERIFY2(hitRate >= 0.9, qPrintable(QStringLiteral("hit rate %1").arg(hitRate)));
+}
+
+void tst_NoteView::editorsOnlyForSelectedRows()
+{
+    ListViewFixture fixture(makeNotes(20, 1));
+    QVERIFY(QTest::qWaitForWindowExposed(&fixture.view));
+    NoteListView &view = fixture.view;
+    NoteListModel &model = fixture.model;
+
+    // visible tagged rows are painted, only the selected one gets a widget
+    view.setCurrentIndexC(model.index(2, 0));
+    QVERIFY(view.isPersistentEditorOpen(model.index(2, 0)));
+    QVERIFY(!view.isPersistentEditorOpen(model.index(3, 0)));
+
+    // its editor is recycled for the next selected row
+    view.setCurrentIndexC(model.index(3, 0));
+    QVERIFY(view.isPersistentEditorOpen(model.index(3, 0)));
+    QVERIFY(!view.isPersistentEditorOpen(model.index(2, 0)));
+}
+
+void tst_NoteView::editorsOnlyForVisibleSelection()
+{
+    ListViewFixture fixture(makeNotes(500, 1));
+    QVERIFY(QTest::qWaitForWindowExposed(&fixture.view));
+    NoteListView &view = fixture.view;
+    NoteListModel &model = fixture.model;
+
+    // a selection far larger than the viewport only gets widgets for the rows on screen
+    view.setCurrentIndexC(model.index(0, 0));
+    view.setSelectionMode(QAbstractItemView::MultiSelection);
+    view.selectAll();
+    QVERIFY(view.isPersistentEditorOpen(model.index(0, 0)));
+    QVERIFY(!view.isPersistentEditorOpen(model.index(model.rowCount() - 1, 0)));
+
+    view.scrollToBottom();
+    QCoreApplication::processEvents();
+    QVERIFY(view.isPersistentEditorOpen(model.index(model.rowCount() - 1, 0)));
+    // the current row keeps its editor while scrolled away
+    QVERIFY(view.isPersistentEditorOpen(model.index(0, 0)));
+    QVERIFY(!view.isPersistentEditorOpen(model.index(model.rowCount() / 2, 0)));
+}
+
+void tst_NoteView::rowPixmapCacheFollowsDataChanged()
+{
+    ListViewFixture fixture(makeNotes(5, 0));
+    QVERIFY(QTest::qWaitForWindowExposed(&fixture.view));
+    NoteListView &view = fixture.view;
+    NoteListDelegate *delegate = fixture.delegate;
+
+    // an unchanged list is repainted from the cache
+    view.viewport()->repaint();
+    auto before = delegate->rowPixmapCacheStats();
+    view.viewport()->repaint();
+    auto after = delegate->rowPixmapCacheStats();
+    QCOMPARE(after.misses, before.misses);
+    QVERIFY(after.hits > before.hits);
+
+    // a changed note is rendered again, the others still come from the cache
+    fixture.model.setData(fixture.model.index(4, 0), QStringLiteral("Renamed"),
+                          NoteListModel::NoteFullTitle);
+    view.viewport()->repaint();
+    auto changed = delegate->rowPixmapCacheStats();
+    QCOMPARE(changed.misses, after.misses + 1);
+    QVERIFY(changed.hits > after.hits);
+}
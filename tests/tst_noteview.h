@@ -12,6 +12,10 @@ public:
 private Q_SLOTS:
     void initTestCase();
     void cleanupTestCase();
+    void scrollThroughput();
+    void editorsOnlyForSelectedRows();
+    void editorsOnlyForVisibleSelection();
+    void rowPixmapCacheFollowsDataChanged();
 };
 
 #endif // TST_NOTEVIEW_H